@@ -0,0 +1,196 @@
+#! /usr/bin/env python3
+"""
+Runs many EKF2 replays of the same ULog file in parallel, each with its own set of
+parameter overrides (e.g. for an EKF2_* parameter sweep), and reports the wall time
+and the result of each run.
+
+The parameter sets are read from a CSV file: the header contains the parameter names
+and each row is one replay run. An optional 'name' column gives the name of the run.
+Empty cells keep the value from the log. Example:
+
+    name,EKF2_GPS_DELAY,EKF2_BARO_NOISE
+    delay_100,100,
+    delay_150,150,2.5
+
+Each run gets its own working directory (<output>/<name>), containing its
+replay_params.txt, the console output and the replayed log (log/**/*.ulg).
+Compressed logs are decompressed once before starting the runs, and all runs read the
+same file (it is memory-mapped by the replay module, so the data is shared through the
+page cache).
+
+PX4 must be built with replay support, e.g.:
+    replay=<log file> make px4_sitl_default
+"""
+# -*- coding: utf-8 -*-
+
+import argparse
+import concurrent.futures
+import csv
+import glob
+import multiprocessing
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+sys.path.append(os.path.dirname(os.path.realpath(__file__)))
+from ulog_decompress import decompress, is_compressed
+
+
+def get_arguments():
+    parser = argparse.ArgumentParser(description='Run EKF2 replays of a log in parallel, each with its own '
+                                                 'parameter overrides')
+    parser.add_argument('log_file', help='ULog file to replay (.ulg or .ulgz)')
+    parser.add_argument('param_sets', help='CSV file with the parameter overrides (one row per run)')
+    parser.add_argument('-o', '--output', default='replay_batch',
+                        help='output directory (default: %(default)s)')
+    parser.add_argument('-b', '--build-dir', default=None,
+                        help='PX4 build directory (default: build/px4_sitl_default)')
+    parser.add_argument('-j', '--jobs', type=int, default=multiprocessing.cpu_count(),
+                        help='number of replays to run in parallel (default: %(default)s)')
+    parser.add_argument('-t', '--timeout', type=float, default=None,
+                        help='timeout in seconds for a single run')
+    parser.add_argument('--overwrite', action='store_true',
+                        help='whether to delete existing run directories')
+    return parser.parse_args()
+
+
+def read_param_sets(file_name):
+    """ read the parameter sets from a CSV file
+    :return: list of (name, {param: value}) """
+    param_sets = []
+    with open(file_name, newline='') as csv_file:
+        for i, row in enumerate(csv.DictReader(csv_file, skipinitialspace=True)):
+            name = row.pop('name', None) or 'run_{:03d}'.format(i)
+            params = {param: value.strip() for param, value in row.items()
+                      if value is not None and value.strip() != ''}
+            param_sets.append((name, params))
+    return param_sets
+
+
+def run_replay(px4_binary, romfs_dir, log_file, instance, run_dir, params, timeout):
+    """ run a single replay in run_dir
+    :return: dict with the results """
+    os.makedirs(run_dir)
+    with open(os.path.join(run_dir, 'replay_params.txt'), 'w') as params_file:
+        for param, value in sorted(params.items()):
+            params_file.write('{} {}\n'.format(param, value))
+
+    env = os.environ.copy()
+    env['replay'] = log_file
+    env['replay_mode'] = 'ekf2'
+
+    result = {'return_code': None, 'wall_time': 0., 'published': None, 'log': None}
+    start_time = time.time()
+
+    with open(os.path.join(run_dir, 'out.log'), 'w') as out:
+        try:
+            result['return_code'] = subprocess.call(
+                [px4_binary, '-i', str(instance), '-d', '-s', 'etc/init.d-posix/rcS', romfs_dir],
+                cwd=run_dir, env=env, stdout=out, stderr=subprocess.STDOUT, timeout=timeout)
+        except subprocess.TimeoutExpired:
+            pass
+
+    result['wall_time'] = time.time() - start_time
+
+    with open(os.path.join(run_dir, 'out.log'), errors='replace') as out:
+        match = re.search(r'Replay done \(published (\d+) msgs', out.read())
+        if match:
+            result['published'] = int(match.group(1))
+
+    replayed_logs = sorted(glob.glob(os.path.join(run_dir, 'log', '**', '*.ulg'), recursive=True))
+    if replayed_logs:
+        result['log'] = replayed_logs[-1]
+
+    return result
+
+
+def main() -> None:
+
+    args = get_arguments()
+
+    src_dir = os.path.realpath(os.path.join(os.path.dirname(__file__), '..'))
+    build_dir = args.build_dir or os.path.join(src_dir, 'build', 'px4_sitl_default')
+    px4_binary = os.path.realpath(os.path.join(build_dir, 'bin', 'px4'))
+    romfs_dir = os.path.join(src_dir, 'ROMFS', 'px4fmu_common')
+
+    if not os.path.isfile(px4_binary):
+        print('px4 binary not found: {:s}'.format(px4_binary))
+        sys.exit(1)
+
+    param_sets = read_param_sets(args.param_sets)
+    if len(param_sets) == 0:
+        print('no parameter sets found in {:s}'.format(args.param_sets))
+        sys.exit(1)
+
+    if len(set(name for name, _ in param_sets)) != len(param_sets):
+        print('the run names are not unique')
+        sys.exit(1)
+
+    output_dir = os.path.realpath(args.output)
+    os.makedirs(output_dir, exist_ok=True)
+
+    # decompress once, instead of in every run
+    log_file = os.path.realpath(args.log_file)
+    if is_compressed(log_file):
+        decompressed_file = os.path.join(output_dir, os.path.splitext(os.path.basename(log_file))[0] + '.ulg')
+        print('decompressing {:s} to {:s}'.format(log_file, decompressed_file))
+        with open(log_file, 'rb') as src, open(decompressed_file, 'wb') as dst:
+            decompress(src, dst)
+        log_file = decompressed_file
+
+    run_dirs = {}
+    for name, _ in param_sets:
+        run_dirs[name] = os.path.join(output_dir, name)
+        if os.path.exists(run_dirs[name]):
+            if not args.overwrite:
+                print('{:s} already exists (use --overwrite)'.format(run_dirs[name]))
+                sys.exit(1)
+            shutil.rmtree(run_dirs[name])
+
+    n_runs = len(param_sets)
+    n_jobs = max(1, min(args.jobs, n_runs))
+    print('running {:d} replays of {:s} ({:d} in parallel)'.format(n_runs, log_file, n_jobs))
+
+    start_time = time.time()
+    results = {}
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=n_jobs) as executor:
+        # each running instance needs a unique instance id. Ids are not reused, which avoids
+        # collisions with instances that are still shutting down.
+        futures = {executor.submit(run_replay, px4_binary, romfs_dir, log_file, instance, run_dirs[name],
+                                   params, args.timeout): name
+                   for instance, (name, params) in enumerate(param_sets)}
+
+        for future in concurrent.futures.as_completed(futures):
+            name = futures[future]
+            results[name] = future.result()
+            print('finished {:d}/{:d}: {:s} ({:.1f} s)'.format(len(results), n_runs, name,
+                                                               results[name]['wall_time']))
+
+    wall_time = time.time() - start_time
+    run_time_sum = sum(result['wall_time'] for result in results.values())
+
+    print('')
+    print('{:<24} {:>6} {:>10} {:>10}  {}'.format('run', 'return', 'time [s]', 'published', 'log'))
+    n_failed = 0
+    for name, _ in param_sets:
+        result = results[name]
+        failed = result['return_code'] != 0 or result['published'] is None or result['log'] is None
+        n_failed += failed
+        print('{:<24} {:>6} {:>10.1f} {:>10}  {}'.format(
+            name, 'timeout' if result['return_code'] is None else result['return_code'],
+            result['wall_time'], '-' if result['published'] is None else result['published'],
+            result['log'] or '-'))
+
+    print('')
+    print('{:d}/{:d} runs succeeded. Wall time: {:.1f} s (sum of run times: {:.1f} s, speedup {:.1f}x)'.format(
+        n_runs - n_failed, n_runs, wall_time, run_time_sum, run_time_sum / wall_time if wall_time > 0 else 0.))
+
+    sys.exit(1 if n_failed > 0 else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python
+
+"""
+Decompress compressed ULog files (.ulgz, written by the logger with SDLOG_COMPRESS
+enabled) into plain ULog files.
+
+The file format is described in src/lib/ulog_compression/ulog_compression.h.
+The python 'lz4' package is used if available, otherwise a (slower) pure python
+decoder.
+
+It can also be used as module, e.g. with pyulog:
+    from ulog_decompress import open_ulog
+    ulog = ULog(open_ulog('log001.ulgz'))
+"""
+
+from __future__ import print_function
+import io
+import struct
+import sys
+from argparse import ArgumentParser
+
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+FILE_MAGIC = b'ULogZ\x00'
+FILE_VERSION = 1
+CODEC_LZ4 = 1
+BLOCK_SYNC = 0x4b4c425a
+FILE_HEADER = struct.Struct('<6sBBI')
+BLOCK_HEADER = struct.Struct('<IIII')
+
+
+def checksum(data):
+    """ FNV-1a hash of the block payload """
+    h = 2166136261
+    for b in bytearray(data):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def decompress_block(src, uncompressed_size):
+    """ decode a block in LZ4 block format """
+    if lz4 is not None:
+        return lz4.block.decompress(src, uncompressed_size=uncompressed_size)
+
+    src = bytearray(src)
+    dst = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        dst += src[i:i + length]
+        i += length
+        if i >= len(src):
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        length += 4
+        if offset == 0 or offset > len(dst):
+            raise ValueError('invalid match offset')
+        start = len(dst) - offset
+        for k in range(length):
+            dst.append(dst[start + k])
+    if len(dst) != uncompressed_size:
+        raise ValueError('invalid block size')
+    return bytes(dst)
+
+
+def is_compressed(file_name):
+    """ check if a file is a compressed ULog file """
+    with open(file_name, 'rb') as f:
+        return f.read(len(FILE_MAGIC)) == FILE_MAGIC
+
+
+def decompress(src, dst):
+    """ decompress the file object src into dst. Stops at the first incomplete
+    or corrupt block (e.g. if the logger was interrupted).
+    :return: number of decompressed bytes """
+    header = src.read(FILE_HEADER.size)
+    if len(header) != FILE_HEADER.size:
+        raise ValueError('file too short')
+    magic, version, codec, block_size = FILE_HEADER.unpack(header)
+    if magic != FILE_MAGIC:
+        raise ValueError('not a compressed ULog file')
+    if version != FILE_VERSION or codec != CODEC_LZ4:
+        raise ValueError('unsupported version {:} or codec {:}'.format(version, codec))
+
+    total = 0
+    while True:
+        block_header = src.read(BLOCK_HEADER.size)
+        if len(block_header) != BLOCK_HEADER.size:
+            break
+        sync, compressed_size, uncompressed_size, block_checksum = BLOCK_HEADER.unpack(block_header)
+        if sync != BLOCK_SYNC or compressed_size > block_size or uncompressed_size > block_size:
+            print('Warning: corrupt block at offset {:}'.format(src.tell() - BLOCK_HEADER.size), file=sys.stderr)
+            break
+        payload = src.read(compressed_size)
+        if len(payload) != compressed_size or checksum(payload) != block_checksum:
+            print('Warning: incomplete block at the end of the file', file=sys.stderr)
+            break
+        if compressed_size == uncompressed_size:
+            data = payload
+        else:
+            data = decompress_block(payload, uncompressed_size)
+        dst.write(data)
+        total += len(data)
+    return total
+
+
+def open_ulog(file_name):
+    """ open a ULog file for reading, decompressing it if necessary
+    :return: file object """
+    if not is_compressed(file_name):
+        return open(file_name, 'rb')
+    data = io.BytesIO()
+    with open(file_name, 'rb') as src:
+        decompress(src, data)
+    data.seek(0)
+    return data
+
+
+def main():
+    parser = ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('input', help='compressed ULog file (.ulgz)')
+    parser.add_argument('output', nargs='?', default=None,
+                        help='output ULog file (default: input file with .ulg extension)')
+    args = parser.parse_args()
+
+    output = args.output
+    if output is None:
+        output = args.input[:-5] + '.ulg' if args.input.endswith('.ulgz') else args.input + '.ulg'
+
+    with open(args.input, 'rb') as src, open(output, 'wb') as dst:
+        total = decompress(src, dst)
+    print('{:}: {:} bytes'.format(output, total))
+
+
+if __name__ == '__main__':
+    main()
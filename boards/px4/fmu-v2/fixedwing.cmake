@@ -10,6 +10,7 @@ px4_add_board(
 	IO px4_io-v2_default
 	#TESTING
 	CONSTRAINED_FLASH
+	CONSTRAINED_MEMORY
 	#UAVCAN_INTERFACES 2
 	CONSTRAINED_FLASH
 
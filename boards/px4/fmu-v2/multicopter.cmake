@@ -10,6 +10,7 @@ px4_add_board(
 	BOOTLOADER ${PX4_SOURCE_DIR}/ROMFS/px4fmu_common/extras/px4fmuv3_bl.bin
 	IO px4_io-v2_default
 	CONSTRAINED_FLASH
+	CONSTRAINED_MEMORY
 	#UAVCAN_INTERFACES 2
 
 	SERIAL_PORTS
@@ -9,6 +9,7 @@ px4_add_board(
 	ROMFSROOT px4fmu_common
 	IO px4_io-v2_default
 	CONSTRAINED_FLASH
+	CONSTRAINED_MEMORY
 
 	SERIAL_PORTS
 		GPS1:/dev/ttyS3
@@ -11,6 +11,7 @@ px4_add_board(
 	TESTING
 	#UAVCAN_INTERFACES 2
 	CONSTRAINED_FLASH
+	CONSTRAINED_MEMORY
 
 	SERIAL_PORTS
 		GPS1:/dev/ttyS0
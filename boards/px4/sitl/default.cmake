@@ -96,8 +96,14 @@ if(REPLAY_FILE)
 	message(STATUS "Building with uorb publisher rules support")
 	add_definitions(-DORB_USE_PUBLISHER_RULES)
 
-	message(STATUS "Building without lockstep for replay")
-	set(ENABLE_LOCKSTEP_SCHEDULER no)
+	# replay_mode=fast: the replay module drives the lockstep time (as fast as possible)
+	if("$ENV{replay_mode}" STREQUAL "fast")
+		message(STATUS "Building with lockstep for fast replay")
+		set(ENABLE_LOCKSTEP_SCHEDULER yes)
+	else()
+		message(STATUS "Building without lockstep for replay")
+		set(ENABLE_LOCKSTEP_SCHEDULER no)
+	endif()
 else()
 	set(ENABLE_LOCKSTEP_SCHEDULER yes)
 endif()
@@ -56,6 +56,7 @@
 #			[ SERIAL_PORTS <list> ]
 #			[ DF_DRIVERS <list> ]
 #			[ CONSTRAINED_FLASH ]
+#			[ CONSTRAINED_MEMORY ]
 #			[ TESTING ]
 #			)
 #
@@ -77,6 +78,7 @@
 #		SERIAL_PORTS		: mapping of user configurable serial ports and param facing name
 #		DF_DRIVERS		: list of DriverFramework device drivers (includes DriverFramework driver and wrapper)
 #		CONSTRAINED_FLASH	: flag to enable constrained flash options (eg limit init script status text)
+#		CONSTRAINED_MEMORY	: flag to enable constrained RAM options (eg sparse parameter value storage)
 #		TESTING			: flag to enable automatic inclusion of PX4 testing modules
 #
 #
@@ -149,6 +151,7 @@ function(px4_add_board)
 			DF_DRIVERS
 		OPTIONS
 			CONSTRAINED_FLASH
+			CONSTRAINED_MEMORY
 			TESTING
 		REQUIRED
 			PLATFORM
@@ -221,6 +224,10 @@ function(px4_add_board)
 		add_definitions(-DCONSTRAINED_FLASH)
 	endif()
 
+	if(CONSTRAINED_MEMORY)
+		add_definitions(-DCONSTRAINED_MEMORY)
+	endif()
+
 	if(TESTING)
 		set(PX4_TESTING "1" CACHE INTERNAL "testing enabled" FORCE)
 	endif()
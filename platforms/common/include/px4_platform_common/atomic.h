@@ -73,6 +73,7 @@ public:
 #endif
 
 
+	atomic() : _value{} {}
 	explicit atomic(T value) : _value(value) {}
 
 	/**
@@ -99,6 +100,15 @@ public:
 #endif
 	}
 
+	/**
+	 * Atomically replace the value and return the previous value.
+	 * @return value prior to the exchange
+	 */
+	inline T exchange(T value)
+	{
+		return __atomic_exchange_n(&_value, value, __ATOMIC_SEQ_CST);
+	}
+
 	/**
 	 * Atomically add a number and return the previous value.
 	 * @return value prior to the addition
@@ -163,7 +173,7 @@ public:
 	 */
 	inline bool compare_exchange(T *expected, T num)
 	{
-		return __atomic_compare_exchange(&_value, expected, num, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+		return __atomic_compare_exchange_n(&_value, expected, num, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
 	}
 
 private:
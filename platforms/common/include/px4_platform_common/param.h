@@ -130,13 +130,15 @@ public:
 	/// Store the parameter value to the parameter storage, w/o notifying the system (@see param_set_no_notification())
 	bool commit_no_notification() const { return param_set_no_notification(handle(), &_val) == 0; }
 
-	void set(float val) { _val = val; }
+	void set(float val) { _val = val; _generation = 0; }
 
-	bool update() { return param_get(handle(), &_val) == 0; }
+	/// Re-read the parameter value, if it changed since the last update() (lock-free)
+	bool update() { return param_get_if_changed(handle(), &_val, &_generation) >= 0; }
 
 	param_t handle() const { return param_handle(p); }
 private:
 	float _val;
+	uint16_t _generation{0}; ///< change generation of _val, 0 if _val was set locally
 };
 
 // external version
@@ -166,7 +168,12 @@ public:
 
 	void set(float val) { _val = val; }
 
-	bool update() { return param_get(handle(), &_val) == 0; }
+	/// Re-read the parameter value (lock-free). Always copies, as the external value can be modified directly.
+	bool update()
+	{
+		uint16_t generation = 0;
+		return param_get_if_changed(handle(), &_val, &generation) >= 0;
+	}
 
 	param_t handle() const { return param_handle(p); }
 private:
@@ -196,13 +203,15 @@ public:
 	/// Store the parameter value to the parameter storage, w/o notifying the system (@see param_set_no_notification())
 	bool commit_no_notification() const { return param_set_no_notification(handle(), &_val) == 0; }
 
-	void set(int32_t val) { _val = val; }
+	void set(int32_t val) { _val = val; _generation = 0; }
 
-	bool update() { return param_get(handle(), &_val) == 0; }
+	/// Re-read the parameter value, if it changed since the last update() (lock-free)
+	bool update() { return param_get_if_changed(handle(), &_val, &_generation) >= 0; }
 
 	param_t handle() const { return param_handle(p); }
 private:
 	int32_t _val;
+	uint16_t _generation{0}; ///< change generation of _val, 0 if _val was set locally
 };
 
 //external version
@@ -232,7 +241,12 @@ public:
 
 	void set(int32_t val) { _val = val; }
 
-	bool update() { return param_get(handle(), &_val) == 0; }
+	/// Re-read the parameter value (lock-free). Always copies, as the external value can be modified directly.
+	bool update()
+	{
+		uint16_t generation = 0;
+		return param_get_if_changed(handle(), &_val, &generation) >= 0;
+	}
 
 	param_t handle() const { return param_handle(p); }
 private:
@@ -270,24 +284,25 @@ public:
 		return param_set_no_notification(handle(), &value_int) == 0;
 	}
 
-	void set(bool val) { _val = val; }
+	void set(bool val) { _val = val; _generation = 0; }
 
+	/// Re-read the parameter value, if it changed since the last update() (lock-free)
 	bool update()
 	{
 		int32_t value_int;
-		int ret = param_get(handle(), &value_int);
+		int ret = param_get_if_changed(handle(), &value_int, &_generation);
 
-		if (ret == 0) {
+		if (ret > 0) {
 			_val = value_int != 0;
-			return true;
 		}
 
-		return false;
+		return ret >= 0;
 	}
 
 	param_t handle() const { return param_handle(p); }
 private:
 	bool _val;
+	uint16_t _generation{0}; ///< change generation of _val, 0 if _val was set locally
 };
 
 template <px4::params p>
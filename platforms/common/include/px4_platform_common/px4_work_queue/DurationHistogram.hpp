@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file DurationHistogram.hpp
+ *
+ * Log2 histogram of durations, used by the work queue and uORB instrumentation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace px4
+{
+
+/**
+ * Log2 histogram of durations in microseconds.
+ * record() uses relaxed atomic operations and can be called concurrently from several threads.
+ * Readers may see slightly inconsistent values.
+ */
+struct DurationHistogram {
+	static constexpr int BINS = 12;
+
+	uint32_t count{0};
+	uint32_t sum_low{0}; ///< [us] lower 32 bits of the sum (64 bit atomics are not lock-free on all targets)
+	uint32_t sum_high{0}; ///< upper 32 bits of the sum (carry of sum_low)
+	uint32_t max{0}; ///< [us]
+	uint32_t bins[BINS] {}; ///< bin i: [2^i, 2^(i+1)) us, bin 0 starts at 0, last bin unbounded
+
+	void reset();
+
+	void record(uint32_t duration_us);
+
+	uint64_t sum() const { return ((uint64_t)sum_high << 32) | sum_low; }
+
+	uint32_t mean() const { return (count > 0) ? (uint32_t)(sum() / count) : 0; }
+
+	/**
+	 * Estimate a percentile from the histogram (upper bound of the bin).
+	 * @param percentile in [0, 1]
+	 * @return duration [us]
+	 */
+	uint32_t percentile(float percentile) const;
+};
+
+} // namespace px4
@@ -35,8 +35,9 @@
 
 #include "WorkQueueManager.hpp"
 #include "WorkQueue.hpp"
+#include "WorkItemStatistics.hpp"
 
-#include <containers/IntrusiveQueue.hpp>
+#include <containers/IntrusiveMpscQueue.hpp>
 #include <px4_platform_common/defines.h>
 #include <drivers/drv_hrt.h>
 
@@ -45,7 +46,7 @@
 namespace px4
 {
 
-class WorkItem : public ListNode<WorkItem *>, public IntrusiveQueueNode<WorkItem *>
+class WorkItem : public ListNode<WorkItem *>, public IntrusiveMpscQueueNode<WorkItem *>
 {
 public:
 
@@ -66,6 +67,27 @@ public:
 
 	virtual void print_run_status() const;
 
+	/**
+	 * Print the scheduling latency and run time statistics (if enabled).
+	 */
+	void print_statistics() const;
+
+	/**
+	 * Enable or disable recording of the scheduling latency and run time statistics.
+	 * The statistics are reset when enabled (applied by the work queue thread before the next run,
+	 * until then no statistics are reported).
+	 */
+	void enable_statistics(bool enable);
+
+	const WorkItemStatistics *statistics() const
+	{
+		return (_statistics_enabled && !_statistics->reset_pending.load()) ? _statistics : nullptr;
+	}
+
+	const char *ItemName() const { return _item_name; }
+	unsigned RunCount() const { return _run_count; }
+	float average_rate() const;
+
 	/**
 	 * Switch to a different WorkQueue.
 	 * NOTE: Caller is responsible for synchronization.
@@ -85,7 +107,7 @@ protected:
 
 	void RunPreamble() { _run_count++; }
 
-	friend void WorkQueue::Run();
+	friend class WorkQueue;
 	virtual void Run() = 0;
 
 	/**
@@ -100,10 +122,8 @@ protected:
 	void Deinit();
 
 	float elapsed_time() const;
-	float average_rate() const;
 	float average_interval() const;
 
-
 	hrt_abstime	_start_time{0};
 	unsigned	_run_count{0};
 	const char 	*_item_name;
@@ -112,6 +132,9 @@ private:
 
 	WorkQueue	*_wq{nullptr};
 
+	WorkItemStatistics	*_statistics{nullptr}; ///< allocated on first use, kept until destruction
+	volatile bool		_statistics_enabled{false};
+
 };
 
 } // namespace px4
@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file WorkItemStatistics.hpp
+ *
+ * Optional WorkItem scheduling statistics (work_queue instrument).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <px4_platform_common/atomic.h>
+
+#include "DurationHistogram.hpp"
+
+namespace px4
+{
+
+/**
+ * The histograms are only written by the work queue thread. Other threads (e.g. the shell enabling the
+ * statistics) request a reset, which the work queue thread applies before the next run of the item.
+ */
+struct WorkItemStatistics {
+	px4::atomic<uint32_t> schedule_time{0}; ///< lower 32 bits of the hrt time the item was queued
+	px4::atomic_bool reset_pending{false};
+
+	DurationHistogram latency; ///< schedule to start of Run()
+	DurationHistogram runtime; ///< duration of Run()
+
+	void request_reset() { reset_pending.store(true); }
+
+	/**
+	 * Apply a requested reset (work queue thread only).
+	 */
+	void update_reset()
+	{
+		if (reset_pending.load()) {
+			latency.reset();
+			runtime.reset();
+			reset_pending.store(false);
+		}
+	}
+};
+
+} // namespace px4
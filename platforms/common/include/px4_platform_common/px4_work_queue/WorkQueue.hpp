@@ -37,11 +37,12 @@
 
 #include <containers/BlockingList.hpp>
 #include <containers/List.hpp>
-#include <containers/IntrusiveQueue.hpp>
+#include <containers/IntrusiveMpscQueue.hpp>
 #include <px4_platform_common/atomic.h>
 #include <px4_platform_common/defines.h>
 #include <px4_platform_common/sem.h>
 #include <px4_platform_common/tasks.h>
+#include <drivers/drv_hrt.h>
 
 namespace px4
 {
@@ -56,7 +57,7 @@ public:
 
 	~WorkQueue();
 
-	const char *get_name() { return _config.name; }
+	const char *get_name() const { return _config.name; }
 
 	bool Attach(WorkItem *item);
 	void Detach(WorkItem *item);
@@ -72,25 +73,94 @@ public:
 
 	void print_status(bool last = false);
 
+	/**
+	 * Enable or disable the statistics of all attached WorkItems (and all that attach later).
+	 */
+	void enable_statistics(bool enable);
+
+	/**
+	 * Call func for each attached WorkItem (while holding the list lock).
+	 */
+	void for_each_item(void (*func)(const WorkQueue &wq, const WorkItem &item, void *arg), void *arg);
+
+	/**
+	 * Fraction of time the work queue thread spent running WorkItems since it started.
+	 */
+	float utilization() const;
+
+	hrt_abstime busy_time() const { return _busy_time; }
+
+	int32_t queue_depth_max() const { return _queue_depth_max.load(); }
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	/**
+	 * Number of WorkItems that are scheduled or running, summed over all work queues.
+	 */
+	static int32_t num_active_items() { return _num_active_items.load(); }
+#endif
+
 private:
 
 	bool should_exit() const { return _should_exit.load(); }
 
 	inline void signal_worker_thread();
 
-#ifdef __PX4_NUTTX
-	// In NuttX work can be enqueued from an ISR
-	void work_lock() { _flags = enter_critical_section(); }
-	void work_unlock() { leave_critical_section(_flags); }
-	irqstate_t _flags;
-#else
-	void work_lock() { px4_sem_wait(&_qlock); }
+	/**
+	 * Block the worker thread until signal_worker_thread() is called.
+	 */
+	void wait_for_signal();
+
+	/**
+	 * Pop the next queued WorkItem (worker thread).
+	 */
+	WorkItem *pop();
+
+	/**
+	 * Take over the consumer side of the queue from the worker thread (Remove(), Clear()).
+	 * Called with the work lock held.
+	 */
+	void consumer_claim();
+	void consumer_release() { _consumer_claimed.store(false); }
+
+	// Protects the list of attached items and serializes Remove() and Clear().
+	// Add() is lock-free, so that work can be enqueued from any thread and from an ISR (NuttX).
+	void work_lock() { do {} while (px4_sem_wait(&_qlock) != 0); }
 	void work_unlock() { px4_sem_post(&_qlock); }
 	px4_sem_t _qlock;
-#endif
 
-	IntrusiveQueue<WorkItem *>	_q;
+	IntrusiveMpscQueue<WorkItem *>	_q;
+
+	// Handshake for the consumer side of _q, so that the worker thread does not take the work lock per item:
+	// the worker sets _popping and then checks _consumer_claimed, Remove()/Clear() set _consumer_claimed and
+	// then wait for _popping to clear. The worker only takes the work lock while the consumer side is claimed.
+	px4::atomic_bool		_popping{false};
+	px4::atomic_bool		_consumer_claimed{false};
+
+	px4::atomic_bool		_remove_waiting{false}; // Remove() waits for a push to complete
+	px4_sem_t			_push_done;
+
+	px4::atomic_bool		_sleeping{false}; // worker thread is (about to go) waiting for a signal
+
+#ifdef __PX4_LINUX
+	int				_event_fd{-1};
+#else
 	px4_sem_t			_process_lock;
+#endif /* __PX4_LINUX */
+
+	px4::atomic_int32_t		_queue_depth{0};
+	px4::atomic_int32_t		_queue_depth_max{0};
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	static px4::atomic_int32_t	_num_active_items;
+#endif
+
+	hrt_abstime			_start_time{0};
+	hrt_abstime			_busy_time{0}; // time spent in WorkItem::Run()
+
+	WorkItem			*_running_item{nullptr}; // reset if the item detaches while running (eg deletes itself)
+
+	bool				_statistics_enabled{false};
+
 	const wq_config_t		&_config;
 	BlockingList<WorkItem *>	_work_items;
 	px4::atomic_bool		_should_exit{false};
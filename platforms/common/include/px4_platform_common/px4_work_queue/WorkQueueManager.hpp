@@ -39,11 +39,13 @@ namespace px4
 {
 
 class WorkQueue; // forward declaration
+class WorkItem;
 
 struct wq_config_t {
 	const char *name;
 	uint16_t stacksize;
 	int8_t relative_priority; // relative to max
+	uint32_t cpu_set{0}; // optional CPU affinity bitmask (Linux), 0: any CPU (can be overridden by the WQ_CPU_* parameters)
 };
 
 namespace wq_configurations
@@ -87,6 +89,23 @@ int WorkQueueManagerStop();
  */
 int WorkQueueManagerStatus();
 
+/**
+ * Enable or disable the WorkItem scheduling statistics of all (current and future) work queues.
+ */
+int WorkQueueManagerStatistics(bool enable);
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+/**
+ * Check if no WorkItem is scheduled or running on any work queue.
+ */
+bool WorkQueueManagerIdle();
+#endif
+
+/**
+ * Call func for each WorkItem of all work queues.
+ */
+void WorkQueueManagerForEachItem(void (*func)(const WorkQueue &wq, const WorkItem &item, void *arg), void *arg);
+
 /**
  * Create (or find) a work queue with a particular configuration.
  *
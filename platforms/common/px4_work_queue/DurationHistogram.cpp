@@ -0,0 +1,112 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <px4_platform_common/px4_work_queue/DurationHistogram.hpp>
+
+#include <string.h>
+
+namespace px4
+{
+
+static inline uint32_t atomic_add(uint32_t *value, uint32_t num)
+{
+	return __atomic_fetch_add(value, num, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_max(uint32_t *value, uint32_t sample)
+{
+	uint32_t current = __atomic_load_n(value, __ATOMIC_RELAXED);
+
+	while ((sample > current) && !__atomic_compare_exchange_n(value, &current, sample, true, __ATOMIC_RELAXED,
+			__ATOMIC_RELAXED)) {
+	}
+}
+
+void DurationHistogram::reset()
+{
+	count = 0;
+	sum_low = 0;
+	sum_high = 0;
+	max = 0;
+	memset(bins, 0, sizeof(bins));
+}
+
+void DurationHistogram::record(uint32_t duration_us)
+{
+	int bin = 0;
+
+	while ((bin < BINS - 1) && (duration_us >= (2u << bin))) {
+		++bin;
+	}
+
+	atomic_add(&bins[bin], 1);
+	atomic_add(&count, 1);
+
+	// a 32 bit sum wraps after ~71 minutes of accumulated time
+	const uint32_t sum_low_prev = atomic_add(&sum_low, duration_us);
+
+	if (sum_low_prev + duration_us < sum_low_prev) {
+		atomic_add(&sum_high, 1);
+	}
+
+	atomic_max(&max, duration_us);
+}
+
+uint32_t DurationHistogram::percentile(float percentile) const
+{
+	uint32_t total = 0;
+
+	for (int i = 0; i < BINS; i++) {
+		total += bins[i];
+	}
+
+	if (total == 0) {
+		return 0;
+	}
+
+	const uint32_t threshold = percentile * total;
+	uint32_t n = 0;
+
+	for (int i = 0; i < BINS - 1; i++) {
+		n += bins[i];
+
+		if (n > threshold) {
+			// the max is a tighter bound for the bin containing it
+			return (max < (2u << i)) ? max : (2u << i);
+		}
+	}
+
+	return max;
+}
+
+} // namespace px4
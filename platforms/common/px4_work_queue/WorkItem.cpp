@@ -39,6 +39,8 @@
 #include <px4_platform_common/log.h>
 #include <drivers/drv_hrt.h>
 
+#include <inttypes.h>
+
 namespace px4
 {
 
@@ -53,6 +55,8 @@ WorkItem::WorkItem(const char *name, const wq_config_t &config) :
 WorkItem::~WorkItem()
 {
 	Deinit();
+
+	delete _statistics;
 }
 
 bool
@@ -125,4 +129,38 @@ WorkItem::print_run_status() const
 	PX4_INFO_RAW("%-24s %8.1f Hz %12.1f us\n", _item_name, (double)average_rate(), (double)average_interval());
 }
 
+void
+WorkItem::print_statistics() const
+{
+	const WorkItemStatistics *stats = statistics();
+
+	if (stats != nullptr) {
+		PX4_INFO_RAW("latency p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 " us, run time p50/p99/max: %" PRIu32 "/%" PRIu32
+			     "/%" PRIu32 " us\n",
+			     stats->latency.percentile(0.5f), stats->latency.percentile(0.99f), stats->latency.max,
+			     stats->runtime.percentile(0.5f), stats->runtime.percentile(0.99f), stats->runtime.max);
+	}
+}
+
+void
+WorkItem::enable_statistics(bool enable)
+{
+	if (enable) {
+		if (_statistics == nullptr) {
+			_statistics = new WorkItemStatistics();
+
+			if (_statistics == nullptr) {
+				PX4_ERR("%s: statistics alloc failed", _item_name);
+				return;
+			}
+
+		} else if (!_statistics_enabled) {
+			// the work queue thread might still be recording, let it do the reset
+			_statistics->request_reset();
+		}
+	}
+
+	_statistics_enabled = enable && (_statistics != nullptr);
+}
+
 } // namespace px4
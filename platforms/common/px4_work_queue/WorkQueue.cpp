@@ -34,7 +34,14 @@
 #include <px4_platform_common/px4_work_queue/WorkQueue.hpp>
 #include <px4_platform_common/px4_work_queue/WorkItem.hpp>
 
+#include <errno.h>
+#include <inttypes.h>
 #include <string.h>
+#include <unistd.h>
+
+#ifdef __PX4_LINUX
+#include <sys/eventfd.h>
+#endif /* __PX4_LINUX */
 
 #include <px4_platform_common/tasks.h>
 #include <px4_platform_common/time.h>
@@ -43,6 +50,10 @@
 namespace px4
 {
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+px4::atomic_int32_t WorkQueue::_num_active_items {0};
+#endif
+
 WorkQueue::WorkQueue(const wq_config_t &config) :
 	_config(config)
 {
@@ -53,23 +64,43 @@ WorkQueue::WorkQueue(const wq_config_t &config) :
 	pthread_setname_np(pthread_self(), _config.name);
 #endif
 
-#ifndef __PX4_NUTTX
 	px4_sem_init(&_qlock, 0, 1);
-#endif /* __PX4_NUTTX */
 
+	px4_sem_init(&_push_done, 0, 0);
+	px4_sem_setprotocol(&_push_done, SEM_PRIO_NONE);
+
+	_start_time = hrt_absolute_time();
+
+#ifdef __PX4_LINUX
+	_event_fd = eventfd(0, EFD_CLOEXEC);
+
+	if (_event_fd < 0) {
+		PX4_ERR("%s: eventfd failed (%i)", _config.name, errno);
+	}
+
+#else
 	px4_sem_init(&_process_lock, 0, 0);
 	px4_sem_setprotocol(&_process_lock, SEM_PRIO_NONE);
+#endif /* __PX4_LINUX */
 }
 
 WorkQueue::~WorkQueue()
 {
 	work_lock();
+#ifdef __PX4_LINUX
+
+	if (_event_fd >= 0) {
+		close(_event_fd);
+		_event_fd = -1;
+	}
+
+#else
 	px4_sem_destroy(&_process_lock);
+#endif /* __PX4_LINUX */
 	work_unlock();
 
-#ifndef __PX4_NUTTX
+	px4_sem_destroy(&_push_done);
 	px4_sem_destroy(&_qlock);
-#endif /* __PX4_NUTTX */
 }
 
 bool
@@ -79,6 +110,7 @@ WorkQueue::Attach(WorkItem *item)
 
 	if (!should_exit()) {
 		_work_items.add(item);
+		item->enable_statistics(_statistics_enabled);
 		work_unlock();
 		return true;
 	}
@@ -94,6 +126,11 @@ WorkQueue::Detach(WorkItem *item)
 
 	_work_items.remove(item);
 
+	if (item == _running_item) {
+		// the item is destroyed from within its Run()
+		_running_item = nullptr;
+	}
+
 	if (_work_items.size() == 0) {
 		// shutdown, no active WorkItems
 		PX4_DEBUG("stopping: %s, last active WorkItem closing", _config.name);
@@ -108,20 +145,96 @@ WorkQueue::Detach(WorkItem *item)
 void
 WorkQueue::Add(WorkItem *item)
 {
-	work_lock();
-	_q.push(item);
-	work_unlock();
+	WorkItemStatistics *statistics = item->_statistics_enabled ? item->_statistics : nullptr;
+
+	if ((statistics != nullptr) && !_q.queued(item)) {
+		statistics->schedule_time.store(hrt_absolute_time());
+	}
+
+	// lock-free, safe from any thread or interrupt
+	if (_q.push(item)) {
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+		_num_active_items.fetch_add(1);
+#endif
+		const int32_t depth = _queue_depth.fetch_add(1) + 1;
+		int32_t depth_max = _queue_depth_max.load();
+
+		while ((depth > depth_max) && !_queue_depth_max.compare_exchange(&depth_max, depth)) {}
+
+		signal_worker_thread();
 
-	signal_worker_thread();
+		// wake up a Remove() that waits for a push to complete
+		if (_remove_waiting.load()) {
+			px4_sem_post(&_push_done);
+		}
+	}
 }
 
 void
 WorkQueue::signal_worker_thread()
 {
-	int sem_val;
+	// only wake the worker thread if it's (about to go) waiting, so a busy queue doesn't pay for a syscall per item
+	if (_sleeping.load() && _sleeping.exchange(false)) {
+#ifdef __PX4_LINUX
+		const uint64_t value = 1;
 
-	if (px4_sem_getvalue(&_process_lock, &sem_val) == 0 && sem_val <= 0) {
+		while (write(_event_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+
+#else
 		px4_sem_post(&_process_lock);
+#endif /* __PX4_LINUX */
+	}
+}
+
+void
+WorkQueue::wait_for_signal()
+{
+#ifdef __PX4_LINUX
+	uint64_t value = 0;
+
+	while (read(_event_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+
+#else
+	px4_sem_wait(&_process_lock);
+#endif /* __PX4_LINUX */
+}
+
+WorkItem *
+WorkQueue::pop()
+{
+	WorkItem *work = nullptr;
+
+	_popping.store(true);
+
+	if (!_consumer_claimed.load()) {
+		// fast path: no Remove() or Clear() in progress (and none can start until _popping is cleared)
+		work = _q.pop();
+		_popping.store(false);
+
+	} else {
+		// wait for the Remove() or Clear() to finish
+		_popping.store(false);
+		work_lock();
+		work = _q.pop();
+		work_unlock();
+	}
+
+	if (work != nullptr) {
+		_queue_depth.fetch_sub(1);
+	}
+
+	return work;
+}
+
+void
+WorkQueue::consumer_claim()
+{
+	_consumer_claimed.store(true);
+
+	// a pop() that started before the claim is short and non-blocking, but the worker thread might have a lower
+	// priority, so sleep rather than spin (not px4_usleep(), the lockstep time might not advance meanwhile)
+	while (_popping.load()) {
+		system_usleep(100);
 	}
 }
 
@@ -129,7 +242,31 @@ void
 WorkQueue::Remove(WorkItem *item)
 {
 	work_lock();
-	_q.remove(item);
+	consumer_claim();
+
+	// A concurrent Add() of this item may still be in progress, in which case it can't be unlinked yet.
+	// Producers post _push_done after completing a push while _remove_waiting is set (either the producer sees
+	// the flag, or remove() sees the completed push).
+	_remove_waiting.store(true);
+
+	while (_q.queued(item)) {
+		if (_q.remove(item)) {
+			_queue_depth.fetch_sub(1);
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			_num_active_items.fetch_sub(1);
+#endif
+			break;
+		}
+
+		px4_sem_wait(&_push_done);
+	}
+
+	_remove_waiting.store(false);
+
+	// drop the posts of other pushes, a late one only causes a spurious wakeup of the next Remove()
+	while (px4_sem_trywait(&_push_done) == 0) {}
+
+	consumer_release();
 	work_unlock();
 }
 
@@ -137,11 +274,16 @@ void
 WorkQueue::Clear()
 {
 	work_lock();
+	consumer_claim();
 
-	while (!_q.empty()) {
-		_q.pop();
+	while (_q.pop() != nullptr) {
+		_queue_depth.fetch_sub(1);
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+		_num_active_items.fetch_sub(1);
+#endif
 	}
 
+	consumer_release();
 	work_unlock();
 }
 
@@ -149,31 +291,96 @@ void
 WorkQueue::Run()
 {
 	while (!should_exit()) {
-		px4_sem_wait(&_process_lock);
+		WorkItem *work = pop();
 
-		work_lock();
+		if (work == nullptr) {
+			// announce that we're going to sleep, then check again to not miss an Add() that raced with the first pop()
+			_sleeping.store(true);
+			work = pop();
+
+			if (work == nullptr) {
+				if (!should_exit()) {
+					wait_for_signal();
+				}
 
-		// process queued work
-		while (!_q.empty()) {
-			WorkItem *work = _q.pop();
+				_sleeping.store(false);
+				continue;
+			}
 
-			work_unlock(); // unlock work queue to run (item may requeue itself)
-			work->RunPreamble();
-			work->Run();
-			work_lock(); // re-lock
+			_sleeping.store(false);
 		}
 
-		work_unlock();
+		const hrt_abstime start = hrt_absolute_time();
+		WorkItemStatistics *statistics = work->_statistics_enabled ? work->_statistics : nullptr;
+
+		if (statistics != nullptr) {
+			statistics->update_reset();
+			statistics->latency.record((uint32_t)start - statistics->schedule_time.load());
+		}
+
+		_running_item = work;
+		work->RunPreamble();
+		work->Run();
+
+		const hrt_abstime elapsed = hrt_elapsed_time(&start);
+		_busy_time += elapsed;
+
+		if ((statistics != nullptr) && (_running_item != nullptr)) {
+			statistics->runtime.record(elapsed);
+		}
+
+		_running_item = nullptr;
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+		// only now the item is done (it might have scheduled others in the meantime)
+		_num_active_items.fetch_sub(1);
+#endif
 	}
 
 	PX4_DEBUG("%s: exiting", _config.name);
 }
 
+void
+WorkQueue::enable_statistics(bool enable)
+{
+	work_lock();
+	_statistics_enabled = enable;
+
+	for (WorkItem *item : _work_items) {
+		item->enable_statistics(enable);
+	}
+
+	work_unlock();
+}
+
+void
+WorkQueue::for_each_item(void (*func)(const WorkQueue &wq, const WorkItem &item, void *arg), void *arg)
+{
+	auto lg = _work_items.getLockGuard();
+
+	for (WorkItem *item : _work_items) {
+		func(*this, *item, arg);
+	}
+}
+
+float
+WorkQueue::utilization() const
+{
+	const hrt_abstime elapsed = hrt_elapsed_time(&_start_time);
+
+	if (elapsed > 0) {
+		return (float)_busy_time / elapsed;
+	}
+
+	return 0.f;
+}
+
 void
 WorkQueue::print_status(bool last)
 {
 	const size_t num_items = _work_items.size();
-	PX4_INFO_RAW("%-16s\n", get_name());
+	PX4_INFO_RAW("%-16s %5.1f%% busy, max queue depth: %" PRIi32 "\n", get_name(), (double)(utilization() * 100.f),
+		     queue_depth_max());
 	size_t i = 0;
 
 	for (WorkItem *item : _work_items) {
@@ -194,6 +401,12 @@ WorkQueue::print_status(bool last)
 		}
 
 		item->print_run_status();
+
+		if (item->statistics() != nullptr) {
+			PX4_INFO_RAW(last ? "    " : "|   ");
+			PX4_INFO_RAW((i < num_items) ? "|        " : "         ");
+			item->print_statistics();
+		}
 	}
 }
 
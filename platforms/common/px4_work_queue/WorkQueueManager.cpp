@@ -44,6 +44,7 @@
 #include <containers/BlockingQueue.hpp>
 #include <lib/drivers/device/Device.hpp>
 #include <lib/mathlib/mathlib.h>
+#include <parameters/param.h>
 
 #include <limits.h>
 #include <string.h>
@@ -61,6 +62,8 @@ static BlockingQueue<const wq_config_t *, 1> *_wq_manager_create_queue{nullptr};
 
 static px4::atomic_bool _wq_manager_should_exit{true};
 
+static px4::atomic_bool _wq_manager_statistics_enabled{false};
+
 
 static WorkQueue *
 FindWorkQueueByName(const char *name)
@@ -158,11 +161,76 @@ device_bus_to_wq(uint32_t device_id_int)
 	return wq_configurations::hp_default;
 };
 
+#ifdef __PX4_LINUX
+// work queues (by name prefix) that can be pinned with a parameter
+static constexpr struct {
+	const char *name_prefix;
+	const char *param_name;
+} wq_cpu_set_params[] {
+	{"wq:rate_ctrl", "WQ_CPU_RATE_CTRL"},
+	{"wq:SPI", "WQ_CPU_SENSORS"},
+	{"wq:I2C", "WQ_CPU_SENSORS"},
+	{"wq:att_pos_ctrl", "WQ_CPU_ATT_POS"},
+	{"wq:hp_default", "WQ_CPU_HP"},
+	{"wq:lp_default", "WQ_CPU_LP"},
+};
+
+static int32_t
+param_get_int32(const char *name)
+{
+	int32_t value = 0;
+	param_t handle = param_find(name);
+
+	if ((handle == PARAM_INVALID) || (param_get(handle, &value) != PX4_OK)) {
+		return 0;
+	}
+
+	return value;
+}
+
+/**
+ * Get the CPU affinity of a work queue.
+ *
+ * @return CPU bitmask (only online CPUs), 0 to not change the affinity
+ */
+static uint32_t
+WorkQueueCpuSet(const wq_config_t &wq)
+{
+	const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_cpus <= 1) {
+		return 0;
+	}
+
+	const uint32_t online = (num_cpus >= 32) ? UINT32_MAX : ((1u << num_cpus) - 1);
+
+	uint32_t cpu_set = wq.cpu_set;
+	uint32_t pinned = wq.cpu_set;
+
+	for (const auto &p : wq_cpu_set_params) {
+		const uint32_t param_cpu_set = param_get_int32(p.param_name);
+		pinned |= param_cpu_set;
+
+		if ((param_cpu_set != 0) && (strncmp(wq.name, p.name_prefix, strlen(p.name_prefix)) == 0)) {
+			cpu_set = param_cpu_set;
+		}
+	}
+
+	if ((cpu_set == 0) && (param_get_int32("WQ_CPU_ISOLATE") == 1)) {
+		// keep off the CPUs of the pinned queues
+		cpu_set = online & ~pinned;
+	}
+
+	return cpu_set & online;
+}
+#endif /* __PX4_LINUX */
+
 static void *
 WorkQueueRunner(void *context)
 {
 	wq_config_t *config = static_cast<wq_config_t *>(context);
 	WorkQueue wq(*config);
+	wq.enable_statistics(_wq_manager_statistics_enabled.load());
 
 	// add to work queue list
 	_wq_manager_wqs_list->add(&wq);
@@ -224,6 +292,36 @@ WorkQueueManagerRun(int, char **)
 
 #endif // ! QuRT
 
+#ifdef __PX4_LINUX
+			// by default a new thread inherits the policy and priority of the wq:manager task
+			int ret_setinheritsched = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+
+			if (ret_setinheritsched != 0) {
+				PX4_ERR("failed to set inherit sched for %s (%i)", wq->name, ret_setinheritsched);
+			}
+
+			// CPU affinity
+			const uint32_t cpu_set = WorkQueueCpuSet(*wq);
+
+			if (cpu_set != 0) {
+				cpu_set_t cpuset;
+				CPU_ZERO(&cpuset);
+
+				for (int cpu = 0; cpu < 32; cpu++) {
+					if (cpu_set & (1u << cpu)) {
+						CPU_SET(cpu, &cpuset);
+					}
+				}
+
+				int ret_setaffinity = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+
+				if (ret_setaffinity != 0) {
+					PX4_ERR("setting CPU affinity for %s failed (%i)", wq->name, ret_setaffinity);
+				}
+			}
+
+#endif /* __PX4_LINUX */
+
 			// priority
 			param.sched_priority = sched_get_priority_max(SCHED_FIFO) + wq->relative_priority;
 			int ret_setschedparam = pthread_attr_setschedparam(&attr, &param);
@@ -236,6 +334,17 @@ WorkQueueManagerRun(int, char **)
 			pthread_t thread;
 			int ret_create = pthread_create(&thread, &attr, WorkQueueRunner, (void *)wq);
 
+#ifdef __PX4_LINUX
+
+			if (ret_create == EPERM) {
+				// not allowed to run realtime threads (not root), fall back to the inherited policy, keep the affinity
+				PX4_WARN("%s: no permission for SCHED_FIFO", wq->name);
+				pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+				ret_create = pthread_create(&thread, &attr, WorkQueueRunner, (void *)wq);
+			}
+
+#endif /* __PX4_LINUX */
+
 			if (ret_create == 0) {
 				PX4_DEBUG("starting: %s, priority: %d, stack: %zu bytes", wq->name, param.sched_priority, stacksize);
 
@@ -367,4 +476,45 @@ WorkQueueManagerStatus()
 	return PX4_OK;
 }
 
+int
+WorkQueueManagerStatistics(bool enable)
+{
+	if (_wq_manager_should_exit.load() || (_wq_manager_wqs_list == nullptr)) {
+		PX4_INFO("not running");
+		return PX4_ERROR;
+	}
+
+	_wq_manager_statistics_enabled.store(enable);
+
+	auto lg = _wq_manager_wqs_list->getLockGuard();
+
+	for (WorkQueue *wq : *_wq_manager_wqs_list) {
+		wq->enable_statistics(enable);
+	}
+
+	return PX4_OK;
+}
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+bool
+WorkQueueManagerIdle()
+{
+	return WorkQueue::num_active_items() == 0;
+}
+#endif
+
+void
+WorkQueueManagerForEachItem(void (*func)(const WorkQueue &wq, const WorkItem &item, void *arg), void *arg)
+{
+	if (_wq_manager_should_exit.load() || (_wq_manager_wqs_list == nullptr)) {
+		return;
+	}
+
+	auto lg = _wq_manager_wqs_list->getLockGuard();
+
+	for (WorkQueue *wq : *_wq_manager_wqs_list) {
+		wq->for_each_item(func, arg);
+	}
+}
+
 } // namespace px4
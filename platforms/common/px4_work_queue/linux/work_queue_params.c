@@ -0,0 +1,123 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file work_queue_params.c
+ *
+ * Work queue thread CPU affinity.
+ *
+ * Only part of the parameter set on Linux (see ../CMakeLists.txt).
+ */
+
+/**
+ * CPU affinity of wq:rate_ctrl
+ *
+ * Bitmask of the CPUs the inner loop work queue thread is allowed to run on.
+ * 0 leaves the affinity unchanged, CPUs that are not online are ignored.
+ * The other WQ_CPU_* parameters use the same format.
+ *
+ * @bit 0 CPU 0
+ * @bit 1 CPU 1
+ * @bit 2 CPU 2
+ * @bit 3 CPU 3
+ * @bit 4 CPU 4
+ * @bit 5 CPU 5
+ * @bit 6 CPU 6
+ * @bit 7 CPU 7
+ * @min 0
+ * @max 255
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_RATE_CTRL, 0);
+
+/**
+ * CPU affinity of the sensor bus work queues (wq:SPIx and wq:I2Cx)
+ *
+ * See WQ_CPU_RATE_CTRL.
+ *
+ * @min 0
+ * @max 255
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_SENSORS, 0);
+
+/**
+ * CPU affinity of wq:att_pos_ctrl
+ *
+ * See WQ_CPU_RATE_CTRL.
+ *
+ * @min 0
+ * @max 255
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_ATT_POS, 0);
+
+/**
+ * CPU affinity of wq:hp_default
+ *
+ * See WQ_CPU_RATE_CTRL.
+ *
+ * @min 0
+ * @max 255
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_HP, 0);
+
+/**
+ * CPU affinity of wq:lp_default
+ *
+ * See WQ_CPU_RATE_CTRL.
+ *
+ * @min 0
+ * @max 255
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_LP, 0);
+
+/**
+ * Isolate pinned work queues
+ *
+ * If enabled, work queue threads without a configured CPU affinity are kept off
+ * all CPUs that are configured for any of the WQ_CPU_* work queues, so that
+ * the pinned queues don't share their CPUs with other work queues.
+ *
+ * @boolean
+ * @reboot_required true
+ * @group System
+ */
+PARAM_DEFINE_INT32(WQ_CPU_ISOLATE, 0);
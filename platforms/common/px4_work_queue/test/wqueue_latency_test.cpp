@@ -0,0 +1,75 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "wqueue_latency_test.h"
+
+#include <px4_platform_common/log.h>
+#include <px4_platform_common/time.h>
+
+#include <inttypes.h>
+
+void WQueueLatencyTest::Run()
+{
+	const hrt_abstime latency = hrt_absolute_time() - _schedule_time;
+
+	if (latency < _latency_min) {
+		_latency_min = latency;
+	}
+
+	if (latency > _latency_max) {
+		_latency_max = latency;
+	}
+
+	_latency_sum += latency;
+
+	_ran.store(true);
+}
+
+int WQueueLatencyTest::main()
+{
+	for (int i = 0; i < ITERATIONS; i++) {
+		_ran.store(false);
+		_schedule_time = hrt_absolute_time();
+		ScheduleNow();
+
+		// wait for the work queue thread (it goes back to sleep in between)
+		while (!_ran.load()) {
+			px4_usleep(100);
+		}
+	}
+
+	PX4_INFO("WQueueLatencyTest finished: %d iterations, schedule latency min: %" PRIu64 " us, avg: %.1f us, max: %" PRIu64
+		 " us", ITERATIONS, _latency_min, (double)_latency_sum / ITERATIONS, _latency_max);
+
+	return 0;
+}
@@ -31,6 +31,7 @@
  *
  ****************************************************************************/
 
+#include "wqueue_latency_test.h"
 #include "wqueue_test.h"
 #include "wqueue_scheduled_test.h"
 
@@ -51,6 +52,10 @@ int PX4_MAIN(int argc, char **argv)
 	WQueueScheduledTest wq2;
 	wq2.main();
 
+	PX4_INFO("wqueue test 3 (schedule latency)");
+	WQueueLatencyTest wq3;
+	wq3.main();
+
 	PX4_INFO("wqueue test complete, exiting");
 
 	return 0;
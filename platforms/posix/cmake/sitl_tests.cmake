@@ -15,6 +15,7 @@ set(tests
 	float
 	hrt
 	int
+	IntrusiveMpscQueue
 	IntrusiveQueue
 	List
 	mathlib
@@ -45,6 +45,7 @@
 #include <drivers/drv_hrt.h>
 #include <semaphore.h>
 #include <time.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include "hrt_work.h"
@@ -57,7 +58,17 @@
 static constexpr unsigned HRT_INTERVAL_MIN = 50;
 static constexpr unsigned HRT_INTERVAL_MAX = 50000000;
 
-static struct sq_queue_s	callout_queue;
+/*
+ * Pending callouts, a binary min-heap ordered by deadline (insert, cancel: O(log n)).
+ * Each entry keeps its position in heap_index. Equal deadlines are ordered by heap_sequence,
+ * so that they fire in insertion order (deterministic with lockstep).
+ */
+static struct hrt_call	**callout_heap = nullptr;
+static unsigned		callout_heap_size = 0;
+static unsigned		callout_heap_capacity = 0;
+static uint64_t		callout_heap_sequence = 0;
+static constexpr unsigned CALLOUT_HEAP_INITIAL_CAPACITY = 64;
+
 static px4_sem_t 	_hrt_lock;
 static struct work_s	_hrt_work;
 
@@ -69,11 +80,25 @@ static int32_t dsp_offset = 0;
 
 #if defined(ENABLE_LOCKSTEP_SCHEDULER)
 static LockstepScheduler *lockstep_scheduler = new LockstepScheduler();
+
+// callout state for hrt_callouts_idle() (protected by _hrt_lock)
+static bool callout_running = false;
+static uint32_t callout_invocations = 0;
+
+// tasks registered with px4_lockstep_register_component(). The idle callbacks are called with the lock held,
+// so that unregistering waits for a running check.
+static constexpr int MAX_LOCKSTEP_COMPONENTS = 8;
+static struct {
+	bool (*idle)(void *arg);
+	void *arg;
+} lockstep_components[MAX_LOCKSTEP_COMPONENTS] {};
+static pthread_mutex_t lockstep_components_lock = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
 
 static void hrt_call_reschedule();
 static void hrt_call_invoke();
+static void hrt_call_remove(struct hrt_call *entry);
 
 hrt_abstime hrt_absolute_time_offset()
 {
@@ -239,7 +264,7 @@ bool	hrt_called(struct hrt_call *entry)
 void	hrt_cancel(struct hrt_call *entry)
 {
 	hrt_lock();
-	sq_rem(&entry->link, &callout_queue);
+	hrt_call_remove(entry);
 	entry->deadline = 0;
 
 	/* if this is a periodic call being removed by the callout, prevent it from
@@ -275,7 +300,7 @@ void	hrt_call_delay(struct hrt_call *entry, hrt_abstime delay)
  */
 void	hrt_init()
 {
-	sq_init(&callout_queue);
+	callout_heap_size = 0;
 
 	int sem_ret = px4_sem_init(&_hrt_lock, 0, 1);
 
@@ -286,33 +311,130 @@ void	hrt_init()
 	memset(&_hrt_work, 0, sizeof(_hrt_work));
 }
 
+static inline void
+callout_heap_set(unsigned index, struct hrt_call *entry)
+{
+	callout_heap[index] = entry;
+	entry->heap_index = index;
+}
+
+static inline bool
+callout_heap_before(const struct hrt_call *a, const struct hrt_call *b)
+{
+	return (a->deadline < b->deadline) || ((a->deadline == b->deadline) && (a->heap_sequence < b->heap_sequence));
+}
+
 static void
-hrt_call_enter(struct hrt_call *entry)
+callout_heap_sift_up(unsigned index)
 {
-	struct hrt_call	*call, *next;
+	struct hrt_call *entry = callout_heap[index];
 
-	//PX4_INFO("hrt_call_enter");
-	call = (struct hrt_call *)sq_peek(&callout_queue);
+	while (index > 0) {
+		const unsigned parent = (index - 1) / 2;
 
-	if ((call == nullptr) || (entry->deadline < call->deadline)) {
-		sq_addfirst(&entry->link, &callout_queue);
-		//if (call != nullptr) PX4_INFO("call enter at head, reschedule (%lu %lu)", entry->deadline, call->deadline);
-		/* we changed the next deadline, reschedule the timer event */
-		hrt_call_reschedule();
+		if (!callout_heap_before(entry, callout_heap[parent])) {
+			break;
+		}
 
-	} else {
-		do {
-			next = (struct hrt_call *)sq_next(&call->link);
+		callout_heap_set(index, callout_heap[parent]);
+		index = parent;
+	}
 
-			if ((next == nullptr) || (entry->deadline < next->deadline)) {
-				//lldbg("call enter after head\n");
-				sq_addafter(&call->link, &entry->link, &callout_queue);
-				break;
-			}
-		} while ((call = next) != nullptr);
+	callout_heap_set(index, entry);
+}
+
+static void
+callout_heap_sift_down(unsigned index)
+{
+	struct hrt_call *entry = callout_heap[index];
+
+	while (true) {
+		unsigned child = 2 * index + 1;
+
+		if (child >= callout_heap_size) {
+			break;
+		}
+
+		if ((child + 1 < callout_heap_size) && callout_heap_before(callout_heap[child + 1], callout_heap[child])) {
+			child++;
+		}
+
+		if (!callout_heap_before(callout_heap[child], entry)) {
+			break;
+		}
+
+		callout_heap_set(index, callout_heap[child]);
+		index = child;
 	}
 
-	//PX4_INFO("scheduled");
+	callout_heap_set(index, entry);
+}
+
+static inline struct hrt_call *
+callout_heap_peek()
+{
+	return (callout_heap_size > 0) ? callout_heap[0] : nullptr;
+}
+
+/*
+ * Remove the entry from the callout heap (if queued).
+ *
+ * The entry might never have been queued (uninitialized heap_index), so
+ * it is only removed if it's actually found at its index.
+ */
+static void
+hrt_call_remove(struct hrt_call *entry)
+{
+	const unsigned index = entry->heap_index;
+
+	if ((index >= callout_heap_size) || (callout_heap[index] != entry)) {
+		return;
+	}
+
+	struct hrt_call *last = callout_heap[--callout_heap_size];
+
+	if (last != entry) {
+		callout_heap_set(index, last);
+
+		if ((index > 0) && callout_heap_before(last, callout_heap[(index - 1) / 2])) {
+			callout_heap_sift_up(index);
+
+		} else {
+			callout_heap_sift_down(index);
+		}
+	}
+}
+
+static void
+hrt_call_enter(struct hrt_call *entry)
+{
+	// never queue an entry twice (eg. rescheduled from another thread while its callout was running)
+	hrt_call_remove(entry);
+
+	if (callout_heap_size >= callout_heap_capacity) {
+		const unsigned capacity = (callout_heap_capacity > 0) ? 2 * callout_heap_capacity : CALLOUT_HEAP_INITIAL_CAPACITY;
+		struct hrt_call **heap = (struct hrt_call **)realloc(callout_heap, capacity * sizeof(struct hrt_call *));
+
+		if (heap == nullptr) {
+			PX4_ERR("callout heap alloc failed");
+			entry->deadline = 0;
+			return;
+		}
+
+		callout_heap = heap;
+		callout_heap_capacity = capacity;
+	}
+
+	const struct hrt_call *first = callout_heap_peek();
+
+	entry->heap_sequence = callout_heap_sequence++;
+	callout_heap_set(callout_heap_size++, entry);
+	callout_heap_sift_up(entry->heap_index);
+
+	if ((first == nullptr) || (entry->deadline < first->deadline)) {
+		/* we changed the next deadline, reschedule the timer event */
+		hrt_call_reschedule();
+	}
 }
 
 /**
@@ -346,7 +468,7 @@ hrt_call_reschedule()
 {
 	hrt_abstime	now = hrt_absolute_time();
 	hrt_abstime	delay = HRT_INTERVAL_MAX;
-	struct hrt_call	*next = (struct hrt_call *)sq_peek(&callout_queue);
+	struct hrt_call	*next = callout_heap_peek();
 	hrt_abstime	deadline = now + HRT_INTERVAL_MAX;
 
 	//PX4_INFO("hrt_call_reschedule");
@@ -394,14 +516,11 @@ hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime inte
 	//PX4_INFO("hrt_call_internal after lock");
 	/* if the entry is currently queued, remove it */
 	/* note that we are using a potentially uninitialised
-	   entry->link here, but it is safe as sq_rem() doesn't
-	   dereference the passed node unless it is found in the
-	   list. So we potentially waste a bit of time searching the
-	   queue for the uninitialised entry->link but we don't do
-	   anything actually unsafe.
+	   entry->heap_index here, but it is safe as hrt_call_remove()
+	   checks that the entry is actually found at that index.
 	*/
 	if (entry->deadline != 0) {
-		sq_rem(&entry->link, &callout_queue);
+		hrt_call_remove(entry);
 	}
 
 #if 1
@@ -473,7 +592,7 @@ hrt_call_invoke()
 		/* get the current time */
 		hrt_abstime now = hrt_absolute_time();
 
-		call = (struct hrt_call *)sq_peek(&callout_queue);
+		call = callout_heap_peek();
 
 		if (call == nullptr) {
 			break;
@@ -483,7 +602,7 @@ hrt_call_invoke()
 			break;
 		}
 
-		sq_rem(&call->link, &callout_queue);
+		hrt_call_remove(call);
 		//PX4_INFO("call pop");
 
 		/* save the intended deadline for periodic calls */
@@ -494,6 +613,10 @@ hrt_call_invoke()
 
 		/* invoke the callout (if there is one) */
 		if (call->callout) {
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			callout_running = true;
+			++callout_invocations;
+#endif
 			// Unlock so we don't deadlock in callback
 			hrt_unlock();
 
@@ -501,6 +624,9 @@ hrt_call_invoke()
 			call->callout(call->arg);
 
 			hrt_lock();
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			callout_running = false;
+#endif
 		}
 
 		/* if the callout has a non-zero period, it has to be re-entered */
@@ -597,6 +723,59 @@ unsigned int px4_sleep(unsigned int seconds)
 	return lockstep_scheduler->usleep_until(time_finished);
 }
 
+bool hrt_callouts_idle(uint32_t *invocations)
+{
+	hrt_lock();
+	const struct hrt_call *next = callout_heap_peek();
+	const bool idle = !callout_running && (next == nullptr || next->deadline > hrt_absolute_time());
+	*invocations = callout_invocations;
+	hrt_unlock();
+	return idle;
+}
+
+int px4_lockstep_register_component(bool (*idle)(void *arg), void *arg)
+{
+	int component = -1;
+	pthread_mutex_lock(&lockstep_components_lock);
+
+	for (int i = 0; i < MAX_LOCKSTEP_COMPONENTS; i++) {
+		if (lockstep_components[i].idle == nullptr) {
+			lockstep_components[i].idle = idle;
+			lockstep_components[i].arg = arg;
+			component = i;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&lockstep_components_lock);
+	return component;
+}
+
+void px4_lockstep_unregister_component(int component)
+{
+	if (component >= 0 && component < MAX_LOCKSTEP_COMPONENTS) {
+		pthread_mutex_lock(&lockstep_components_lock);
+		lockstep_components[component].idle = nullptr;
+		lockstep_components[component].arg = nullptr;
+		pthread_mutex_unlock(&lockstep_components_lock);
+	}
+}
+
+bool px4_lockstep_components_idle()
+{
+	bool idle = true;
+	pthread_mutex_lock(&lockstep_components_lock);
+
+	for (int i = 0; i < MAX_LOCKSTEP_COMPONENTS && idle; i++) {
+		if (lockstep_components[i].idle != nullptr) {
+			idle = lockstep_components[i].idle(lockstep_components[i].arg);
+		}
+	}
+
+	pthread_mutex_unlock(&lockstep_components_lock);
+	return idle;
+}
+
 int px4_pthread_cond_timedwait(pthread_cond_t *cond,
 			       pthread_mutex_t *mutex,
 			       const struct timespec *ts)
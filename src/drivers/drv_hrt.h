@@ -76,6 +76,10 @@ typedef struct hrt_call {
 	hrt_abstime		period;
 	hrt_callout		callout;
 	void			*arg;
+#if defined(__PX4_POSIX)
+	unsigned		heap_index;	/* position in the POSIX callout heap (valid while queued) */
+	uint64_t		heap_sequence;	/* insertion order in the POSIX callout heap, orders equal deadlines */
+#endif
 } *hrt_call_t;
 
 /**
@@ -129,6 +133,36 @@ __EXPORT extern hrt_abstime hrt_store_absolute_time(volatile hrt_abstime *now);
 __EXPORT extern int hrt_set_absolute_time_offset(int32_t time_diff_us);
 #endif
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+/**
+ * Check if all callouts that are due have been invoked. The time only advances with
+ * px4_clock_settime(), so this can be used to wait until the timers are handled.
+ * @param invocations returns the number of callout invocations since startup
+ * @return true if no callout is due or currently running
+ */
+__EXPORT extern bool hrt_callouts_idle(uint32_t *invocations);
+
+/**
+ * Register a task that runs neither on a work queue nor as a callout (e.g. the logger), so that
+ * px4_lockstep_components_idle() can tell if it still has work to do for the current time.
+ * @param idle returns true if the task is blocked and has no pending wakeup (called from any thread)
+ * @param arg passed to idle
+ * @return component id, or -1 if there is no free slot
+ */
+__EXPORT extern int px4_lockstep_register_component(bool (*idle)(void *arg), void *arg);
+
+/**
+ * Unregister a component
+ * @param component id returned by px4_lockstep_register_component()
+ */
+__EXPORT extern void px4_lockstep_unregister_component(int component);
+
+/**
+ * Check if all registered components are idle.
+ */
+__EXPORT extern bool px4_lockstep_components_idle(void);
+#endif
+
 /**
  * Call callout(arg) after delay has elapsed.
  *
@@ -35,85 +35,151 @@
  * @file ridephysics.cpp
  * SensorDriver for receiving ridephysics data.
  *
+ * All samples received since the last cycle are ingested in one go: IMU samples are
+ * integrated by PX4Accelerometer/PX4Gyroscope (which publish at the integration rate),
+ * baro samples are averaged into one sensor_baro publication per cycle.
+ *
  * @author Michael Zimmermann <sigmaepsilon92@gmail.com>
  */
 
+#include "ridephysics.hpp"
+
 #include <px4_platform_common/px4_config.h>
+#include <px4_platform_common/getopt.h>
+#include <px4_platform_common/log.h>
+#include <px4_platform_common/posix.h>
 
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <stdint.h>
-#include <stddef.h>
-#include <stdlib.h>
-#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <string.h>
+#include <termios.h>
 #include <unistd.h>
-#include <px4_platform_common/getopt.h>
-#include <errno.h>
 
-#include <systemlib/err.h>
+#include <drivers/drv_sensor.h>
+#include <lib/drivers/device/Device.hpp>
+#include <lib/mathlib/mathlib.h>
+#include <perf/perf_counter.h>
+#include <uORB/topics/sensor_combined.h>
 
-#include <drivers/drv_hrt.h>
-#include <drivers/drv_baro.h>
+using namespace ridephysics;
 
-#include <board_config.h>
-//#include <mathlib/math/filter/LowPassFilter2p.hpp>
+extern "C" { __EXPORT int ridephysics_main(int argc, char *argv[]); }
 
-#include <DevObj.hpp>
-#include <DevMgr.hpp>
+static uint32_t device_id()
+{
+	device::Device::DeviceId device_id{};
+	device_id.devid_s.bus_type = device::Device::DeviceBusType_UNKNOWN;
+	device_id.devid_s.devtype = DRV_DEVTYPE_RIDEPHYSICS;
+	return device_id.devid;
+}
 
-#define DEV_PATH "/dev/null/ridephysics/dev"
-#define DEV_CLASS_PATH "/dev/null/ridephysics/class"
+Ridephysics::Ridephysics(const char *device_path, unsigned baudrate, enum Rotation rotation, float replay_speed) :
+	ScheduledWorkItem(MODULE_NAME, px4::wq_configurations::hp_default),
+	_baudrate(baudrate),
+	_px4_accel(device_id(), ORB_PRIO_DEFAULT, rotation),
+	_px4_gyro(device_id(), ORB_PRIO_DEFAULT, rotation),
+	_px4_baro(device_id(), ORB_PRIO_DEFAULT),
+	_replay_speed(replay_speed)
+{
+	strncpy(_device_path, device_path, sizeof(_device_path) - 1);
 
+	_px4_accel.set_device_type(DRV_DEVTYPE_RIDEPHYSICS);
+	_px4_accel.set_sample_rate(IMU_SAMPLE_RATE);
 
-extern "C" { __EXPORT int ridephysics_main(int argc, char *argv[]); }
+	_px4_gyro.set_device_type(DRV_DEVTYPE_RIDEPHYSICS);
+	_px4_gyro.set_sample_rate(IMU_SAMPLE_RATE);
 
-using namespace DriverFramework;
+	_px4_baro.set_device_type(DRV_DEVTYPE_RIDEPHYSICS);
+}
+
+Ridephysics::~Ridephysics()
+{
+	stop();
 
+	if (_fd >= 0) {
+		::close(_fd);
+	}
+
+	perf_free(_measure_perf);
+	perf_free(_ingest_latency_perf);
+	perf_free(_imu_samples_perf);
+	perf_free(_dropped_samples_perf);
+	perf_free(_bad_frames_perf);
+	perf_free(_read_errors_perf);
+}
 
-class Ridephysics : public DevObj
+int Ridephysics::init()
 {
-public:
-	Ridephysics();
-	~Ridephysics();
+	return _open_device();
+}
 
+static speed_t baudrate_to_speed(unsigned baudrate)
+{
+	switch (baudrate) {
+	case 57600: return B57600;
 
-	/**
-	 * Start automatic measurement.
-	 *
-	 * @return 0 on success
-	 */
-	int		start();
+	case 115200: return B115200;
 
-	/**
-	 * Stop automatic measurement.
-	 *
-	 * @return 0 on success
-	 */
-	int		stop();
+	case 230400: return B230400;
 
-private:
-	virtual void _measure() override;
+	case 460800: return B460800;
 
-	orb_advert_t		_baro_topic;
+	case 921600: return B921600;
 
-	int			_baro_orb_class_instance;
+	case 1000000: return B1000000;
 
-};
+	case 1500000: return B1500000;
 
-Ridephysics::Ridephysics() :
-	DevObj("RideohysicsSensor", DEV_PATH, DEV_CLASS_PATH, DeviceBusType_UNKNOWN, 5000),
-	_baro_topic(nullptr),
-	_baro_orb_class_instance(-1)
-{
+	case 2000000: return B2000000;
+
+	case 3000000: return B3000000;
+
+	default: return B0;
+	}
 }
 
-Ridephysics::~Ridephysics()
+int Ridephysics::_open_device()
 {
+	_fd = ::open(_device_path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+
+	if (_fd < 0) {
+		PX4_ERR("failed to open %s (%i)", _device_path, errno);
+		return -errno;
+	}
+
+	if (!replay() && isatty(_fd)) {
+		const speed_t speed = baudrate_to_speed(_baudrate);
+
+		if (speed == B0) {
+			PX4_ERR("unsupported baudrate %u", _baudrate);
+			return -EINVAL;
+		}
+
+		termios uart_config{};
+
+		if (tcgetattr(_fd, &uart_config) < 0) {
+			PX4_ERR("tcgetattr failed (%i)", errno);
+			return -errno;
+		}
+
+		cfmakeraw(&uart_config);
+
+		if ((cfsetispeed(&uart_config, speed) < 0) || (tcsetattr(_fd, TCSANOW, &uart_config) < 0)) {
+			PX4_ERR("failed to configure %s (%i)", _device_path, errno);
+			return -errno;
+		}
+
+		tcflush(_fd, TCIFLUSH);
+	}
+
+	return PX4_OK;
 }
 
 int Ridephysics::start()
 {
+	ScheduleOnInterval(MEASURE_INTERVAL_US);
+
 	PX4_INFO("ridephysics started");
 
 	return 0;
@@ -121,41 +187,342 @@ int Ridephysics::start()
 
 int Ridephysics::stop()
 {
-	PX4_INFO("ridephysics stopped");
+	ScheduleClear();
 
 	return 0;
 }
 
+void Ridephysics::Run()
+{
+	_measure();
+}
+
 void Ridephysics::_measure()
 {
-	
+	perf_begin(_measure_perf);
+
+	timespec cpu_start{};
+
+	if (replay()) {
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+	}
+
+	// frames left over from the previous cycle (paced replay)
+	bool paced = (_buffer_len > 0) && !_parse(hrt_absolute_time());
+	bool end_of_file = false;
+	int reads = 0;
+
+	while (!paced && (_buffer_len < sizeof(_buffer))) {
+		const ssize_t ret = ::read(_fd, &_buffer[_buffer_len], sizeof(_buffer) - _buffer_len);
+
+		if (ret < 0) {
+			if ((errno != EAGAIN) && (errno != EINTR)) {
+				perf_count(_read_errors_perf);
+			}
+
+			break;
+
+		} else if (ret == 0) {
+			// end of file or the writer closed the FIFO
+			end_of_file = true;
+			break;
+		}
+
+		_buffer_len += ret;
+
+		paced = !_parse(hrt_absolute_time());
+
+		if (replay() && (_replay_speed <= 0.f) && (++reads >= REPLAY_MAX_READS)) {
+			// as fast as possible: continue right away, but give the other items on the queue a chance to run
+			ScheduleNow();
+			break;
+		}
+	}
+
+	_publish_baro();
+
+	if (replay()) {
+		timespec cpu_end{};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+		_cpu_time += (cpu_end.tv_sec - cpu_start.tv_sec) * 1000000 + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1000;
+
+		if (end_of_file && !paced) {
+			// all complete frames are ingested
+			ScheduleClear();
+			_replay_finished = true;
+		}
+	}
+
+	perf_end(_measure_perf);
+}
+
+bool Ridephysics::_replay_due(const uint8_t *payload, unsigned length, hrt_abstime now)
+{
+	uint64_t sensor_timestamp = 0;
+
+	if (length < sizeof(sensor_timestamp)) {
+		return true;
+	}
+
+	memcpy(&sensor_timestamp, payload, sizeof(sensor_timestamp));
+
+	if (!_replay_started) {
+		_replay_t0 = sensor_timestamp;
+		_replay_start = now;
+		_replay_started = true;
+	}
+
+	if ((_replay_speed <= 0.f) || (sensor_timestamp < _replay_t0)) {
+		return true;
+	}
+
+	return (sensor_timestamp - _replay_t0) <= (uint64_t)((now - _replay_start) * _replay_speed);
 }
 
-#if 0
-int Ridephysics::_publish(struct baro_sensor_data &data)
+bool Ridephysics::_parse(hrt_abstime now)
 {
-	sensor_baro_s baro_report = {};
-	baro_report.timestamp   = hrt_absolute_time();
-	baro_report.error_count = data.error_counter;
+	bool due = true;
+	size_t i = 0;
+
+	while (_buffer_len - i >= FRAME_HEADER_LENGTH + FRAME_CHECKSUM_LENGTH) {
+		if ((_buffer[i] != SYNC1) || (_buffer[i + 1] != SYNC2)) {
+			// resync
+			i++;
+			continue;
+		}
 
-	baro_report.pressure    = data.pressure_pa / 100.0f; // to mbar
-	baro_report.temperature = data.temperature_c;
+		const unsigned length = _buffer[i + 3];
+		const size_t frame_length = FRAME_HEADER_LENGTH + length + FRAME_CHECKSUM_LENGTH;
 
-	// TODO: when is this ever blocked?
-	if (!(m_pub_blocked)) {
+		if (_buffer_len - i < frame_length) {
+			// incomplete frame
+			break;
+		}
 
-		if (_baro_topic == nullptr) {
-			_baro_topic = orb_advertise_multi(ORB_ID(sensor_baro), &baro_report,
-							  &_baro_orb_class_instance, ORB_PRIO_DEFAULT);
+		uint8_t ck_a = 0;
+		uint8_t ck_b = 0;
 
-		} else {
-			orb_publish(ORB_ID(sensor_baro), _baro_topic, &baro_report);
+		for (size_t k = i + 2; k < i + FRAME_HEADER_LENGTH + length; k++) {
+			checksum_update(_buffer[k], ck_a, ck_b);
+		}
+
+		if ((ck_a != _buffer[i + FRAME_HEADER_LENGTH + length]) || (ck_b != _buffer[i + FRAME_HEADER_LENGTH + length + 1])) {
+			perf_count(_bad_frames_perf);
+			i++;
+			continue;
 		}
+
+		if (replay() && !_replay_due(&_buffer[i + FRAME_HEADER_LENGTH], length, now)) {
+			due = false;
+			break;
+		}
+
+		_handle_frame((MessageType)_buffer[i + 2], &_buffer[i + FRAME_HEADER_LENGTH], length, now);
+		i += frame_length;
 	}
 
-	return 0;
-};
-#endif
+	// keep the remaining (incomplete or not yet due) data
+	if (i > 0) {
+		memmove(_buffer, &_buffer[i], _buffer_len - i);
+		_buffer_len -= i;
+	}
+
+	return due;
+}
+
+void Ridephysics::_handle_frame(MessageType type, const uint8_t *payload, unsigned length, hrt_abstime now)
+{
+	// the payload is not aligned, copy it out (newer firmware may append fields)
+	switch (type) {
+	case MessageType::IMU:
+		if (length >= sizeof(ImuSample)) {
+			ImuSample sample;
+			memcpy(&sample, payload, sizeof(sample));
+			_handle_imu(sample, now);
+			return;
+		}
+
+		break;
+
+	case MessageType::BARO:
+		if (length >= sizeof(BaroSample)) {
+			BaroSample sample;
+			memcpy(&sample, payload, sizeof(sample));
+			_handle_baro(sample, now);
+			return;
+		}
+
+		break;
+
+	case MessageType::GPS:
+		if (length >= sizeof(GpsSample)) {
+			GpsSample sample;
+			memcpy(&sample, payload, sizeof(sample));
+			_handle_gps(sample, now);
+			return;
+		}
+
+		break;
+	}
+
+	// unknown type or too short
+	perf_count(_bad_frames_perf);
+}
+
+hrt_abstime Ridephysics::_sensor_to_hrt(uint64_t sensor_timestamp, hrt_abstime now)
+{
+	if (replay()) {
+		// keep the recorded timeline (scaled with the replay speed), starting at the first replayed frame
+		if (sensor_timestamp < _replay_t0) {
+			return _replay_start;
+		}
+
+		const uint64_t elapsed = sensor_timestamp - _replay_t0;
+		return _replay_start + ((_replay_speed > 0.f) ? (uint64_t)(elapsed / _replay_speed) : elapsed);
+	}
+
+	// The offset is the minimum observed (now - sensor time), ie. the transport delay of the fastest sample
+	// is assumed to be 0. It slowly increases otherwise, so that it follows a drifting sensor clock.
+	const int64_t offset = (int64_t)now - (int64_t)sensor_timestamp;
+
+	if (!_time_offset_valid || (offset < _time_offset)) {
+		_time_offset = offset;
+		_time_offset_valid = true;
+
+	} else {
+		_time_offset++;
+	}
+
+	// Lowering the offset moves the mapped time back, never go backwards (or ahead of now)
+	hrt_abstime timestamp = math::min((hrt_abstime)(sensor_timestamp + _time_offset), now);
+
+	if (timestamp < _last_timestamp) {
+		timestamp = _last_timestamp;
+	}
+
+	_last_timestamp = timestamp;
+
+	return timestamp;
+}
+
+void Ridephysics::_handle_imu(const ImuSample &sample, hrt_abstime now)
+{
+	if (_imu_sequence_valid) {
+		const int16_t delta = (int16_t)(sample.sequence - _imu_last_sequence);
+
+		if (delta <= 0) {
+			// duplicate (or reordered) sample
+			perf_count(_bad_frames_perf);
+			return;
+		}
+
+		if (delta > 1) {
+			perf_set_count(_dropped_samples_perf, perf_event_count(_dropped_samples_perf) + (delta - 1));
+		}
+	}
+
+	_imu_last_sequence = sample.sequence;
+	_imu_sequence_valid = true;
+
+	const hrt_abstime timestamp = _sensor_to_hrt(sample.timestamp, now);
+
+	_px4_accel.set_temperature(sample.temperature);
+	_px4_accel.update(timestamp, sample.accel[0], sample.accel[1], sample.accel[2]);
+
+	_px4_gyro.set_temperature(sample.temperature);
+	_px4_gyro.update(timestamp, sample.gyro[0], sample.gyro[1], sample.gyro[2]);
+
+	perf_count(_imu_samples_perf);
+	_imu_sample_count++;
+
+	if (replay()) {
+		_ingest_times[_ingest_times_index].timestamp = timestamp;
+		_ingest_times[_ingest_times_index].ingest_time = now;
+		_ingest_times_index = (_ingest_times_index + 1) % INGEST_TIMES_SIZE;
+
+	} else {
+		perf_set_elapsed(_ingest_latency_perf, now - timestamp);
+	}
+}
+
+bool Ridephysics::ingest_time(hrt_abstime timestamp, hrt_abstime &ingest_time) const
+{
+	for (unsigned i = 0; i < INGEST_TIMES_SIZE; i++) {
+		if (_ingest_times[i].timestamp == timestamp) {
+			ingest_time = _ingest_times[i].ingest_time;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Ridephysics::_handle_baro(const BaroSample &sample, hrt_abstime now)
+{
+	_baro_pressure_sum += sample.pressure;
+	_baro_temperature_sum += sample.temperature;
+	_baro_count++;
+	_baro_timestamp = _sensor_to_hrt(sample.timestamp, now);
+}
+
+void Ridephysics::_publish_baro()
+{
+	if (_baro_count == 0) {
+		return;
+	}
+
+	_px4_baro.set_temperature(_baro_temperature_sum / _baro_count);
+	_px4_baro.update(_baro_timestamp, _baro_pressure_sum / _baro_count / 100.f); // Pa to mbar
+
+	_baro_pressure_sum = 0.f;
+	_baro_temperature_sum = 0.f;
+	_baro_count = 0;
+}
+
+void Ridephysics::_handle_gps(const GpsSample &sample, hrt_abstime now)
+{
+	vehicle_gps_position_s gps{};
+	gps.timestamp = _sensor_to_hrt(sample.timestamp, now);
+	gps.lat = sample.lat;
+	gps.lon = sample.lon;
+	gps.alt = sample.alt; // the stream has no ellipsoid altitude
+	gps.eph = sample.eph;
+	gps.epv = sample.epv;
+	gps.s_variance_m_s = sample.s_variance;
+	gps.fix_type = sample.fix_type;
+	gps.satellites_used = sample.satellites_used;
+	gps.vel_n_m_s = sample.vel_n;
+	gps.vel_e_m_s = sample.vel_e;
+	gps.vel_d_m_s = sample.vel_d;
+	gps.vel_m_s = sqrtf(sample.vel_n * sample.vel_n + sample.vel_e * sample.vel_e);
+	gps.cog_rad = atan2f(sample.vel_e, sample.vel_n);
+	gps.vel_ned_valid = (sample.fix_type >= 3); // the stream has no velocity validity flag
+	gps.heading = NAN;
+	gps.heading_offset = NAN;
+
+	_gps_pub.publish(gps);
+}
+
+void Ridephysics::print_info()
+{
+	if (replay()) {
+		PX4_INFO("replay: %s (speed: %.1f)%s", _device_path, (double)_replay_speed, _replay_finished ? ", finished" : "");
+
+	} else {
+		PX4_INFO("device: %s", _device_path);
+	}
+
+	perf_print_counter(_measure_perf);
+	perf_print_counter(_ingest_latency_perf);
+	perf_print_counter(_imu_samples_perf);
+	perf_print_counter(_dropped_samples_perf);
+	perf_print_counter(_bad_frames_perf);
+	perf_print_counter(_read_errors_perf);
+
+	_px4_accel.print_status();
+	_px4_gyro.print_status();
+	_px4_baro.print_status();
+}
 
 
 namespace ridephysics
@@ -163,24 +530,36 @@ namespace ridephysics
 
 Ridephysics *g_dev = nullptr;
 
-int start(/* enum Rotation rotation */);
+int start(const char *device_path, unsigned baudrate, enum Rotation rotation, float replay_speed);
 int stop();
 int info();
+int bench(const char *file_path, enum Rotation rotation, float replay_speed);
 void usage();
 
-int start(/*enum Rotation rotation*/)
+int start(const char *device_path, unsigned baudrate, enum Rotation rotation, float replay_speed)
 {
-	g_dev = new Ridephysics(/*rotation*/);
+	if (g_dev != nullptr) {
+		PX4_WARN("already started");
+		return 0;
+	}
+
+	g_dev = new Ridephysics(device_path, baudrate, rotation, replay_speed);
 
 	if (g_dev == nullptr) {
 		PX4_ERR("failed instantiating Ridephysics object");
 		return -1;
 	}
 
-	int ret = g_dev->start();
+	int ret = g_dev->init();
+
+	if (ret == 0) {
+		ret = g_dev->start();
+	}
 
 	if (ret != 0) {
 		PX4_ERR("Ridephysics start failed");
+		delete g_dev;
+		g_dev = nullptr;
 		return ret;
 	}
 
@@ -217,15 +596,97 @@ info()
 		return 1;
 	}
 
-	PX4_DEBUG("state @ %p", g_dev);
+	g_dev->print_info();
 
 	return 0;
 }
 
+/**
+ * Replay a capture file through the driver and measure the ingest throughput,
+ * the latency from reading a sample to its sensor_combined publication and the
+ * driver CPU time per sample.
+ */
+int
+bench(const char *file_path, enum Rotation rotation, float replay_speed)
+{
+	if (g_dev != nullptr) {
+		PX4_ERR("driver already running");
+		return 1;
+	}
+
+	int sensor_combined_sub = orb_subscribe(ORB_ID(sensor_combined));
+
+	if (sensor_combined_sub < 0) {
+		PX4_ERR("sensor_combined subscription failed");
+		return 1;
+	}
+
+	int ret = start(file_path, 0, rotation, replay_speed);
+
+	if (ret != 0) {
+		orb_unsubscribe(sensor_combined_sub);
+		return ret;
+	}
+
+	perf_counter_t latency_perf = perf_alloc(PC_ELAPSED, MODULE_NAME": read to sensor_combined");
+	unsigned sensor_combined_count = 0;
+	unsigned unmatched_count = 0;
+
+	const hrt_abstime start_time = hrt_absolute_time();
+
+	px4_pollfd_struct_t fds[1] {};
+	fds[0].fd = sensor_combined_sub;
+	fds[0].events = POLLIN;
+
+	while (!g_dev->replay_finished()) {
+		if (px4_poll(fds, 1, 100) > 0) {
+			sensor_combined_s sensor_combined;
+			orb_copy(ORB_ID(sensor_combined), sensor_combined_sub, &sensor_combined);
+
+			const hrt_abstime now = hrt_absolute_time();
+			hrt_abstime ingest_time;
+
+			if (g_dev->ingest_time(sensor_combined.timestamp, ingest_time)) {
+				perf_set_elapsed(latency_perf, now - ingest_time);
+
+			} else {
+				unmatched_count++;
+			}
+
+			sensor_combined_count++;
+		}
+	}
+
+	const hrt_abstime elapsed = hrt_elapsed_time(&start_time);
+	const unsigned samples = g_dev->imu_sample_count();
+
+	PX4_INFO("IMU samples: %u in %.3f s (%.0f samples/s)", samples, (double)(elapsed * 1e-6f),
+		 (double)(samples / (elapsed * 1e-6f)));
+
+	if (samples > 0) {
+		PX4_INFO("driver CPU time: %.3f us/sample", (double)((float)g_dev->cpu_time() / samples));
+	}
+
+	PX4_INFO("sensor_combined: %u (unmatched: %u)", sensor_combined_count, unmatched_count);
+	perf_print_counter(latency_perf);
+	g_dev->print_info();
+
+	perf_free(latency_perf);
+	orb_unsubscribe(sensor_combined_sub);
+
+	return stop();
+}
+
 void
 usage()
 {
-	PX4_WARN("Usage: ridephysics 'start', 'info', 'stop'");
+	PX4_WARN("Usage: ridephysics 'start', 'info', 'stop', 'bench'");
+	PX4_INFO("options:");
+	PX4_INFO("    -d device (default: /dev/ttyUSB0)");
+	PX4_INFO("    -b baudrate (default: 921600)");
+	PX4_INFO("    -R rotation");
+	PX4_INFO("    -f capture file to replay instead of a device (required for bench)");
+	PX4_INFO("    -s replay speed, multiple of real time, 0: as fast as possible (default: 1, bench: 0)");
 }
 
 } // namespace ridephysics
@@ -236,8 +697,50 @@ ridephysics_main(int argc, char *argv[])
 {
 	int ret = 0;
 	int myoptind = 1;
+	int ch;
+	const char *myoptarg = nullptr;
+
+	const char *device_path = "/dev/ttyUSB0";
+	unsigned baudrate = 921600;
+	enum Rotation rotation = ROTATION_NONE;
+	const char *replay_file = nullptr;
+	float replay_speed = -1.f;
+
+	while ((ch = px4_getopt(argc, argv, "d:b:R:f:s:", &myoptind, &myoptarg)) != EOF) {
+		switch (ch) {
+		case 'd':
+			device_path = myoptarg;
+			break;
+
+		case 'b':
+			baudrate = strtoul(myoptarg, nullptr, 10);
+			break;
+
+		case 'R':
+			rotation = (enum Rotation)atoi(myoptarg);
+			break;
+
+		case 'f':
+			replay_file = myoptarg;
+			break;
+
+		case 's':
+			replay_speed = strtof(myoptarg, nullptr);
+
+			if (replay_speed < 0.f) {
+				ridephysics::usage();
+				return 1;
+			}
+
+			break;
+
+		default:
+			ridephysics::usage();
+			return 1;
+		}
+	}
 
-	if (argc <= 1) {
+	if (myoptind >= argc) {
 		ridephysics::usage();
 		return 1;
 	}
@@ -246,7 +749,12 @@ ridephysics_main(int argc, char *argv[])
 
 
 	if (!strcmp(verb, "start")) {
-		ret = ridephysics::start();
+		if (replay_file != nullptr) {
+			ret = ridephysics::start(replay_file, 0, rotation, (replay_speed < 0.f) ? 1.f : replay_speed);
+
+		} else {
+			ret = ridephysics::start(device_path, baudrate, rotation, -1.f);
+		}
 	}
 
 	else if (!strcmp(verb, "stop")) {
@@ -257,6 +765,15 @@ ridephysics_main(int argc, char *argv[])
 		ret = ridephysics::info();
 	}
 
+	else if (!strcmp(verb, "bench")) {
+		if (replay_file == nullptr) {
+			ridephysics::usage();
+			return 1;
+		}
+
+		ret = ridephysics::bench(replay_file, rotation, (replay_speed < 0.f) ? 0.f : replay_speed);
+	}
+
 	else {
 		ridephysics::usage();
 		return 1;
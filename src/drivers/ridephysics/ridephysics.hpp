@@ -0,0 +1,200 @@
+/****************************************************************************
+ *
+ * Copyright (c) 2016 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ridephysics.hpp
+ * Driver for the ridephysics sensor stream (IMU, baro, GPS).
+ *
+ * @author Michael Zimmermann <sigmaepsilon92@gmail.com>
+ */
+
+#pragma once
+
+#include "ridephysics_protocol.h"
+
+#include <drivers/drv_hrt.h>
+#include <lib/conversion/rotation.h>
+#include <lib/drivers/accelerometer/PX4Accelerometer.hpp>
+#include <lib/drivers/barometer/PX4Barometer.hpp>
+#include <lib/drivers/gyroscope/PX4Gyroscope.hpp>
+#include <perf/perf_counter.h>
+#include <px4_platform_common/px4_work_queue/ScheduledWorkItem.hpp>
+#include <uORB/PublicationMulti.hpp>
+#include <uORB/topics/vehicle_gps_position.h>
+
+class Ridephysics : public px4::ScheduledWorkItem
+{
+public:
+	/**
+	 * @param device_path serial device, FIFO or (with replay) capture file
+	 * @param replay_speed replay a capture file at this multiple of real time, 0: as fast as possible,
+	 *                     negative: no replay (live device)
+	 */
+	Ridephysics(const char *device_path, unsigned baudrate, enum Rotation rotation, float replay_speed = -1.f);
+	~Ridephysics() override;
+
+	/**
+	 * Open the device.
+	 *
+	 * @return 0 on success
+	 */
+	int		init();
+
+	/**
+	 * Start automatic measurement.
+	 *
+	 * @return 0 on success
+	 */
+	int		start();
+
+	/**
+	 * Stop automatic measurement.
+	 *
+	 * @return 0 on success
+	 */
+	int		stop();
+
+	void		print_info();
+
+	bool		replay() const { return _replay_speed >= 0.f; }
+
+	/**
+	 * @return true once the end of the replayed capture file was reached
+	 */
+	bool		replay_finished() const { return _replay_finished; }
+
+	/**
+	 * Look up the time an IMU sample was ingested (replay only, recent samples).
+	 *
+	 * @param timestamp published sample timestamp
+	 * @param ingest_time time the sample was read from the file
+	 * @return true if found
+	 */
+	bool		ingest_time(hrt_abstime timestamp, hrt_abstime &ingest_time) const;
+
+	unsigned	imu_sample_count() const { return _imu_sample_count; }
+
+	/**
+	 * CPU time spent in _measure() (replay only) [us]
+	 */
+	uint64_t	cpu_time() const { return _cpu_time; }
+
+private:
+	static constexpr uint32_t MEASURE_INTERVAL_US = 1000;	///< poll interval, all samples received in between are ingested at once
+	static constexpr unsigned IMU_SAMPLE_RATE = 1000;	///< [Hz] nominal IMU rate (filter configuration)
+	static constexpr size_t BUFFER_SIZE = 4096;
+	static constexpr int REPLAY_MAX_READS = 16;		///< reads per cycle when replaying as fast as possible
+
+	void		Run() override;
+
+	/**
+	 * Read all pending data from the device and ingest it.
+	 */
+	void		_measure();
+
+	int		_open_device();
+
+	/**
+	 * Parse all complete frames in the receive buffer.
+	 *
+	 * @param read_time time the data was read (for replay: only frames that are due are parsed)
+	 * @return false if parsing stopped at a replayed frame that is not due yet
+	 */
+	bool		_parse(hrt_abstime read_time);
+
+	/**
+	 * Check if a replayed frame is due (paced replay).
+	 */
+	bool		_replay_due(const uint8_t *payload, unsigned length, hrt_abstime now);
+
+	void		_handle_frame(ridephysics::MessageType type, const uint8_t *payload, unsigned length, hrt_abstime now);
+	void		_handle_imu(const ridephysics::ImuSample &sample, hrt_abstime now);
+	void		_handle_baro(const ridephysics::BaroSample &sample, hrt_abstime now);
+	void		_handle_gps(const ridephysics::GpsSample &sample, hrt_abstime now);
+
+	void		_publish_baro();
+
+	/**
+	 * Map a sensor timestamp to hrt time.
+	 */
+	hrt_abstime	_sensor_to_hrt(uint64_t sensor_timestamp, hrt_abstime now);
+
+	char			_device_path[64] {};
+	const unsigned		_baudrate;
+	int			_fd{-1};
+
+	uint8_t			_buffer[BUFFER_SIZE];
+	size_t			_buffer_len{0};
+
+	PX4Accelerometer	_px4_accel;
+	PX4Gyroscope		_px4_gyro;
+	PX4Barometer		_px4_baro;
+
+	uORB::PublicationMulti<vehicle_gps_position_s>	_gps_pub{ORB_ID(vehicle_gps_position)};
+
+	// baro samples of the current _measure() tick, published as one (averaged) sample
+	float			_baro_pressure_sum{0.f};
+	float			_baro_temperature_sum{0.f};
+	unsigned		_baro_count{0};
+	hrt_abstime		_baro_timestamp{0};
+
+	int64_t			_time_offset{0};	///< hrt - sensor clock [us]
+	bool			_time_offset_valid{false};
+	hrt_abstime		_last_timestamp{0};	///< last mapped (live) timestamp, output is kept monotonic
+
+	uint16_t		_imu_last_sequence{0};
+	bool			_imu_sequence_valid{false};
+	unsigned		_imu_sample_count{0};
+
+	// replay of a capture file
+	const float		_replay_speed;
+	uint64_t		_replay_t0{0};		///< sensor time of the first frame
+	hrt_abstime		_replay_start{0};	///< hrt time of the first frame
+	bool			_replay_started{false};
+	volatile bool		_replay_finished{false};
+	uint64_t		_cpu_time{0};
+
+	static constexpr unsigned INGEST_TIMES_SIZE = 256;
+	struct {
+		hrt_abstime timestamp;
+		hrt_abstime ingest_time;
+	}			_ingest_times[INGEST_TIMES_SIZE] {};
+	unsigned		_ingest_times_index{0};
+
+	perf_counter_t		_measure_perf{perf_alloc(PC_ELAPSED, MODULE_NAME": measure")};
+	perf_counter_t		_ingest_latency_perf{perf_alloc(PC_ELAPSED, MODULE_NAME": ingest latency")};
+	perf_counter_t		_imu_samples_perf{perf_alloc(PC_COUNT, MODULE_NAME": IMU samples")};
+	perf_counter_t		_dropped_samples_perf{perf_alloc(PC_COUNT, MODULE_NAME": dropped samples")};
+	perf_counter_t		_bad_frames_perf{perf_alloc(PC_COUNT, MODULE_NAME": bad frames")};
+	perf_counter_t		_read_errors_perf{perf_alloc(PC_COUNT, MODULE_NAME": read errors")};
+};
@@ -0,0 +1,117 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ridephysics_protocol.h
+ *
+ * Wire format of the ridephysics sensor stream.
+ *
+ * Provisional: there is no published specification of the sensor protocol. The framing
+ * and checksum below are what this driver (and its capture/replay tooling) expects and
+ * need to be verified against the sensor firmware.
+ *
+ * The stream is a sequence of frames (little endian):
+ *
+ *   sync1 (0xA5) | sync2 (0x5A) | type | length | payload (length bytes) | ck_a | ck_b
+ *
+ * The checksum is a Fletcher-16 over type, length and payload.
+ * Every payload starts with the uint64 sample timestamp in microseconds of the
+ * sensor's monotonic clock.
+ *
+ * A capture file (for replay) is the raw stream as received from the sensor.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace ridephysics
+{
+
+static constexpr uint8_t SYNC1 = 0xA5;
+static constexpr uint8_t SYNC2 = 0x5A;
+
+static constexpr unsigned FRAME_HEADER_LENGTH = 4;
+static constexpr unsigned FRAME_CHECKSUM_LENGTH = 2;
+static constexpr unsigned FRAME_MAX_PAYLOAD_LENGTH = 255;
+
+enum class MessageType : uint8_t {
+	IMU = 1,
+	BARO = 2,
+	GPS = 3,
+};
+
+#pragma pack(push, 1)
+struct ImuSample {
+	uint64_t timestamp;	///< [us] sensor clock
+	uint16_t sequence;	///< incremented with every IMU sample, used to detect dropped samples
+	float accel[3];		///< [m/s^2] FRD body frame
+	float gyro[3];		///< [rad/s] FRD body frame
+	float temperature;	///< [deg C]
+};
+
+struct BaroSample {
+	uint64_t timestamp;	///< [us] sensor clock
+	float pressure;		///< [Pa]
+	float temperature;	///< [deg C]
+};
+
+struct GpsSample {
+	uint64_t timestamp;	///< [us] sensor clock
+	int32_t lat;		///< [1e-7 deg]
+	int32_t lon;		///< [1e-7 deg]
+	int32_t alt;		///< [mm] MSL
+	float eph;		///< [m]
+	float epv;		///< [m]
+	float vel_n;		///< [m/s]
+	float vel_e;		///< [m/s]
+	float vel_d;		///< [m/s]
+	float s_variance;	///< [m/s]
+	uint8_t fix_type;	///< as vehicle_gps_position.fix_type
+	uint8_t satellites_used;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ImuSample) <= FRAME_MAX_PAYLOAD_LENGTH, "ImuSample too large");
+static_assert(sizeof(GpsSample) <= FRAME_MAX_PAYLOAD_LENGTH, "GpsSample too large");
+
+/**
+ * Fletcher-16 checksum (as used by u-blox).
+ */
+static inline void checksum_update(uint8_t byte, uint8_t &ck_a, uint8_t &ck_b)
+{
+	ck_a += byte;
+	ck_b += ck_a;
+}
+
+} // namespace ridephysics
@@ -0,0 +1,213 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file IntrusiveMpscQueue.hpp
+ *
+ * A lock-free intrusive multi-producer single-consumer queue (D. Vyukov).
+ */
+
+#pragma once
+
+#include <stdlib.h>
+
+#include <px4_platform_common/atomic.h>
+
+template<class T>
+class IntrusiveMpscQueueNode;
+
+/**
+ * Lock-free intrusive queue: push() can be called concurrently from any number of
+ * threads (and interrupts), pop() and remove() only by a single consumer at a time.
+ *
+ * A node can only be queued once: pushing a node that is already queued has no effect.
+ */
+template<class T>
+class IntrusiveMpscQueue
+{
+public:
+	using Node = IntrusiveMpscQueueNode<T>;
+
+	IntrusiveMpscQueue() : _head(&_stub), _tail(&_stub) {}
+	~IntrusiveMpscQueue() = default;
+
+	// no copy, assignment, move, move assignment
+	IntrusiveMpscQueue(const IntrusiveMpscQueue &) = delete;
+	IntrusiveMpscQueue &operator=(const IntrusiveMpscQueue &) = delete;
+	IntrusiveMpscQueue(IntrusiveMpscQueue &&) = delete;
+	IntrusiveMpscQueue &operator=(IntrusiveMpscQueue &&) = delete;
+
+	/**
+	 * Insert a node at the back (lock-free).
+	 * @return true if inserted, false if the node was already queued
+	 */
+	bool push(T newNode)
+	{
+		Node *node = newNode;
+		bool queued = false;
+
+		if (!node->_mpsc_queued.compare_exchange(&queued, true)) {
+			return false;
+		}
+
+		push_node(node);
+		return true;
+	}
+
+	/**
+	 * Remove the node at the front. Consumer only.
+	 *
+	 * @return the node, or nullptr if the queue is empty or the next node is still being
+	 *         pushed (the producer completes the push without blocking)
+	 */
+	T pop()
+	{
+		Node *node = pop_node();
+		return (node != nullptr) ? release(node) : nullptr;
+	}
+
+	/**
+	 * Remove a specific node. Consumer only.
+	 * All other nodes are unlinked and linked again at the back (in order), so this is O(n).
+	 * They stay marked as queued meanwhile, so a concurrent push() of them is still rejected.
+	 *
+	 * @return true if the node was removed, false if it was not queued or its push is still in progress
+	 */
+	bool remove(T removeNode)
+	{
+		if (!queued(removeNode)) {
+			return false;
+		}
+
+		bool removed = false;
+		Node *first_requeued = nullptr;
+
+		for (Node *node = pop_node(); node != nullptr; node = pop_node()) {
+			if (node == static_cast<Node *>(removeNode)) {
+				release(node);
+				removed = true;
+				continue;
+			}
+
+			push_node(node);
+
+			if (node == first_requeued) {
+				// went through the whole queue
+				break;
+
+			} else if (first_requeued == nullptr) {
+				first_requeued = node;
+			}
+		}
+
+		return removed;
+	}
+
+	/**
+	 * Check if a node is queued (or being pushed).
+	 */
+	bool queued(T node) const { return static_cast<const Node *>(node)->_mpsc_queued.load(); }
+
+private:
+
+	/**
+	 * Unlink the node at the front, without clearing its queued flag.
+	 */
+	Node *pop_node()
+	{
+		Node *tail = _tail;
+		Node *next = tail->_mpsc_next.load();
+
+		if (tail == &_stub) {
+			if (next == nullptr) {
+				// empty
+				return nullptr;
+			}
+
+			_tail = next;
+			tail = next;
+			next = next->_mpsc_next.load();
+		}
+
+		if (next != nullptr) {
+			_tail = next;
+			return tail;
+		}
+
+		if (tail != _head.load()) {
+			// a push is in progress
+			return nullptr;
+		}
+
+		// tail is the last node, put the stub behind it
+		push_node(&_stub);
+
+		next = tail->_mpsc_next.load();
+
+		if (next != nullptr) {
+			_tail = next;
+			return tail;
+		}
+
+		return nullptr;
+	}
+
+	void push_node(Node *node)
+	{
+		node->_mpsc_next.store(nullptr);
+		Node *prev = _head.exchange(node);
+		// between the exchange and this store the queue is temporarily disconnected
+		prev->_mpsc_next.store(node);
+	}
+
+	T release(Node *node)
+	{
+		// the node can be queued again from now on
+		node->_mpsc_queued.store(false);
+		return static_cast<T>(node);
+	}
+
+	px4::atomic<Node *> _head;	///< last pushed node (producers)
+	Node *_tail;			///< next node to pop (consumer)
+	Node _stub{};
+};
+
+template<class T>
+class IntrusiveMpscQueueNode
+{
+private:
+	friend IntrusiveMpscQueue<T>;
+
+	px4::atomic<IntrusiveMpscQueueNode<T> *> _mpsc_next{nullptr};
+	px4::atomic_bool _mpsc_queued{false};
+};
@@ -34,10 +34,16 @@
 #include <px4_platform_common/module_params.h>
 #include <uORB/Subscription.hpp>
 #include <uORB/topics/obstacle_distance.h>
+#include <uORB/topics/parameter_update.h>
 #include <uORB/uORBManager.hpp>
 
 #include <gtest/gtest.h>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 class ParameterTest : public ::testing::Test
 {
 public:
@@ -78,6 +84,352 @@ TEST_F(ParameterTest, testParamReadWrite)
 }
 
 
+TEST_F(ParameterTest, testParamFind)
+{
+	const unsigned count = param_count();
+	ASSERT_GT(count, 0u);
+
+	for (unsigned i = 0; i < count; ++i) {
+		// GIVEN: a parameter name
+		const param_t param = param_for_index(i);
+		const char *name = param_name(param);
+
+		// WHEN: we search for the parameter
+		// THEN: we should get its handle
+		EXPECT_EQ(param, param_find_no_notification(name)) << name;
+	}
+
+	// AND: unknown names should not be found
+	EXPECT_EQ(PARAM_INVALID, param_find_no_notification(""));
+	EXPECT_EQ(PARAM_INVALID, param_find_no_notification("CP_DIS"));
+	EXPECT_EQ(PARAM_INVALID, param_find_no_notification("CP_DIST_"));
+	EXPECT_EQ(PARAM_INVALID, param_find_no_notification("NOT_A_PARAMETER"));
+}
+
+
+TEST_F(ParameterTest, testParamSetGetAll)
+{
+	const unsigned count = param_count();
+	ASSERT_GT(count, 0u);
+
+	// GIVEN: all parameters at their default
+	// WHEN: we set every other parameter, in handle order like an import of a saved file
+	for (unsigned i = 0; i < count; i += 2) {
+		const param_t param = param_for_index(i);
+
+		if (param_type(param) == PARAM_TYPE_INT32) {
+			const int32_t value = i;
+			EXPECT_EQ(0, param_set_no_notification(param, &value)) << param_name(param);
+
+		} else if (param_type(param) == PARAM_TYPE_FLOAT) {
+			const float value = i;
+			EXPECT_EQ(0, param_set_no_notification(param, &value)) << param_name(param);
+		}
+	}
+
+	// THEN: only those parameters should be changed and report the new value
+	for (unsigned i = 0; i < count; ++i) {
+		const param_t param = param_for_index(i);
+		const bool is_set = (i % 2 == 0) && (param_type(param) == PARAM_TYPE_INT32 || param_type(param) == PARAM_TYPE_FLOAT);
+
+		EXPECT_EQ(!is_set, param_value_is_default(param)) << param_name(param);
+		EXPECT_EQ(is_set, param_value_unsaved(param)) << param_name(param);
+
+		if (is_set && param_type(param) == PARAM_TYPE_INT32) {
+			int32_t value = -1;
+			EXPECT_EQ(0, param_get(param, &value));
+			EXPECT_EQ((int32_t)i, value) << param_name(param);
+
+		} else if (is_set) {
+			float value = -1.f;
+			EXPECT_EQ(0, param_get(param, &value));
+			EXPECT_EQ((float)i, value) << param_name(param);
+		}
+	}
+
+	// AND: a reset should restore the default of a single parameter
+	const param_t param = param_handle(px4::params::CP_DIST);
+	const float value = 42.f;
+	EXPECT_EQ(0, param_set_no_notification(param, &value));
+	EXPECT_TRUE(param_value_unsaved(param));
+	EXPECT_EQ(0, param_reset(param));
+	EXPECT_TRUE(param_value_is_default(param));
+	EXPECT_FALSE(param_value_unsaved(param));
+}
+
+
+TEST_F(ParameterTest, testParamGetIfChanged)
+{
+	// GIVEN: a parameter and no value yet
+	const param_t param = param_handle(px4::params::CP_DIST);
+	float value = -1.f;
+	uint16_t generation = 0;
+
+	// WHEN: we get the parameter
+	// THEN: the default value should be copied
+	EXPECT_EQ(1, param_get_if_changed(param, &value, &generation));
+	EXPECT_NE(0, generation);
+
+	float default_value = -999.f;
+	EXPECT_EQ(0, param_get(param, &default_value));
+	EXPECT_EQ(default_value, value);
+
+	// AND: it should not be copied again, as long as it does not change
+	value = -1.f;
+	EXPECT_EQ(0, param_get_if_changed(param, &value, &generation));
+	EXPECT_EQ(-1.f, value);
+
+	// WHEN: we set another parameter
+	const int32_t autostart = 4001;
+	EXPECT_EQ(0, param_set_no_notification(param_handle(px4::params::SYS_AUTOSTART), &autostart));
+
+	// THEN: the parameter should still be unchanged
+	EXPECT_EQ(0, param_get_if_changed(param, &value, &generation));
+
+	// WHEN: we set the parameter
+	const float new_value = default_value + 1.f;
+	EXPECT_EQ(0, param_set_no_notification(param, &new_value));
+
+	// THEN: the new value should be copied
+	EXPECT_EQ(1, param_get_if_changed(param, &value, &generation));
+	EXPECT_EQ(new_value, value);
+
+	// WHEN: we reset all parameters
+	param_reset_all();
+
+	// THEN: the default should be copied again
+	EXPECT_EQ(1, param_get_if_changed(param, &value, &generation));
+	EXPECT_EQ(default_value, value);
+}
+
+
+class ParamsModule : public ModuleParams
+{
+public:
+	ParamsModule() : ModuleParams(nullptr) {}
+
+	using ModuleParams::updateParams;
+
+	DEFINE_PARAMETERS(
+		(ParamFloat<px4::params::CP_DIST>) _param_cp_dist,
+		(ParamInt<px4::params::SYS_AUTOSTART>) _param_sys_autostart
+	)
+};
+
+
+TEST_F(ParameterTest, testModuleParamsUpdate)
+{
+	// GIVEN: a module with parameters
+	ParamsModule module;
+	const float cp_dist = module._param_cp_dist.get();
+
+	// WHEN: we set a parameter and update the module
+	const int32_t autostart = 4001;
+	EXPECT_EQ(0, param_set_no_notification(param_handle(px4::params::SYS_AUTOSTART), &autostart));
+	module.updateParams();
+
+	// THEN: the module should have the new value
+	EXPECT_EQ(autostart, module._param_sys_autostart.get());
+	EXPECT_EQ(cp_dist, module._param_cp_dist.get());
+
+	// WHEN: a value is overridden locally and the module updated
+	module._param_cp_dist.set(cp_dist + 1.f);
+	module.updateParams();
+
+	// THEN: the stored value should be restored (same as reading it every time)
+	EXPECT_EQ(cp_dist, module._param_cp_dist.get());
+}
+
+
+TEST_F(ParameterTest, testParamBatch)
+{
+	// GIVEN: a parameter_update subscription
+	uORB::Subscription parameter_update_sub{ORB_ID(parameter_update)};
+	parameter_update_s update;
+	parameter_update_sub.update(&update);
+
+	const param_t param_cp_dist = param_handle(px4::params::CP_DIST);
+	const param_t param_autostart = param_handle(px4::params::SYS_AUTOSTART);
+
+	// WHEN: we set parameters in a batch
+	param_batch_begin();
+
+	const float cp_dist = 42.f;
+	EXPECT_EQ(0, param_set(param_cp_dist, &cp_dist));
+	const int32_t autostart = 4001;
+	EXPECT_EQ(0, param_set(param_autostart, &autostart));
+
+	// THEN: there should be no notification yet, but the values should be set
+	EXPECT_FALSE(parameter_update_sub.updated());
+
+	float value = -1.f;
+	EXPECT_EQ(0, param_get(param_cp_dist, &value));
+	EXPECT_EQ(cp_dist, value);
+
+	// WHEN: we commit the batch
+	param_batch_commit();
+
+	// THEN: there should be a single notification with both changes
+	ASSERT_TRUE(parameter_update_sub.update(&update));
+	EXPECT_FALSE(parameter_update_sub.updated());
+	EXPECT_EQ(2u, update.changed);
+	EXPECT_EQ(param_cp_dist < param_autostart ? param_cp_dist : param_autostart, update.changed_index_min);
+	EXPECT_EQ(param_cp_dist < param_autostart ? param_autostart : param_cp_dist, update.changed_index_max);
+
+	// WHEN: another thread sets a parameter while a batch is open
+	param_batch_begin();
+
+	pthread_t thread;
+	ASSERT_EQ(0, pthread_create(&thread, nullptr, [](void *) -> void * {
+		const int32_t value = 4002;
+		param_set(param_handle(px4::params::SYS_AUTOSTART), &value);
+		return nullptr;
+	}, nullptr));
+	pthread_join(thread, nullptr);
+
+	// THEN: its notification should not be delayed by the batch
+	ASSERT_TRUE(parameter_update_sub.update(&update));
+	EXPECT_EQ(1u, update.changed);
+	EXPECT_EQ(param_autostart, update.changed_index_min);
+
+	param_batch_commit();
+	EXPECT_FALSE(parameter_update_sub.updated());
+
+	// WHEN: we set a parameter to its current value in a batch
+	param_batch_begin();
+	EXPECT_EQ(0, param_set(param_cp_dist, &cp_dist));
+	param_batch_commit();
+
+	// THEN: there should be no notification
+	EXPECT_FALSE(parameter_update_sub.updated());
+
+	// WHEN: we notify explicitly
+	param_notify_changes();
+
+	// THEN: the update should not have any tracked change
+	ASSERT_TRUE(parameter_update_sub.update(&update));
+	EXPECT_EQ(0u, update.changed);
+}
+
+TEST_F(ParameterTest, testParamJournal)
+{
+	static constexpr const char *param_file_name = "parameter_test_journal.bson";
+	const param_t param_cp_dist = param_handle(px4::params::CP_DIST);
+	struct stat st {};
+
+	// GIVEN: a parameter file with many modified values
+	param_control_autosave(false);
+	unlink(param_file_name);
+	ASSERT_EQ(0, param_set_default_file(param_file_name));
+
+	for (unsigned i = 0; i < param_count(); i += 2) {
+		const param_t param = param_for_index(i);
+		const int32_t value_i = i;
+		const float value_f = i;
+
+		if (param_type(param) == PARAM_TYPE_INT32) {
+			param_set_no_notification(param, &value_i);
+
+		} else if (param_type(param) == PARAM_TYPE_FLOAT) {
+			param_set_no_notification(param, &value_f);
+		}
+	}
+
+	float cp_dist = 1.f;
+	EXPECT_EQ(0, param_set_no_notification(param_cp_dist, &cp_dist));
+
+	ASSERT_EQ(0, param_save_default());
+
+	ASSERT_EQ(0, stat(param_file_name, &st));
+	const off_t file_size_full = st.st_size;
+
+	// WHEN: we change a single value and save again
+	cp_dist = 2.f;
+	EXPECT_EQ(0, param_set_no_notification(param_cp_dist, &cp_dist));
+
+	ASSERT_EQ(0, param_save_default());
+
+	// THEN: only a small record should have been appended
+	ASSERT_EQ(0, stat(param_file_name, &st));
+	EXPECT_GT(st.st_size, file_size_full);
+	EXPECT_LT(st.st_size, file_size_full + 64);
+	EXPECT_FALSE(param_value_unsaved(param_cp_dist));
+
+	// AND: loading the file should restore the journaled value
+	param_reset_all();
+	EXPECT_TRUE(param_value_is_default(param_cp_dist));
+	EXPECT_EQ(0, param_load_default());
+	EXPECT_EQ(0, param_get(param_cp_dist, &cp_dist));
+	EXPECT_EQ(2.f, cp_dist);
+	EXPECT_FALSE(param_value_unsaved(param_cp_dist));
+
+	// WHEN: the last record is incomplete (e.g. power loss during the save)
+	ASSERT_EQ(0, truncate(param_file_name, st.st_size - 1));
+
+	// THEN: it should be ignored, and the previous values loaded
+	EXPECT_EQ(0, param_load_default());
+	EXPECT_EQ(0, param_get(param_cp_dist, &cp_dist));
+	EXPECT_EQ(1.f, cp_dist);
+
+	// AND: the next save should replace it
+	cp_dist = 3.f;
+	EXPECT_EQ(0, param_set_no_notification(param_cp_dist, &cp_dist));
+	ASSERT_EQ(0, param_save_default());
+	EXPECT_EQ(0, param_load_default());
+	EXPECT_EQ(0, param_get(param_cp_dist, &cp_dist));
+	EXPECT_EQ(3.f, cp_dist);
+
+	// WHEN: a value is reset and the parameters are saved
+	EXPECT_EQ(0, param_reset(param_cp_dist));
+	ASSERT_EQ(0, param_save_default());
+
+	// THEN: the file should be rewritten without it, and the stale records ignored
+	EXPECT_EQ(0, param_load_default());
+	EXPECT_TRUE(param_value_is_default(param_cp_dist));
+
+	param_set_default_file(nullptr);
+	param_control_autosave(true);
+	unlink(param_file_name);
+}
+
+TEST_F(ParameterTest, testParamJournalExport)
+{
+	static constexpr const char *param_file_name = "parameter_test_journal_export.bson";
+	static constexpr const char *export_file_name = "parameter_test_journal_export_other.bson";
+	const param_t param_cp_dist = param_handle(px4::params::CP_DIST);
+
+	// GIVEN: a saved default parameter file
+	param_control_autosave(false);
+	unlink(param_file_name);
+	ASSERT_EQ(0, param_set_default_file(param_file_name));
+
+	float cp_dist = 1.f;
+	EXPECT_EQ(0, param_set_no_notification(param_cp_dist, &cp_dist));
+	ASSERT_EQ(0, param_save_default());
+
+	// WHEN: a value is changed and exported to another file before saving the default file
+	cp_dist = 2.f;
+	EXPECT_EQ(0, param_set_no_notification(param_cp_dist, &cp_dist));
+
+	const int fd = open(export_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	ASSERT_GE(fd, 0);
+	EXPECT_EQ(0, param_export(fd, false));
+	close(fd);
+
+	ASSERT_EQ(0, param_save_default());
+
+	// THEN: the default file should still contain the value
+	param_reset_all();
+	EXPECT_EQ(0, param_load_default());
+	EXPECT_EQ(0, param_get(param_cp_dist, &cp_dist));
+	EXPECT_EQ(2.f, cp_dist);
+
+	param_set_default_file(nullptr);
+	param_control_autosave(true);
+	unlink(param_file_name);
+	unlink(export_file_name);
+}
+
 TEST_F(ParameterTest, testUorbSendReceive)
 {
 	// GIVEN: a uOrb message
@@ -242,6 +242,22 @@ __EXPORT size_t		param_size(param_t param);
  */
 __EXPORT int		param_get(param_t param, void *val);
 
+/**
+ * Copy the value of an int32 or float parameter if it changed, without locking.
+ *
+ * Every parameter has a change generation, which is incremented whenever its value changes.
+ * The value is only copied if the generation differs from the one passed in, so that
+ * periodic re-reads (e.g. ModuleParams::updateParams()) only touch the changed parameters.
+ *
+ * @param param		A handle returned by param_find or passed by param_foreach.
+ * @param val		Where to return the value, assumed to point to suitable storage for the parameter type.
+ * @param generation	The generation of the value in val, 0 if there is none yet.
+ *			Updated with the generation of the copied value.
+ * @return		1 if the value was copied, 0 if it did not change, -1 on error
+ *			(e.g. for a struct parameter).
+ */
+__EXPORT int		param_get_if_changed(param_t param, void *val, uint16_t *generation);
+
 /**
  * Set the value of a parameter.
  *
@@ -276,6 +292,25 @@ __EXPORT int		param_set_no_notification(param_t param, const void *val);
  */
 __EXPORT void		param_notify_changes(void);
 
+/**
+ * Start a batch of parameter changes.
+ *
+ * parameter_update notifications of the calling thread are deferred until the matching
+ * param_batch_commit(), which publishes a single update covering all the changes (@see parameter_update.msg).
+ * Values are changed immediately, there is no rollback. Batches can be nested.
+ *
+ * Subscribers are only notified of the changes at the end of the batch (or with the next notification
+ * of another thread), i.e. up to the duration of the batch later. Notifications from other threads are
+ * not delayed.
+ */
+__EXPORT void		param_batch_begin(void);
+
+/**
+ * End a batch started with param_batch_begin(). Publishes one parameter_update if a notification
+ * was requested during the batch.
+ */
+__EXPORT void		param_batch_commit(void);
+
 /**
  * Reset a parameter to its default value.
  *
@@ -498,6 +533,16 @@ static inline int param_get(param_t param, int32_t *val)
 	CHECK_PARAM_TYPE(param, PARAM_TYPE_INT32);
 	return param_get(param, (void *)val);
 }
+static inline int param_get_if_changed(param_t param, float *val, uint16_t *generation)
+{
+	CHECK_PARAM_TYPE(param, PARAM_TYPE_FLOAT);
+	return param_get_if_changed(param, (void *)val, generation);
+}
+static inline int param_get_if_changed(param_t param, int32_t *val, uint16_t *generation)
+{
+	CHECK_PARAM_TYPE(param, PARAM_TYPE_INT32);
+	return param_get_if_changed(param, (void *)val, generation);
+}
 #undef CHECK_PARAM_TYPE
 
 #endif /* __cplusplus */
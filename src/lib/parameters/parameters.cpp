@@ -48,6 +48,7 @@
 #include <crc32.h>
 #include <float.h>
 #include <math.h>
+#include <pthread.h>
 
 #include <drivers/drv_hrt.h>
 #include <lib/perf/perf_counter.h>
@@ -56,7 +57,6 @@
 #include <px4_platform_common/posix.h>
 #include <px4_platform_common/sem.h>
 #include <px4_platform_common/shutdown.h>
-#include <systemlib/uthash/utarray.h>
 
 using namespace time_literals;
 
@@ -82,6 +82,28 @@ static const char *param_default_file = PX4_ROOTFSDIR"/eeprom/parameters";
 
 static char *param_user_file = nullptr;
 
+/*
+ * Parameter file journal: param_save_default() appends the values changed since the previous save
+ * as a record after the full BSON document, instead of rewriting the whole file. The file is rewritten
+ * (compacted) when the journal reaches PARAM_JOURNAL_MAX_SIZE or when values are reset, which a record
+ * cannot express. The journal starts with a record of length 0; every full write increments the epoch,
+ * so stale records left behind a shorter file are ignored, and a torn record fails its CRC check.
+ */
+#define PARAM_JOURNAL_MAGIC	0x4c4e4a50	///< 'PJNL'
+#define PARAM_JOURNAL_MAX_SIZE	4096		///< maximum journal size in bytes, before the file is compacted
+
+struct param_journal_record_s {
+	uint32_t magic;
+	uint32_t epoch;
+	uint32_t length; ///< length of the BSON document following the header, 0 for the start record
+	uint32_t crc; ///< CRC32 of the header fields above and of the document
+};
+
+static off_t param_journal_offset = -1; ///< file offset of the next record, -1 if the next save is a full write
+static size_t param_journal_size = 0; ///< bytes appended since the last full write
+static uint32_t param_journal_epoch = 0;
+static bool param_journal_full_write = true; ///< values were reset or exported to another file since the last save (protected by the writer lock)
+
 #ifdef __PX4_QURT
 #define PARAM_OPEN	px4_open
 #define PARAM_CLOSE	px4_close
@@ -105,16 +127,6 @@ static bool autosave_disabled = false;
 static const param_info_s *param_info_base = (const param_info_s *) &px4_parameters;
 #define	param_info_count px4_parameters.param_count
 
-/**
- * Storage for modified parameters.
- */
-struct param_wbuf_s {
-	union param_value_u	val;
-	param_t			param;
-	bool			unsaved;
-};
-
-
 uint8_t  *param_changed_storage = nullptr;
 int size_param_changed_storage_bytes = 0;
 const int bits_per_allocation_unit  = (sizeof(*param_changed_storage) * 8);
@@ -140,11 +152,52 @@ get_param_info_count()
 	return param_info_count;
 }
 
-/** flexible array holding modified parameter values */
-UT_array *param_values{nullptr};
+/**
+ * Storage for the parameter values and the bitmaps of the modified and of the unsaved values
+ * (allocated in param_init()).
+ *
+ * By default the values are dense: the current values and their change generations, indexed by the
+ * parameter handle (parallel to param_info_base). int32 and float values always hold the current value
+ * (the default if unchanged), so that they can be read without locking (see param_get_if_changed()).
+ * This costs sizeof(param_value_u) + 2 bytes per parameter (6 bytes on 32 bit, 10 bytes on 64 bit targets).
+ *
+ * Boards with CONSTRAINED_MEMORY only store the values that were ever modified, sorted by handle
+ * (8 bytes each on NuttX). Lookups are a binary search, and param_get_if_changed() takes
+ * the reader lock.
+ */
+#if defined(CONSTRAINED_MEMORY)
+struct param_value_entry_s {
+	union param_value_u value;
+	param_t param;
+	uint16_t generation;
+};
+
+static param_value_entry_s *param_value_entries{nullptr};
+static unsigned param_value_entries_count{0};
+static unsigned param_value_entries_capacity{0};
+#else
+static union param_value_u *param_values{nullptr};
+static uint16_t *param_values_generation{nullptr};
+#endif /* CONSTRAINED_MEMORY */
+static uint8_t *param_values_changed{nullptr};
+static uint8_t *param_values_unsaved{nullptr};
+
+static inline bool
+param_bit_get(const uint8_t *bitmap, param_t param)
+{
+	return bitmap[param / bits_per_allocation_unit] & (1 << param % bits_per_allocation_unit);
+}
+
+static inline void
+param_bit_set(uint8_t *bitmap, param_t param, bool value)
+{
+	if (value) {
+		bitmap[param / bits_per_allocation_unit] |= (1 << param % bits_per_allocation_unit);
 
-/** array info for the modified parameters array */
-const UT_icd param_icd = {sizeof(param_wbuf_s), nullptr, nullptr, nullptr};
+	} else {
+		bitmap[param / bits_per_allocation_unit] &= ~(1 << param % bits_per_allocation_unit);
+	}
+}
 
 #if !defined(PARAM_NO_ORB)
 /** parameter update topic handle */
@@ -154,8 +207,15 @@ static unsigned int param_instance = 0;
 
 static void param_set_used_internal(param_t param);
 
+static bool param_values_alloc();
+
 static param_t param_find_internal(const char *name, bool notification);
 
+static int param_export_internal(int fd, bool only_unsaved);
+static int param_journal_append(int fd);
+static int param_journal_start(int fd);
+static void param_journal_load(int fd);
+
 // the following implements an RW-lock using 2 semaphores (used as mutexes). It gives
 // priority to readers, meaning a writer could suffer from starvation, but in our use-case
 // we only have short periods of reads and writes are rare.
@@ -237,6 +297,15 @@ param_init()
 	param_find_perf = perf_alloc(PC_ELAPSED, "param_find");
 	param_get_perf = perf_alloc(PC_ELAPSED, "param_get");
 	param_set_perf = perf_alloc(PC_ELAPSED, "param_set");
+
+	// allocate the storage up front, so that lock-free readers find it
+	param_lock_writer();
+
+	if (!param_values_alloc()) {
+		PX4_ERR("failed to allocate modified values array");
+	}
+
+	param_unlock_writer();
 }
 
 /**
@@ -252,56 +321,292 @@ handle_in_range(param_t param)
 	return (count && param < count);
 }
 
+static size_t
+param_values_storage_size(unsigned count)
+{
+	const size_t bitmaps_size = 2 * ((count / bits_per_allocation_unit) + 1);
+#if defined(CONSTRAINED_MEMORY)
+	return param_value_entries_capacity * sizeof(param_value_entry_s) + bitmaps_size;
+#else
+	return count * (sizeof(union param_value_u) + sizeof(uint16_t)) + bitmaps_size;
+#endif /* CONSTRAINED_MEMORY */
+}
+
+static inline uint16_t
+param_generation_next(uint16_t generation)
+{
+	// 0 is reserved for callers that do not have a value yet
+	return (generation == UINT16_MAX) ? 1 : generation + 1;
+}
+
+#if defined(CONSTRAINED_MEMORY)
+/**
+ * Find the entry of a parameter, or the position to insert it.
+ */
+static unsigned
+param_value_entry_index(param_t param)
+{
+	unsigned low = 0;
+	unsigned high = param_value_entries_count;
+
+	while (low < high) {
+		const unsigned middle = (low + high) / 2;
+
+		if (param_value_entries[middle].param < param) {
+			low = middle + 1;
+
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+static param_value_entry_s *
+param_value_entry_find(param_t param)
+{
+	const unsigned index = param_value_entry_index(param);
+
+	if (index < param_value_entries_count && param_value_entries[index].param == param) {
+		return &param_value_entries[index];
+	}
+
+	return nullptr;
+}
+#endif /* CONSTRAINED_MEMORY */
+
 /**
- * Compare two modifid parameter structures to determine ordering.
+ * Get the stored value of a parameter (the current value, if the parameter is changed).
  *
- * This function is suitable for passing to qsort or bsearch.
+ * @return			the value, or nullptr if nothing is stored for the parameter
  */
-static int
-param_compare_values(const void *a, const void *b)
+static union param_value_u *
+param_values_get(param_t param)
 {
-	struct param_wbuf_s *pa = (struct param_wbuf_s *)a;
-	struct param_wbuf_s *pb = (struct param_wbuf_s *)b;
+#if defined(CONSTRAINED_MEMORY)
+	param_value_entry_s *entry = param_value_entry_find(param);
+	return (entry != nullptr) ? &entry->value : nullptr;
+#else
+	return &param_values[param];
+#endif /* CONSTRAINED_MEMORY */
+}
 
-	if (pa->param < pb->param) {
-		return -1;
+/**
+ * Get the storage for the value of a parameter, allocate it if needed. Called with the writer lock held.
+ *
+ * @return			the value (initialized to the default), or nullptr if the allocation failed
+ */
+static union param_value_u *
+param_values_get_storage(param_t param)
+{
+#if defined(CONSTRAINED_MEMORY)
+	const unsigned index = param_value_entry_index(param);
+
+	if (index < param_value_entries_count && param_value_entries[index].param == param) {
+		return &param_value_entries[index].value;
 	}
 
-	if (pa->param > pb->param) {
-		return 1;
+	if (param_value_entries_count == param_value_entries_capacity) {
+		// an import sets the parameters in handle order, so most inserts append
+		const unsigned capacity = (param_value_entries_capacity == 0) ? 32 : param_value_entries_capacity * 3 / 2;
+		param_value_entry_s *entries = (param_value_entry_s *)realloc(param_value_entries, capacity * sizeof(param_value_entry_s));
+
+		if (entries == nullptr) {
+			return nullptr;
+		}
+
+		param_value_entries = entries;
+		param_value_entries_capacity = capacity;
 	}
 
-	return 0;
+	memmove(&param_value_entries[index + 1], &param_value_entries[index],
+		(param_value_entries_count - index) * sizeof(param_value_entry_s));
+	param_value_entries_count++;
+
+	param_value_entry_s &entry = param_value_entries[index];
+	entry.param = param;
+	entry.generation = 1;
+	entry.value = param_info_base[param].val;
+
+	if (param_info_base[param].type >= PARAM_TYPE_STRUCT && param_info_base[param].type <= PARAM_TYPE_STRUCT_MAX) {
+		entry.value.p = nullptr;
+	}
+
+	return &entry.value;
+#else
+	return &param_values[param];
+#endif /* CONSTRAINED_MEMORY */
+}
+
+/**
+ * Restore the default of an int32 or float parameter in param_values.
+ * Struct parameters keep their storage, it is reused on the next modification.
+ */
+static void
+param_values_set_default(param_t param)
+{
+	if (param_info_base[param].type == PARAM_TYPE_INT32 || param_info_base[param].type == PARAM_TYPE_FLOAT) {
+		union param_value_u *value = param_values_get(param);
+
+		if (value != nullptr) {
+			*value = param_info_base[param].val;
+		}
+	}
+}
+
+/**
+ * Allocate the storage for the parameter values, if not done yet.
+ *
+ * @return			true on success
+ */
+static bool
+param_values_alloc()
+{
+	param_assert_locked();
+
+	if (param_values_changed == nullptr) {
+		const unsigned count = get_param_info_count();
+		const size_t bitmap_size = (count / bits_per_allocation_unit) + 1;
+
+#if defined(CONSTRAINED_MEMORY)
+		uint8_t *bitmaps = (uint8_t *)calloc(2 * bitmap_size, 1);
+
+		if (bitmaps == nullptr) {
+			return false;
+		}
+
+		param_values_unsaved = bitmaps + bitmap_size;
+		param_values_changed = bitmaps;
+#else
+		uint8_t *storage = (uint8_t *)calloc(param_values_storage_size(count), 1);
+
+		if (storage == nullptr) {
+			return false;
+		}
+
+		union param_value_u *values = (union param_value_u *)storage;
+		param_values_generation = (uint16_t *)(storage + count * sizeof(union param_value_u));
+		param_values_unsaved = (uint8_t *)(param_values_generation + count) + bitmap_size;
+
+		for (param_t param = 0; param < count; param++) {
+			values[param] = param_info_base[param].val;
+			param_values_generation[param] = 1;
+
+			if (param_info_base[param].type >= PARAM_TYPE_STRUCT && param_info_base[param].type <= PARAM_TYPE_STRUCT_MAX) {
+				values[param].p = nullptr;
+			}
+		}
+
+		param_values_changed = (uint8_t *)(param_values_generation + count);
+
+		// publish the pointer after the initialization (pairs with the acquire in param_get_if_changed())
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		param_values = values;
+#endif /* CONSTRAINED_MEMORY */
+	}
+
+	return true;
+}
+
+/**
+ * Mark the stored value of a parameter as changed for the lock-free readers.
+ * Called with the writer lock held, after the value is written.
+ */
+static void
+param_values_generation_bump(param_t param)
+{
+#if defined(CONSTRAINED_MEMORY)
+	param_value_entry_s *entry = param_value_entry_find(param);
+
+	if (entry != nullptr) {
+		entry->generation = param_generation_next(entry->generation);
+	}
+
+#else
+	// order the value write before the generation write (pairs with the acquire in param_get_if_changed())
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	*(volatile uint16_t *)&param_values_generation[param] = param_generation_next(param_values_generation[param]);
+#endif /* CONSTRAINED_MEMORY */
 }
 
 /**
- * Locate the modified parameter structure for a parameter, if it exists.
+ * Check whether a parameter has a modified value.
  *
- * @param param			The parameter being searched.
- * @return			The structure holding the modified value, or
- *				nullptr if the parameter has not been modified.
+ * @param param			The parameter being checked (must be in range).
+ * @return			true if param_values holds a modified value for the parameter.
  */
-static param_wbuf_s *
-param_find_changed(param_t param)
+static inline bool
+param_is_changed(param_t param)
 {
-	param_wbuf_s	*s = nullptr;
+	param_assert_locked();
+
+	return param_values_changed != nullptr && param_bit_get(param_values_changed, param);
+}
+
+/*
+ * Changes that are not published yet, protected by the writer lock. While a thread has a batch open
+ * (param_batch_begin()), its notifications are deferred and published as one update at the end.
+ * Notifications from other threads are published immediately (including the changes of the open batches).
+ */
+struct param_batch_s {
+	pthread_t owner;
+	int depth; ///< 0 if the slot is free
+};
 
+static param_batch_s param_batches[4] {};
+static bool param_notify_pending = false;
+static uint32_t param_changes_pending = 0;
+static param_t param_changes_pending_min = 0;
+static param_t param_changes_pending_max = 0;
+
+/**
+ * Record a parameter change for the next parameter_update. Called with the writer lock held.
+ */
+static void
+param_record_change(param_t param)
+{
 	param_assert_locked();
 
-	if (param_values != nullptr) {
-		param_wbuf_s key{};
-		key.param = param;
-		s = (param_wbuf_s *)utarray_find(param_values, &key, param_compare_values);
+	if (param_changes_pending == 0 || param < param_changes_pending_min) {
+		param_changes_pending_min = param;
+	}
+
+	if (param_changes_pending == 0 || param > param_changes_pending_max) {
+		param_changes_pending_max = param;
 	}
 
-	return s;
+	++param_changes_pending;
 }
 
+/**
+ * Publish parameter_update with the pending changes. Called with the writer lock held, releases it.
+ */
 static void
-_param_notify_changes()
+param_publish_changes_and_unlock()
 {
 #if !defined(PARAM_NO_ORB)
 	parameter_update_s pup = {};
+	pup.changed = param_changes_pending;
+
+	if (param_changes_pending > 0) {
+		pup.changed_index_min = param_changes_pending_min;
+		pup.changed_index_max = param_changes_pending_max;
+
+	} else if (get_param_info_count() > 0) {
+		// unknown changes (e.g. param_notify_changes() without a tracked change)
+		pup.changed_index_max = get_param_info_count() - 1;
+	}
+
+#endif
+
+	param_notify_pending = false;
+	param_changes_pending = 0;
+
+	param_unlock_writer();
+
+#if !defined(PARAM_NO_ORB)
 	pup.timestamp = hrt_absolute_time();
 	pup.instance = param_instance++;
 
@@ -319,12 +624,140 @@ _param_notify_changes()
 #endif
 }
 
+/**
+ * Get the open batch of the calling thread. Called with the writer lock held.
+ *
+ * @param free_slot		if set, return a free slot if the thread has no open batch
+ * @return			the batch, or nullptr
+ */
+static param_batch_s *
+param_batch_get(bool free_slot)
+{
+	const pthread_t self = pthread_self();
+	param_batch_s *free_batch = nullptr;
+
+	for (param_batch_s &batch : param_batches) {
+		if (batch.depth > 0 && pthread_equal(batch.owner, self)) {
+			return &batch;
+
+		} else if (batch.depth == 0 && free_batch == nullptr) {
+			free_batch = &batch;
+		}
+	}
+
+	return free_slot ? free_batch : nullptr;
+}
+
+static void
+_param_notify_changes()
+{
+	param_lock_writer();
+
+	param_notify_pending = true;
+
+	if (param_batch_get(false) != nullptr) {
+		// published by param_batch_commit()
+		param_unlock_writer();
+		return;
+	}
+
+	param_publish_changes_and_unlock();
+}
+
 void
 param_notify_changes()
 {
 	_param_notify_changes();
 }
 
+void
+param_batch_begin()
+{
+	param_lock_writer();
+
+	param_batch_s *batch = param_batch_get(true);
+
+	// without a free slot the changes are published unbatched
+	if (batch != nullptr) {
+		batch->owner = pthread_self();
+		++batch->depth;
+	}
+
+	param_unlock_writer();
+}
+
+void
+param_batch_commit()
+{
+	param_lock_writer();
+
+	param_batch_s *batch = param_batch_get(false);
+
+	if (batch != nullptr && --batch->depth == 0 && param_notify_pending) {
+		param_publish_changes_and_unlock();
+
+	} else {
+		param_unlock_writer();
+	}
+}
+
+#ifdef PX4_PARAMETERS_HASH_SIZE
+/**
+ * Seeded 32 bit FNV-1a hash with a final avalanche (murmur3 fmix32), must match param_hash() in px_generate_params.py.
+ * Without the final mix, the low bits (hash % n for small n) do not depend on the seed.
+ */
+static inline uint32_t
+param_hash(const char *name, uint32_t seed)
+{
+	uint32_t hash = 0x811c9dc5u ^ seed;
+
+	while (*name) {
+		hash ^= (uint8_t) * name++;
+		hash *= 0x01000193u;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+param_t
+param_find_internal(const char *name, bool notification)
+{
+	perf_begin(param_find_perf);
+
+	/* look up the only candidate in the generated perfect hash table */
+	const int16_t bucket = px4_parameters_hash_buckets[param_hash(name, 0) % PX4_PARAMETERS_HASH_SIZE];
+	param_t param;
+
+	if (bucket < 0) {
+		param = -bucket - 1;
+
+	} else {
+		param = px4_parameters_hash_slots[param_hash(name, bucket) % PX4_PARAMETERS_HASH_SIZE];
+	}
+
+	if (strcmp(name, param_info_base[param].name) == 0) {
+		if (notification) {
+			param_set_used_internal(param);
+		}
+
+		perf_end(param_find_perf);
+		return param;
+	}
+
+	perf_end(param_find_perf);
+
+	/* not found */
+	return PARAM_INVALID;
+}
+
+#else
+
 param_t
 param_find_internal(const char *name, bool notification)
 {
@@ -365,6 +798,7 @@ param_find_internal(const char *name, bool notification)
 	/* not found */
 	return PARAM_INVALID;
 }
+#endif /* PX4_PARAMETERS_HASH_SIZE */
 
 param_t
 param_find(const char *name)
@@ -497,20 +931,25 @@ param_is_volatile(param_t param)
 bool
 param_value_is_default(param_t param)
 {
-	struct param_wbuf_s *s;
+	if (!handle_in_range(param)) {
+		return true;
+	}
+
 	param_lock_reader();
-	s = param_find_changed(param);
+	bool ret = !param_is_changed(param);
 	param_unlock_reader();
-	return s == nullptr;
+	return ret;
 }
 
 bool
 param_value_unsaved(param_t param)
 {
-	struct param_wbuf_s *s;
+	if (!handle_in_range(param)) {
+		return false;
+	}
+
 	param_lock_reader();
-	s = param_find_changed(param);
-	bool ret = s && s->unsaved;
+	bool ret = param_is_changed(param) && param_bit_get(param_values_unsaved, param);
 	param_unlock_reader();
 	return ret;
 }
@@ -560,17 +999,8 @@ param_get_value_ptr(param_t param)
 
 	if (handle_in_range(param)) {
 
-		const union param_value_u *v;
-
 		/* work out whether we're fetching the default or a written value */
-		struct param_wbuf_s *s = param_find_changed(param);
-
-		if (s != nullptr) {
-			v = &s->val;
-
-		} else {
-			v = &param_info_base[param].val;
-		}
+		const union param_value_u *v = param_is_changed(param) ? param_values_get(param) : &param_info_base[param].val;
 
 		if (param_type(param) >= PARAM_TYPE_STRUCT &&
 		    param_type(param) <= PARAM_TYPE_STRUCT_MAX) {
@@ -606,30 +1036,88 @@ param_get(param_t param, void *val)
 	return result;
 }
 
-#ifndef PARAM_NO_AUTOSAVE
-/**
- * worker callback method to save the parameters
- * @param arg unused
- */
-static void
-autosave_worker(void *arg)
+int
+param_get_if_changed(param_t param, void *val, uint16_t *generation)
 {
-	bool disabled = false;
+	if (!handle_in_range(param) || val == nullptr || generation == nullptr
+	    || (param_type(param) != PARAM_TYPE_INT32 && param_type(param) != PARAM_TYPE_FLOAT)) {
+		return -1;
+	}
 
-#if !defined(PARAM_NO_ORB)
+#if defined(CONSTRAINED_MEMORY)
+	// sparse storage, which moves on inserts: read with the lock held
+	param_lock_reader();
 
-	if (!param_get_default_file()) {
-		// In case we save to FLASH, defer param writes until disarmed,
-		// as writing to FLASH can stall the entire CPU (in rare cases around 300ms on STM32F7)
-		uORB::SubscriptionData<actuator_armed_s> armed_sub{ORB_ID(actuator_armed)};
+	const param_value_entry_s *entry = param_value_entry_find(param);
+	const uint16_t entry_generation = (entry != nullptr) ? entry->generation : 1;
+	int ret = 0;
 
-		if (armed_sub.get().armed) {
-			work_queue(LPWORK, &autosave_work, (worker_t)&autosave_worker, nullptr, USEC2TICK(1_s));
-			return;
-		}
+	if (entry_generation != *generation) {
+		const union param_value_u *v = (entry != nullptr) ? &entry->value : &param_info_base[param].val;
+		memcpy(val, v, sizeof(int32_t));
+		*generation = entry_generation;
+		ret = 1;
 	}
 
-#endif
+	param_unlock_reader();
+
+	return ret;
+#else
+	const union param_value_u *values = *(union param_value_u *volatile *)&param_values;
+
+	if (values == nullptr) {
+		// the storage failed to allocate, use the locked path
+		if (param_get(param, val) != 0) {
+			return -1;
+		}
+
+		*generation = 0;
+		return 1;
+	}
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	const uint16_t current_generation = *(volatile uint16_t *)&param_values_generation[param];
+
+	if (current_generation == *generation) {
+		return 0;
+	}
+
+	// order the value read after the generation read (pairs with the release in param_values_generation_bump())
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	const int32_t value = *(volatile int32_t *)&values[param].i;
+	memcpy(val, &value, sizeof(value));
+	*generation = current_generation;
+
+	return 1;
+#endif /* CONSTRAINED_MEMORY */
+}
+
+#ifndef PARAM_NO_AUTOSAVE
+/**
+ * worker callback method to save the parameters
+ * @param arg unused
+ */
+static void
+autosave_worker(void *arg)
+{
+	bool disabled = false;
+
+#if !defined(PARAM_NO_ORB)
+
+	if (!param_get_default_file()) {
+		// In case we save to FLASH, defer param writes until disarmed,
+		// as writing to FLASH can stall the entire CPU (in rare cases around 300ms on STM32F7)
+		uORB::SubscriptionData<actuator_armed_s> armed_sub{ORB_ID(actuator_armed)};
+
+		if (armed_sub.get().armed) {
+			work_queue(LPWORK, &autosave_work, (worker_t)&autosave_worker, nullptr, USEC2TICK(1_s));
+			return;
+		}
+	}
+
+#endif
 
 	param_lock_writer();
 	last_autosave_timestamp = hrt_absolute_time();
@@ -708,76 +1196,72 @@ param_set_internal(param_t param, const void *val, bool mark_saved, bool notify_
 	param_lock_writer();
 	perf_begin(param_set_perf);
 
-	if (param_values == nullptr) {
-		utarray_new(param_values, &param_icd);
-	}
-
-	if (param_values == nullptr) {
+	if (!param_values_alloc()) {
 		PX4_ERR("failed to allocate modified values array");
 		goto out;
 	}
 
 	if (handle_in_range(param)) {
 
-		param_wbuf_s *s = param_find_changed(param);
-
-		if (s == nullptr) {
-
-			/* construct a new parameter */
-			param_wbuf_s buf = {};
-			buf.param = param;
+		union param_value_u *v = param_values_get_storage(param);
 
-			params_changed = true;
-
-			/* add it to the array and sort */
-			utarray_push_back(param_values, &buf);
-			utarray_sort(param_values, param_compare_values);
-
-			/* find it after sorting */
-			s = param_find_changed(param);
+		if (v == nullptr) {
+			PX4_ERR("failed to allocate parameter storage");
+			goto out;
 		}
 
+		/* a value that was not modified before is always a change */
+		params_changed = !param_is_changed(param);
+
 		/* update the changed value */
 		switch (param_type(param)) {
 
 		case PARAM_TYPE_INT32:
-			params_changed = params_changed || s->val.i != *(int32_t *)val;
-			s->val.i = *(int32_t *)val;
+			params_changed = params_changed || v->i != *(int32_t *)val;
+			v->i = *(int32_t *)val;
 			break;
 
 		case PARAM_TYPE_FLOAT:
-			params_changed = params_changed || fabsf(s->val.f - * (float *)val) > FLT_EPSILON;
-			s->val.f = *(float *)val;
+			params_changed = params_changed || fabsf(v->f - * (float *)val) > FLT_EPSILON;
+			v->f = *(float *)val;
 			break;
 
 		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
-			if (s->val.p == nullptr) {
+			/* the storage is kept on reset and reused here */
+			if (v->p == nullptr) {
 				size_t psize = param_size(param);
 
 				if (psize > 0) {
-					s->val.p = malloc(psize);
-
-				} else {
-					s->val.p = nullptr;
+					v->p = malloc(psize);
 				}
 
-				if (s->val.p == nullptr) {
+				if (v->p == nullptr) {
 					PX4_ERR("failed to allocate parameter storage");
+					params_changed = false;
 					goto out;
 				}
 			}
 
-			memcpy(s->val.p, val, param_size(param));
+			memcpy(v->p, val, param_size(param));
 			params_changed = true;
 			break;
 
 		default:
+			params_changed = false;
 			goto out;
 		}
 
-		s->unsaved = !mark_saved;
+		param_bit_set(param_values_changed, param, true);
+		param_bit_set(param_values_unsaved, param, !mark_saved);
 		result = 0;
 
+		// also on float changes below FLT_EPSILON, so that lock-free readers get the exact value
+		param_values_generation_bump(param);
+
+		if (params_changed) {
+			param_record_change(param);
+		}
+
 		if (!mark_saved) { // this is false when importing parameters
 			param_autosave();
 		}
@@ -808,6 +1292,19 @@ const void *param_get_value_ptr_external(param_t param)
 {
 	return param_get_value_ptr(param);
 }
+
+bool param_value_changed_external(param_t param, bool only_unsaved)
+{
+	return handle_in_range(param) && param_is_changed(param)
+	       && (!only_unsaved || param_bit_get(param_values_unsaved, param));
+}
+
+void param_mark_saved_external(param_t param)
+{
+	if (handle_in_range(param) && param_values_unsaved != nullptr) {
+		param_bit_set(param_values_unsaved, param, false);
+	}
+}
 #endif
 
 int
@@ -856,20 +1353,23 @@ void param_set_used_internal(param_t param)
 int
 param_reset(param_t param)
 {
-	param_wbuf_s *s = nullptr;
+	bool param_changed = false;
 	bool param_found = false;
 
 	param_lock_writer();
 
 	if (handle_in_range(param)) {
 
-		/* look for a saved value */
-		s = param_find_changed(param);
+		/* if there is a modified value, drop it */
+		param_changed = param_is_changed(param);
 
-		/* if we found one, erase it */
-		if (s != nullptr) {
-			int pos = utarray_eltidx(param_values, s);
-			utarray_erase(param_values, pos, 1);
+		if (param_changed) {
+			param_values_set_default(param);
+			param_bit_set(param_values_changed, param, false);
+			param_bit_set(param_values_unsaved, param, false);
+			param_values_generation_bump(param);
+			param_record_change(param);
+			param_journal_full_write = true;
 		}
 
 		param_found = true;
@@ -879,7 +1379,7 @@ param_reset(param_t param)
 
 	param_unlock_writer();
 
-	if (s != nullptr) {
+	if (param_changed) {
 		_param_notify_changes();
 	}
 
@@ -890,12 +1390,21 @@ param_reset_all_internal(bool auto_save)
 {
 	param_lock_writer();
 
-	if (param_values != nullptr) {
-		utarray_free(param_values);
-	}
+	/* mark as reset / deleted (the storage itself is kept) */
+	if (param_values_changed != nullptr) {
+		for (param_t param = 0; handle_in_range(param); param++) {
+			if (param_is_changed(param)) {
+				param_values_set_default(param);
+				param_values_generation_bump(param);
+				param_record_change(param);
+				param_journal_full_write = true;
+			}
+		}
 
-	/* mark as reset / deleted */
-	param_values = nullptr;
+		const size_t bitmap_size = (get_param_info_count() / bits_per_allocation_unit) + 1;
+		memset(param_values_changed, 0, bitmap_size);
+		memset(param_values_unsaved, 0, bitmap_size);
+	}
 
 	if (auto_save) {
 		param_autosave();
@@ -917,6 +1426,8 @@ param_reset_excludes(const char *excludes[], int num_excludes)
 {
 	param_t	param;
 
+	param_batch_begin();
+
 	for (param = 0; handle_in_range(param); param++) {
 		const char *name = param_name(param);
 		bool exclude = false;
@@ -939,6 +1450,7 @@ param_reset_excludes(const char *excludes[], int num_excludes)
 	}
 
 	_param_notify_changes();
+	param_batch_commit();
 }
 
 int
@@ -959,6 +1471,9 @@ param_set_default_file(const char *filename)
 		param_user_file = strdup(filename);
 	}
 
+	// the journal belongs to the previous file
+	param_journal_offset = -1;
+
 #endif /* FLASH_BASED_PARAMS */
 
 	return 0;
@@ -994,18 +1509,54 @@ param_save_default()
 		return PX4_ERROR;
 	}
 
+	int shutdown_lock_ret = px4_shutdown_lock();
+
+	if (shutdown_lock_ret) {
+		PX4_ERR("px4_shutdown_lock() failed (%i)", shutdown_lock_ret);
+	}
+
+	// take the file lock
+	do {} while (px4_sem_wait(&param_sem_save) != 0);
+
+	perf_begin(param_export_perf);
+
+	// only append the changed values if possible
+	res = param_journal_append(fd);
+
+	if (res != PX4_OK) {
+		// full write, which also compacts the journal. Values reset from here on need another one.
+		param_journal_offset = -1;
+
+		param_lock_writer();
+		param_journal_full_write = false;
+		param_unlock_writer();
+	}
+
 	int attempts = 5;
 
 	while (res != OK && attempts > 0) {
-		res = param_export(fd, false);
+		lseek(fd, 0, SEEK_SET); // jump back to the beginning of the file
+		res = param_export_internal(fd, false);
+
+		if (res == PX4_OK) {
+			res = param_journal_start(fd);
+		}
+
 		attempts--;
 
 		if (res != PX4_OK) {
 			PX4_ERR("param_export failed, retrying %d", attempts);
-			lseek(fd, 0, SEEK_SET); // jump back to the beginning of the file
 		}
 	}
 
+	perf_end(param_export_perf);
+
+	px4_sem_post(&param_sem_save);
+
+	if (shutdown_lock_ret == 0) {
+		px4_shutdown_unlock();
+	}
+
 	if (res != OK) {
 		PX4_ERR("failed to write parameters to file: %s", filename);
 	}
@@ -1040,7 +1591,32 @@ param_load_default()
 		return 1;
 	}
 
+	// take the file lock, the journal state must match the file
+	do {} while (px4_sem_wait(&param_sem_save) != 0);
+
+	// a single parameter_update for the file and its journal
+	param_batch_begin();
+
 	int result = param_load(fd_load);
+
+	if (result == 0) {
+		param_journal_load(fd_load);
+
+		if (param_journal_offset >= 0) {
+			// the file now matches the values, the next save can append to it
+			param_lock_writer();
+			param_journal_full_write = false;
+			param_unlock_writer();
+		}
+
+	} else {
+		param_journal_offset = -1;
+	}
+
+	param_batch_commit();
+
+	px4_sem_post(&param_sem_save);
+
 	PARAM_CLOSE(fd_load);
 
 	if (result != 0) {
@@ -1051,32 +1627,76 @@ param_load_default()
 	return res;
 }
 
-int
-param_export(int fd, bool only_unsaved)
+/**
+ * Append the value of a parameter to a BSON document. Called with the reader lock held.
+ *
+ * @return			0 on success, -1 otherwise
+ */
+static int
+param_export_value(bson_encoder_t encoder, param_t param)
 {
-	int	result = -1;
-	perf_begin(param_export_perf);
+	const char *name = param_name(param);
+	const size_t size = param_size(param);
 
-	if (fd < 0) {
-		param_lock_writer();
-		// flash_param_save() will take the shutdown lock
-		result = flash_param_save(only_unsaved);
-		param_unlock_writer();
-		perf_end(param_export_perf);
-		return result;
-	}
+	/* append the appropriate BSON type object */
+	switch (param_type(param)) {
 
-	param_wbuf_s *s = nullptr;
-	struct bson_encoder_s encoder;
+	case PARAM_TYPE_INT32: {
+			const int32_t i = param_values_get(param)->i;
 
-	int shutdown_lock_ret = px4_shutdown_lock();
+			PX4_DEBUG("exporting: %s (%d) size: %d val: %d", name, param, size, i);
 
-	if (shutdown_lock_ret) {
-		PX4_ERR("px4_shutdown_lock() failed (%i)", shutdown_lock_ret);
+			if (bson_encoder_append_int(encoder, name, i)) {
+				PX4_ERR("BSON append failed for '%s'", name);
+				return -1;
+			}
+		}
+		break;
+
+	case PARAM_TYPE_FLOAT: {
+			const double f = (double)param_values_get(param)->f;
+
+			PX4_DEBUG("exporting: %s (%d) size: %d val: %.3f", name, param, size, (double)f);
+
+			if (bson_encoder_append_double(encoder, name, f)) {
+				PX4_ERR("BSON append failed for '%s'", name);
+				return -1;
+			}
+		}
+		break;
+
+	case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX: {
+			const void *value_ptr = param_get_value_ptr(param);
+
+			/* lock as short as possible */
+			if (bson_encoder_append_binary(encoder,
+						       name,
+						       BSON_BIN_BINARY,
+						       size,
+						       value_ptr)) {
+
+				PX4_ERR("BSON append failed for '%s'", name);
+				return -1;
+			}
+		}
+		break;
+
+	default:
+		PX4_ERR("unrecognized parameter type");
+		return -1;
 	}
 
-	// take the file lock
-	do {} while (px4_sem_wait(&param_sem_save) != 0);
+	return 0;
+}
+
+/**
+ * Export the parameters to a file, at its current position. Called with param_sem_save held.
+ */
+static int
+param_export_internal(int fd, bool only_unsaved)
+{
+	int	result = -1;
+	struct bson_encoder_s encoder;
 
 	param_lock_reader();
 
@@ -1084,70 +1704,27 @@ param_export(int fd, bool only_unsaved)
 	bson_encoder_init_buf_file(&encoder, fd, &bson_buffer, sizeof(bson_buffer));
 
 	/* no modified parameters -> we are done */
-	if (param_values == nullptr) {
+	if (param_values_changed == nullptr) {
 		result = 0;
 		goto out;
 	}
 
-	while ((s = (struct param_wbuf_s *)utarray_next(param_values, s)) != nullptr) {
+	for (param_t param = 0; handle_in_range(param); param++) {
+		if (!param_is_changed(param)) {
+			continue;
+		}
+
 		/*
 		 * If we are only saving values changed since last save, and this
 		 * one hasn't, then skip it
 		 */
-		if (only_unsaved && !s->unsaved) {
+		if (only_unsaved && !param_bit_get(param_values_unsaved, param)) {
 			continue;
 		}
 
-		s->unsaved = false;
-
-		const char *name = param_name(s->param);
-		const size_t size = param_size(s->param);
-
-		/* append the appropriate BSON type object */
-		switch (param_type(s->param)) {
+		param_bit_set(param_values_unsaved, param, false);
 
-		case PARAM_TYPE_INT32: {
-				const int32_t i = s->val.i;
-
-				PX4_DEBUG("exporting: %s (%d) size: %d val: %d", name, s->param, size, i);
-
-				if (bson_encoder_append_int(&encoder, name, i)) {
-					PX4_ERR("BSON append failed for '%s'", name);
-					goto out;
-				}
-			}
-			break;
-
-		case PARAM_TYPE_FLOAT: {
-				const double f = (double)s->val.f;
-
-				PX4_DEBUG("exporting: %s (%d) size: %d val: %.3f", name, s->param, size, (double)f);
-
-				if (bson_encoder_append_double(&encoder, name, f)) {
-					PX4_ERR("BSON append failed for '%s'", name);
-					goto out;
-				}
-			}
-			break;
-
-		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX: {
-				const void *value_ptr = param_get_value_ptr(s->param);
-
-				/* lock as short as possible */
-				if (bson_encoder_append_binary(&encoder,
-							       name,
-							       BSON_BIN_BINARY,
-							       size,
-							       value_ptr)) {
-
-					PX4_ERR("BSON append failed for '%s'", name);
-					goto out;
-				}
-			}
-			break;
-
-		default:
-			PX4_ERR("unrecognized parameter type");
+		if (param_export_value(&encoder, param) != 0) {
 			goto out;
 		}
 	}
@@ -1164,6 +1741,40 @@ out:
 
 	param_unlock_reader();
 
+	return result;
+}
+
+int
+param_export(int fd, bool only_unsaved)
+{
+	int	result = -1;
+	perf_begin(param_export_perf);
+
+	if (fd < 0) {
+		param_lock_writer();
+		// flash_param_save() will take the shutdown lock
+		result = flash_param_save(only_unsaved);
+		param_unlock_writer();
+		perf_end(param_export_perf);
+		return result;
+	}
+
+	int shutdown_lock_ret = px4_shutdown_lock();
+
+	if (shutdown_lock_ret) {
+		PX4_ERR("px4_shutdown_lock() failed (%i)", shutdown_lock_ret);
+	}
+
+	// take the file lock
+	do {} while (px4_sem_wait(&param_sem_save) != 0);
+
+	// this clears the unsaved flags, which the journal of the default file relies on: compact it on the next save
+	param_lock_writer();
+	param_journal_full_write = true;
+	param_unlock_writer();
+
+	result = param_export_internal(fd, only_unsaved);
+
 	px4_sem_post(&param_sem_save);
 
 	if (shutdown_lock_ret == 0) {
@@ -1328,25 +1939,229 @@ param_import_internal(int fd, bool mark_saved)
 	return result;
 }
 
+static uint32_t
+param_journal_crc(const param_journal_record_s &record, const uint8_t *data)
+{
+	const uint32_t crc = crc32part((const uint8_t *)&record, sizeof(record) - sizeof(record.crc), 0);
+	return crc32part(data, record.length, crc);
+}
+
+/**
+ * Append the values changed since the last save as a journal record, at param_journal_offset.
+ * Called with param_sem_save held.
+ *
+ * @return			0 on success, 1 if a full write is needed instead
+ */
+static int
+param_journal_append(int fd)
+{
+	if (param_journal_offset < 0) {
+		return 1;
+	}
+
+	struct bson_encoder_s encoder;
+	bool empty = true;
+	int result = 1;
+
+	param_lock_reader();
+
+	if (param_journal_full_write || param_values_unsaved == nullptr || bson_encoder_init_buf(&encoder, nullptr, 0) != 0) {
+		param_unlock_reader();
+		return 1;
+	}
+
+	for (param_t param = 0; handle_in_range(param); param++) {
+		// only changed values can be unsaved
+		if (!param_bit_get(param_values_unsaved, param)) {
+			continue;
+		}
+
+		param_bit_set(param_values_unsaved, param, false);
+
+		if (param_export_value(&encoder, param) != 0) {
+			goto out;
+		}
+
+		empty = false;
+	}
+
+	if (bson_encoder_fini(&encoder) != PX4_OK) {
+		goto out;
+	}
+
+	param_unlock_reader();
+
+	if (empty) {
+		result = 0;
+
+	} else {
+		param_journal_record_s record;
+		record.magic = PARAM_JOURNAL_MAGIC;
+		record.epoch = param_journal_epoch;
+		record.length = bson_encoder_buf_size(&encoder);
+
+		const uint8_t *data = (const uint8_t *)bson_encoder_buf_data(&encoder);
+		record.crc = param_journal_crc(record, data);
+
+		const size_t record_size = sizeof(record) + record.length;
+
+		// otherwise compact the file
+		if (param_journal_size + record_size <= PARAM_JOURNAL_MAX_SIZE) {
+			if (lseek(fd, param_journal_offset, SEEK_SET) == param_journal_offset
+			    && write(fd, &record, sizeof(record)) == sizeof(record)
+			    && write(fd, data, record.length) == (ssize_t)record.length) {
+
+				fsync(fd);
+				param_journal_offset += record_size;
+				param_journal_size += record_size;
+				result = 0;
+
+			} else {
+				PX4_ERR("param journal write failed");
+			}
+		}
+	}
+
+	free(bson_encoder_buf_data(&encoder));
+	return result;
+
+out:
+	param_unlock_reader();
+	free(bson_encoder_buf_data(&encoder));
+	return result;
+}
+
+/**
+ * Start a new journal after a full write, at the current file position. Called with param_sem_save held.
+ *
+ * @return			0 on success, -1 otherwise
+ */
+static int
+param_journal_start(int fd)
+{
+	if (param_journal_epoch == 0) {
+		// no journal was loaded: make sure not to continue the epoch of stale records in the file
+		param_journal_epoch = (uint32_t)hrt_absolute_time();
+	}
+
+	param_journal_record_s record;
+	record.magic = PARAM_JOURNAL_MAGIC;
+	record.epoch = param_journal_epoch + 1;
+	record.length = 0;
+	record.crc = param_journal_crc(record, nullptr);
+
+	const off_t offset = lseek(fd, 0, SEEK_CUR);
+
+	if (offset < 0 || write(fd, &record, sizeof(record)) != sizeof(record)) {
+		PX4_ERR("param journal start failed");
+		return -1;
+	}
+
+	fsync(fd);
+
+	param_journal_epoch = record.epoch;
+	param_journal_offset = offset + sizeof(record);
+	param_journal_size = 0;
+
+	return 0;
+}
+
+/**
+ * Import the journal records following the full parameter document, until the first invalid one (e.g.
+ * from power loss during a save). Called with param_sem_save held.
+ * Sets param_journal_offset to -1 if the file has no journal (written by an older version).
+ */
+static void
+param_journal_load(int fd)
+{
+	param_journal_offset = -1;
+	param_journal_size = 0;
+
+	param_journal_record_s record;
+	off_t offset = lseek(fd, 0, SEEK_CUR);
+
+	if (offset < 0 || read(fd, &record, sizeof(record)) != sizeof(record)
+	    || record.magic != PARAM_JOURNAL_MAGIC || record.length != 0
+	    || record.crc != param_journal_crc(record, nullptr)) {
+		return;
+	}
+
+	param_journal_epoch = record.epoch;
+	offset += sizeof(record);
+
+	for (;;) {
+		if (read(fd, &record, sizeof(record)) != sizeof(record)
+		    || record.magic != PARAM_JOURNAL_MAGIC || record.epoch != param_journal_epoch
+		    || record.length == 0 || record.length > PARAM_JOURNAL_MAX_SIZE
+		    || param_journal_size + sizeof(record) + record.length > PARAM_JOURNAL_MAX_SIZE) {
+			break;
+		}
+
+		uint8_t *data = (uint8_t *)malloc(record.length);
+
+		if (data == nullptr) {
+			break;
+		}
+
+		if (read(fd, data, record.length) != (ssize_t)record.length || record.crc != param_journal_crc(record, data)) {
+			PX4_WARN("discarding incomplete param journal record");
+			free(data);
+			break;
+		}
+
+		bson_decoder_s decoder;
+		param_import_state state;
+		state.mark_saved = true;
+
+		if (bson_decoder_init_buf(&decoder, data, record.length, param_import_callback, &state) == 0) {
+			while (bson_decoder_next(&decoder) > 0) {}
+		}
+
+		free(data);
+
+		offset += sizeof(record) + record.length;
+		param_journal_size += sizeof(record) + record.length;
+	}
+
+	param_journal_offset = offset;
+}
+
 int
 param_import(int fd)
 {
+	// a single parameter_update for the whole file
+	param_batch_begin();
+
+	int result;
+
 	if (fd < 0) {
-		return flash_param_import();
+		result = flash_param_import();
+
+	} else {
+		result = param_import_internal(fd, false);
 	}
 
-	return param_import_internal(fd, false);
+	param_batch_commit();
+	return result;
 }
 
 int
 param_load(int fd)
 {
+	param_batch_begin();
+
+	int result;
+
 	if (fd < 0) {
-		return flash_param_load();
+		result = flash_param_load();
+
+	} else {
+		param_reset_all_internal(false);
+		result = param_import_internal(fd, true);
 	}
 
-	param_reset_all_internal(false);
-	return param_import_internal(fd, true);
+	param_batch_commit();
+	return result;
 }
 
 void
@@ -1357,7 +2172,7 @@ param_foreach(void (*func)(void *arg, param_t param), void *arg, bool only_chang
 	for (param = 0; handle_in_range(param); param++) {
 
 		/* if requested, skip unchanged values */
-		if (only_changed && (param_find_changed(param) == nullptr)) {
+		if (only_changed && !param_is_changed(param)) {
 			continue;
 		}
 
@@ -1401,13 +2216,24 @@ void param_print_status()
 
 	if (filename != nullptr) {
 		PX4_INFO("file: %s", param_get_default_file());
+
+		if (param_journal_offset >= 0) {
+			PX4_INFO("journal: %zu/%d bytes (epoch %" PRIu32 ")", param_journal_size, PARAM_JOURNAL_MAX_SIZE,
+				 param_journal_epoch);
+		}
 	}
 
 #endif /* FLASH_BASED_PARAMS */
 
-	if (param_values != nullptr) {
-		PX4_INFO("storage array: %d/%d elements (%zu bytes total)",
-			 utarray_len(param_values), param_values->n, param_values->n * sizeof(UT_icd));
+	if (param_values_changed != nullptr) {
+		unsigned changed = 0;
+
+		for (param_t param = 0; handle_in_range(param); param++) {
+			changed += param_bit_get(param_values_changed, param);
+		}
+
+		PX4_INFO("storage array: %d/%d elements (%zu bytes total)", changed, param_count(),
+			 param_values_storage_size(param_count()));
 	}
 
 #ifndef PARAM_NO_AUTOSAVE
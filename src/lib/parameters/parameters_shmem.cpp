@@ -355,6 +355,17 @@ param_notify_changes()
 	_param_notify_changes();
 }
 
+void
+param_batch_begin()
+{
+	// notifications are not batched with shared memory parameters
+}
+
+void
+param_batch_commit()
+{
+}
+
 param_t
 param_find_internal(const char *name, bool notification)
 {
@@ -663,6 +674,17 @@ param_get(param_t param, void *val)
 	return result;
 }
 
+int
+param_get_if_changed(param_t param, void *val, uint16_t *generation)
+{
+	// the values can change through the shared memory without a generation: always copy
+	if (param_type(param) != PARAM_TYPE_INT32 && param_type(param) != PARAM_TYPE_FLOAT) {
+		return -1;
+	}
+
+	return param_get(param, val) == 0 ? 1 : -1;
+}
+
 #ifndef PARAM_NO_AUTOSAVE
 /**
  * worker callback method to save the parameters
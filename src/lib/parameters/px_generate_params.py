@@ -9,13 +9,78 @@ import argparse
 from jinja2 import Environment, FileSystemLoader
 import os
 
-def generate(xml_file, dest='.'):
+def param_hash(name, seed):
+    """
+    Seeded 32 bit FNV-1a hash with a final avalanche (murmur3 fmix32),
+    must match param_hash() in parameters.cpp.
+    Without the final mix, the low bits (hash % n for small n) do not depend on the seed.
+    """
+    h = 0x811c9dc5 ^ seed
+    for c in name.encode('ascii'):
+        h ^= c
+        h = (h * 0x01000193) & 0xffffffff
+    h ^= h >> 16
+    h = (h * 0x85ebca6b) & 0xffffffff
+    h ^= h >> 13
+    h = (h * 0xc2b2ae35) & 0xffffffff
+    h ^= h >> 16
+    return h
+
+def perfect_hash(names):
+    """
+    Create a minimal perfect hash (hash and displace) for the parameter names.
+    A name is first hashed (seed 0) into a bucket. The bucket entry is either the
+    negative parameter index - 1 (if it contains a single name), or a seed that
+    maps all names of the bucket to distinct slots (param_hash(name, seed) % n).
+    The slots contain the parameter index.
+
+    @return (buckets, slots) lists with n entries each
+    """
+    n = len(names)
+    if n == 0:
+        return [], []
+
+    buckets = [[] for _ in range(n)]
+    for index, name in enumerate(names):
+        buckets[param_hash(name, 0) % n].append(index)
+
+    bucket_table = [0] * n
+    slot_table = [None] * n
+    order = sorted(range(n), key=lambda b: len(buckets[b]), reverse=True)
+
+    for b in order:
+        bucket = buckets[b]
+        if len(bucket) <= 1:
+            break
+        seed = 1
+        while True:
+            slots = [param_hash(names[index], seed) % n for index in bucket]
+            if len(set(slots)) == len(slots) and all(slot_table[s] is None for s in slots):
+                break
+            seed += 1
+            if seed > 0x7fff:
+                raise Exception('failed to generate the parameter hash table')
+        bucket_table[b] = seed
+        for index, slot in zip(bucket, slots):
+            slot_table[slot] = index
+
+    for b in order:
+        if len(buckets[b]) == 1:
+            bucket_table[b] = -buckets[b][0] - 1
+
+    # unused slots
+    slot_table = [0 if index is None else index for index in slot_table]
+
+    return bucket_table, slot_table
+
+def generate(xml_file, dest='.', hash_table=True):
     """
     Generate px4 param source from xml.
 
     @param xml_file: input parameter xml file
     @param dest: Destination directory for generated files
         None means to scan everything.
+    @param hash_table: whether to generate the perfect hash table for param_find()
     """
     # pylint: disable=broad-except
     tree = ET.parse(xml_file)
@@ -38,6 +103,10 @@ def generate(xml_file, dest='.'):
     if not os.path.isdir(dest):
         os.path.mkdir(dest)
 
+    hash_buckets, hash_slots = [], []
+    if hash_table:
+        hash_buckets, hash_slots = perfect_hash([param.attrib["name"] for param in params])
+
     template_files = [
         'px4_parameters.h.jinja',
         'px4_parameters_public.h.jinja',
@@ -47,13 +116,16 @@ def generate(xml_file, dest='.'):
         template = env.get_template(template_file)
         with open(os.path.join(
                 dest, template_file.replace('.jinja','')), 'w') as fid:
-            fid.write(template.render(params=params))
+            fid.write(template.render(params=params, hash_buckets=hash_buckets,
+                                      hash_slots=hash_slots))
 
 if __name__ == "__main__":
     arg_parser = argparse.ArgumentParser()
     arg_parser.add_argument("--xml", help="parameter xml file")
     arg_parser.add_argument("--dest", help="destination path", default=os.path.curdir)
+    arg_parser.add_argument("--no-hash-table", action='store_true',
+                            help="do not generate the hash table (use binary search, saves flash)")
     args = arg_parser.parse_args()
-    generate(xml_file=args.xml, dest=args.dest)
+    generate(xml_file=args.xml, dest=args.dest, hash_table=not args.no_hash_table)
 
 #  vim: set et fenc=utf-8 ff=unix sts=4 sw=4 ts=4 :
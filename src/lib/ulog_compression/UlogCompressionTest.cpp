@@ -0,0 +1,184 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file UlogCompressionTest.cpp
+ * Tests for the ULog block compression.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ulog_compression.h"
+
+using namespace ulog_compression;
+
+static void roundtrip(const uint8_t *data, size_t size)
+{
+	uint8_t compressed[MAX_BLOCK_SIZE + MAX_BLOCK_SIZE / 255 + 16];
+	uint8_t decompressed[MAX_BLOCK_SIZE];
+	uint16_t hash_table[HASH_TABLE_SIZE];
+
+	const size_t compressed_size = compress_block(data, size, compressed, sizeof(compressed), hash_table);
+	ASSERT_GT(compressed_size, 0u);
+
+	const int decompressed_size = decompress_block(compressed, compressed_size, decompressed, sizeof(decompressed));
+	ASSERT_EQ(decompressed_size, (int)size);
+	EXPECT_EQ(memcmp(data, decompressed, size), 0);
+}
+
+TEST(UlogCompression, Empty)
+{
+	uint8_t data[1] {};
+	roundtrip(data, 0);
+}
+
+TEST(UlogCompression, Short)
+{
+	const uint8_t data[] = "ULog";
+	roundtrip(data, sizeof(data));
+}
+
+TEST(UlogCompression, Repetitive)
+{
+	static uint8_t data[16 * 1024];
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (uint8_t)(i % 37);
+	}
+
+	roundtrip(data, sizeof(data));
+
+	// repetitive data must actually get smaller
+	static uint8_t compressed[sizeof(data)];
+	uint16_t hash_table[HASH_TABLE_SIZE];
+	EXPECT_LT(compress_block(data, sizeof(data), compressed, sizeof(compressed), hash_table), sizeof(data) / 10);
+}
+
+TEST(UlogCompression, Random)
+{
+	static uint8_t data[MAX_BLOCK_SIZE];
+	srand(1);
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		// mix of random and repeated runs
+		data[i] = ((i / 64) % 2) ? (uint8_t)rand() : (uint8_t)(i / 64);
+	}
+
+	roundtrip(data, sizeof(data));
+}
+
+TEST(UlogCompression, Incompressible)
+{
+	static uint8_t data[4096];
+	srand(2);
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (uint8_t)rand();
+	}
+
+	// does not fit into a buffer of the input size
+	static uint8_t compressed[sizeof(data) - 1];
+	uint16_t hash_table[HASH_TABLE_SIZE];
+	EXPECT_EQ(compress_block(data, sizeof(data), compressed, sizeof(compressed), hash_table), 0u);
+}
+
+TEST(UlogCompression, InvalidData)
+{
+	uint8_t decompressed[64];
+
+	// match offset before the start of the output
+	const uint8_t invalid_offset[] = {0x10, 'a', 0x05, 0x00};
+	EXPECT_EQ(decompress_block(invalid_offset, sizeof(invalid_offset), decompressed, sizeof(decompressed)), -1);
+
+	// literal length larger than the input
+	const uint8_t truncated[] = {0xf0, 0x20, 'a'};
+	EXPECT_EQ(decompress_block(truncated, sizeof(truncated), decompressed, sizeof(decompressed)), -1);
+}
+
+TEST(UlogCompression, File)
+{
+	Compressor compressor;
+	ASSERT_TRUE(compressor.init(1024));
+
+	char src_file_name[] = "/tmp/ulog_compression_test_XXXXXX";
+	const int fd = mkstemp(src_file_name);
+	ASSERT_GE(fd, 0);
+	FILE *fp = fdopen(fd, "wb");
+
+	const file_header_s header = compressor.file_header();
+	fwrite(&header, sizeof(header), 1, fp);
+
+	static uint8_t data[10000];
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (uint8_t)((i * 7) % 251);
+	}
+
+	size_t written = 0;
+
+	while (written < sizeof(data)) {
+		written += compressor.append(data + written, sizeof(data) - written);
+
+		if (compressor.full() || written == sizeof(data)) {
+			size_t size;
+			const uint8_t *block = compressor.encode_block(size);
+			fwrite(block, size, 1, fp);
+		}
+	}
+
+	// incomplete block at the end (e.g. power loss while writing)
+	const block_header_s incomplete{BLOCK_SYNC, 100, 200, 0};
+	fwrite(&incomplete, sizeof(incomplete), 1, fp);
+	fclose(fp);
+
+	EXPECT_TRUE(is_compressed_file(src_file_name));
+
+	char dst_file_name[64];
+	snprintf(dst_file_name, sizeof(dst_file_name), "%s.ulg", src_file_name);
+	ASSERT_TRUE(decompress_file(src_file_name, dst_file_name));
+	EXPECT_FALSE(is_compressed_file(dst_file_name));
+
+	static uint8_t decompressed[sizeof(data) + 1];
+	fp = fopen(dst_file_name, "rb");
+	ASSERT_NE(fp, nullptr);
+	EXPECT_EQ(fread(decompressed, 1, sizeof(decompressed), fp), sizeof(data));
+	fclose(fp);
+	EXPECT_EQ(memcmp(data, decompressed, sizeof(data)), 0);
+
+	remove(src_file_name);
+	remove(dst_file_name);
+}
@@ -0,0 +1,430 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ulog_compression.cpp
+ */
+
+#include "ulog_compression.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace ulog_compression
+{
+
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5; ///< the last 5 bytes of a block are always literals
+static constexpr size_t MF_LIMIT = 12; ///< the last match must start at least 12 bytes before the end
+static constexpr int HASH_LOG = 12;
+
+static_assert(HASH_TABLE_SIZE == (1 << HASH_LOG), "invalid hash table size");
+
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+static inline uint8_t *write_length(uint8_t *op, size_t length)
+{
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+uint32_t checksum(const uint8_t *data, size_t size)
+{
+	uint32_t h = 2166136261u;
+
+	for (size_t i = 0; i < size; i++) {
+		h = (h ^ data[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+size_t compress_block(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity, uint16_t *hash_table)
+{
+	if (src_size > MAX_BLOCK_SIZE) {
+		return 0;
+	}
+
+	uint8_t *op = dst;
+	uint8_t *const op_end = dst + dst_capacity;
+	size_t anchor = 0;
+
+	if (src_size > MF_LIMIT) {
+		memset(hash_table, 0, HASH_TABLE_SIZE * sizeof(hash_table[0]));
+
+		const size_t match_limit = src_size - LAST_LITERALS;
+		size_t ip = 1;
+
+		while (ip < src_size - MF_LIMIT) {
+			const uint32_t sequence = read32(src + ip);
+			const uint32_t h = hash(sequence);
+			const size_t ref = hash_table[h];
+			hash_table[h] = (uint16_t)ip;
+
+			if ((ref >= ip) || (read32(src + ref) != sequence)) {
+				// skip faster through incompressible data
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			size_t match_length = MIN_MATCH;
+
+			while ((ip + match_length < match_limit) && (src[ref + match_length] == src[ip + match_length])) {
+				match_length++;
+			}
+
+			const size_t literals = ip - anchor;
+
+			// token + literal length + literals + offset + match length
+			if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals + 2 + (match_length - MIN_MATCH) / 255 + 1) {
+				return 0;
+			}
+
+			uint8_t *token = op++;
+
+			if (literals >= 15) {
+				*token = 15 << 4;
+				op = write_length(op, literals - 15);
+
+			} else {
+				*token = (uint8_t)(literals << 4);
+			}
+
+			memcpy(op, src + anchor, literals);
+			op += literals;
+
+			const size_t offset = ip - ref;
+			*op++ = (uint8_t)offset;
+			*op++ = (uint8_t)(offset >> 8);
+
+			if (match_length - MIN_MATCH >= 15) {
+				*token |= 15;
+				op = write_length(op, match_length - MIN_MATCH - 15);
+
+			} else {
+				*token |= (uint8_t)(match_length - MIN_MATCH);
+			}
+
+			ip += match_length;
+			anchor = ip;
+
+			if (ip < src_size - MF_LIMIT) {
+				hash_table[hash(read32(src + ip - 2))] = (uint16_t)(ip - 2);
+			}
+		}
+	}
+
+	// last literals
+	const size_t literals = src_size - anchor;
+
+	if ((size_t)(op_end - op) < 1 + literals / 255 + 1 + literals) {
+		return 0;
+	}
+
+	uint8_t *token = op++;
+
+	if (literals >= 15) {
+		*token = 15 << 4;
+		op = write_length(op, literals - 15);
+
+	} else {
+		*token = (uint8_t)(literals << 4);
+	}
+
+	memcpy(op, src + anchor, literals);
+	op += literals;
+
+	return op - dst;
+}
+
+int decompress_block(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const ip_end = src + src_size;
+	uint8_t *op = dst;
+	uint8_t *const op_end = dst + dst_capacity;
+
+	while (ip < ip_end) {
+		const uint8_t token = *ip++;
+
+		// literals
+		size_t length = token >> 4;
+
+		if (length == 15) {
+			uint8_t b;
+
+			do {
+				if (ip >= ip_end) {
+					return -1;
+				}
+
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+
+		if (((size_t)(ip_end - ip) < length) || ((size_t)(op_end - op) < length)) {
+			return -1;
+		}
+
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+
+		if (ip == ip_end) {
+			// the last sequence has no match
+			break;
+		}
+
+		// match
+		if (ip_end - ip < 2) {
+			return -1;
+		}
+
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if ((offset == 0) || (offset > (size_t)(op - dst))) {
+			return -1;
+		}
+
+		length = token & 15;
+
+		if (length == 15) {
+			uint8_t b;
+
+			do {
+				if (ip >= ip_end) {
+					return -1;
+				}
+
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+
+		length += MIN_MATCH;
+
+		if ((size_t)(op_end - op) < length) {
+			return -1;
+		}
+
+		// the match can overlap with the output
+		const uint8_t *match = op - offset;
+
+		for (size_t i = 0; i < length; i++) {
+			op[i] = match[i];
+		}
+
+		op += length;
+	}
+
+	return op - dst;
+}
+
+Compressor::~Compressor()
+{
+	delete[] _block;
+	delete[] _encoded;
+	delete[] _hash_table;
+}
+
+bool Compressor::init(size_t block_size)
+{
+	if (block_size > MAX_BLOCK_SIZE) {
+		block_size = MAX_BLOCK_SIZE;
+	}
+
+	if ((_block != nullptr) && (block_size == _block_size)) {
+		reset();
+		return true;
+	}
+
+	delete[] _block;
+	delete[] _encoded;
+
+	_block = new uint8_t[block_size];
+	_encoded = new uint8_t[sizeof(block_header_s) + block_size];
+
+	if (_hash_table == nullptr) {
+		_hash_table = new uint16_t[HASH_TABLE_SIZE];
+	}
+
+	if ((_block == nullptr) || (_encoded == nullptr) || (_hash_table == nullptr)) {
+		return false;
+	}
+
+	_block_size = block_size;
+	_fill = 0;
+	return true;
+}
+
+file_header_s Compressor::file_header() const
+{
+	file_header_s header;
+	memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+	header.version = FILE_VERSION;
+	header.codec = CODEC_LZ4;
+	header.block_size = _block_size;
+	return header;
+}
+
+size_t Compressor::append(const uint8_t *data, size_t size)
+{
+	if (size > _block_size - _fill) {
+		size = _block_size - _fill;
+	}
+
+	memcpy(_block + _fill, data, size);
+	_fill += size;
+	return size;
+}
+
+const uint8_t *Compressor::encode_block(size_t &size)
+{
+	uint8_t *payload = _encoded + sizeof(block_header_s);
+
+	// store uncompressed if compression does not make it smaller
+	size_t compressed_size = (_fill > 1) ? compress_block(_block, _fill, payload, _fill - 1, _hash_table) : 0;
+
+	if (compressed_size == 0) {
+		memcpy(payload, _block, _fill);
+		compressed_size = _fill;
+	}
+
+	block_header_s header;
+	header.sync = BLOCK_SYNC;
+	header.compressed_size = compressed_size;
+	header.uncompressed_size = _fill;
+	header.checksum = checksum(payload, compressed_size);
+	memcpy(_encoded, &header, sizeof(header));
+
+	_fill = 0;
+	size = sizeof(block_header_s) + compressed_size;
+	return _encoded;
+}
+
+bool is_compressed_file(const char *file_name)
+{
+	FILE *fp = fopen(file_name, "rb");
+
+	if (fp == nullptr) {
+		return false;
+	}
+
+	file_header_s header;
+	const bool compressed = (fread(&header, sizeof(header), 1, fp) == 1)
+				&& (memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) == 0);
+	fclose(fp);
+	return compressed;
+}
+
+bool decompress_file(const char *src_file_name, const char *dst_file_name)
+{
+	FILE *src = fopen(src_file_name, "rb");
+
+	if (src == nullptr) {
+		return false;
+	}
+
+	file_header_s header;
+
+	if ((fread(&header, sizeof(header), 1, src) != 1) || (memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0)
+	    || (header.version != FILE_VERSION) || (header.codec != CODEC_LZ4) || (header.block_size > MAX_BLOCK_SIZE)) {
+		fclose(src);
+		return false;
+	}
+
+	FILE *dst = fopen(dst_file_name, "wb");
+
+	if (dst == nullptr) {
+		fclose(src);
+		return false;
+	}
+
+	uint8_t *payload = new uint8_t[header.block_size];
+	uint8_t *block = new uint8_t[header.block_size];
+	bool ret = (payload != nullptr) && (block != nullptr);
+
+	block_header_s block_header;
+
+	while (ret && (fread(&block_header, sizeof(block_header), 1, src) == 1)) {
+		if ((block_header.sync != BLOCK_SYNC) || (block_header.compressed_size > header.block_size)
+		    || (block_header.uncompressed_size > header.block_size)
+		    || (fread(payload, block_header.compressed_size, 1, src) != 1)
+		    || (checksum(payload, block_header.compressed_size) != block_header.checksum)) {
+			// incomplete or corrupt block (the logger was interrupted)
+			break;
+		}
+
+		const uint8_t *data = payload;
+
+		if (block_header.compressed_size != block_header.uncompressed_size) {
+			if (decompress_block(payload, block_header.compressed_size, block, header.block_size)
+			    != (int)block_header.uncompressed_size) {
+				break;
+			}
+
+			data = block;
+		}
+
+		ret = (fwrite(data, block_header.uncompressed_size, 1, dst) == 1);
+	}
+
+	delete[] payload;
+	delete[] block;
+	fclose(src);
+
+	if (fclose(dst) != 0) {
+		ret = false;
+	}
+
+	return ret;
+}
+
+} // namespace ulog_compression
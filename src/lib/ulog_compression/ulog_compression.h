@@ -0,0 +1,156 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ulog_compression.h
+ *
+ * Block compression for ULog files.
+ *
+ * A compressed ULog file (.ulgz) starts with a file_header_s, followed by blocks (block_header_s + payload).
+ * The concatenation of the uncompressed blocks is the plain ULog file. Blocks are compressed independently
+ * (LZ4 block format), so a reader can start at any block, and a file that was cut off (e.g. due to a crash)
+ * can be read up to the last complete block.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ulog_compression
+{
+
+static constexpr uint8_t FILE_MAGIC[6] = {'U', 'L', 'o', 'g', 'Z', 0};
+static constexpr uint8_t FILE_VERSION = 1;
+static constexpr uint8_t CODEC_LZ4 = 1;
+
+static constexpr uint32_t BLOCK_SYNC = 0x4b4c425a; ///< "ZBLK", used to find the next block after corrupt data
+
+static constexpr size_t MAX_BLOCK_SIZE = 60 * 1024; ///< match offsets and the hash table are 16 bit
+
+#pragma pack(push, 1)
+struct file_header_s {
+	uint8_t magic[6];
+	uint8_t version;
+	uint8_t codec;
+	uint32_t block_size; ///< maximum uncompressed block size
+};
+
+struct block_header_s {
+	uint32_t sync;
+	uint32_t compressed_size; ///< payload size. If equal to uncompressed_size, the payload is stored uncompressed
+	uint32_t uncompressed_size;
+	uint32_t checksum; ///< checksum() of the payload
+};
+#pragma pack(pop)
+
+/**
+ * FNV-1a hash, used as block checksum
+ */
+uint32_t checksum(const uint8_t *data, size_t size);
+
+static constexpr int HASH_TABLE_SIZE = 1 << 12;
+
+/**
+ * Compress a block (LZ4 block format).
+ * @param hash_table scratch memory with HASH_TABLE_SIZE entries
+ * @return compressed size, 0 if the compressed data does not fit into dst_capacity
+ */
+size_t compress_block(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity, uint16_t *hash_table);
+
+/**
+ * Decompress a block (LZ4 block format).
+ * @return decompressed size, -1 on invalid data or if the data does not fit into dst_capacity
+ */
+int decompress_block(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_capacity);
+
+/**
+ * Collects the ULog byte stream and encodes it into blocks.
+ */
+class Compressor
+{
+public:
+	Compressor() = default;
+	~Compressor();
+
+	Compressor(const Compressor &) = delete;
+	Compressor &operator=(const Compressor &) = delete;
+
+	/**
+	 * Allocate the buffers
+	 * @param block_size maximum uncompressed block size (limited to MAX_BLOCK_SIZE)
+	 * @return true on success
+	 */
+	bool init(size_t block_size);
+
+	/** discard buffered data */
+	void reset() { _fill = 0; }
+
+	file_header_s file_header() const;
+
+	/**
+	 * Buffer data for the current block.
+	 * @return number of bytes consumed (less than size if the block is full)
+	 */
+	size_t append(const uint8_t *data, size_t size);
+
+	bool full() const { return _fill == _block_size; }
+	bool empty() const { return _fill == 0; }
+
+	/**
+	 * Encode the buffered data into a block (header and payload) and start a new block.
+	 * @param size set to the encoded size
+	 * @return pointer to the encoded block, valid until the next call
+	 */
+	const uint8_t *encode_block(size_t &size);
+
+private:
+	size_t _block_size{0};
+	size_t _fill{0};
+	uint8_t *_block{nullptr};
+	uint8_t *_encoded{nullptr};
+	uint16_t *_hash_table{nullptr};
+};
+
+/**
+ * Check if a file is a compressed ULog file.
+ */
+bool is_compressed_file(const char *file_name);
+
+/**
+ * Decompress a compressed ULog file. Stops at the first incomplete or corrupt block.
+ * @return true if the output file was written
+ */
+bool decompress_file(const char *src_file_name, const char *dst_file_name);
+
+} // namespace ulog_compression
@@ -0,0 +1,321 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#if defined(__PX4_LINUX)
+
+#include "async_file_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <mathlib/mathlib.h>
+#include <px4_platform_common/log.h>
+#include <px4_platform_common/posix.h>
+
+namespace px4
+{
+namespace logger
+{
+
+constexpr size_t AsyncFileWriter::CHUNK_SIZE;
+constexpr size_t AsyncFileWriter::ALIGNMENT;
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+	close();
+
+	for (Chunk &chunk : _chunks) {
+		free(chunk.data);
+	}
+}
+
+int AsyncFileWriter::open(const char *filename, perf_counter_t perf_write, perf_counter_t perf_fsync,
+			  perf_counter_t *latency_histogram)
+{
+	if (_fd >= 0) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	for (Chunk &chunk : _chunks) {
+		if (chunk.data == nullptr) {
+			void *data = nullptr;
+
+			if (posix_memalign(&data, ALIGNMENT, CHUNK_SIZE) != 0) {
+				errno = ENOMEM;
+				return -1;
+			}
+
+			chunk.data = static_cast<uint8_t *>(data);
+		}
+
+		chunk.fill = 0;
+		chunk.offset = 0;
+		chunk.in_flight = false;
+	}
+
+	_fd = ::open(filename, O_CREAT | O_WRONLY | O_DIRECT, PX4_O_MODE_666);
+	_direct_io = true;
+
+	if (_fd < 0 && errno == EINVAL) {
+		// file system does not support O_DIRECT (e.g. tmpfs)
+		_fd = ::open(filename, O_CREAT | O_WRONLY, PX4_O_MODE_666);
+		_direct_io = false;
+	}
+
+	_current = 0;
+	_error = false;
+	_file_size = 0;
+	_fsync_in_flight = false;
+	_perf_write = perf_write;
+	_perf_fsync = perf_fsync;
+	_latency_histogram = latency_histogram;
+
+	return _fd;
+}
+
+bool AsyncFileWriter::write(const void *data, size_t size)
+{
+	if (_fd < 0 || _error) {
+		return false;
+	}
+
+	// collect completed requests (to report errors and latencies early)
+	reap(_chunks[0], false);
+	reap(_chunks[1], false);
+	reap_fsync(false);
+
+	const uint8_t *src = static_cast<const uint8_t *>(data);
+
+	while (size > 0) {
+		Chunk &chunk = _chunks[_current];
+		const size_t n = math::min(size, CHUNK_SIZE - chunk.fill);
+		memcpy(chunk.data + chunk.fill, src, n);
+		chunk.fill += n;
+		_file_size += n;
+		src += n;
+		size -= n;
+
+		if (chunk.fill == CHUNK_SIZE && !submit()) {
+			return false;
+		}
+	}
+
+	return !_error;
+}
+
+bool AsyncFileWriter::sync()
+{
+	if (_fd < 0 || _error) {
+		return false;
+	}
+
+	if (!submit()) {
+		return false;
+	}
+
+	// skip if the previous fsync is still running: it will cover most of the data anyway
+	if (reap_fsync(false)) {
+		_fsync_cb = {};
+		_fsync_cb.aio_fildes = _fd;
+		_fsync_cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+		if (aio_fsync(O_SYNC, &_fsync_cb) != 0) {
+			_error = true;
+			return false;
+		}
+
+		_fsync_in_flight = true;
+		_fsync_submit_time = hrt_absolute_time();
+	}
+
+	return !_error;
+}
+
+int AsyncFileWriter::close()
+{
+	if (_fd < 0) {
+		return 0;
+	}
+
+	bool ok = !_error && submit();
+
+	reap(_chunks[0], true);
+	reap(_chunks[1], true);
+	reap_fsync(true);
+
+	// remove the padding of the last block
+	if (ok && !_error && ftruncate(_fd, _file_size) != 0) {
+		ok = false;
+	}
+
+	if (::close(_fd) != 0) {
+		ok = false;
+	}
+
+	_fd = -1;
+
+	return (ok && !_error) ? 0 : -1;
+}
+
+bool AsyncFileWriter::submit()
+{
+	Chunk &chunk = _chunks[_current];
+	Chunk &next = _chunks[_current ^ 1];
+
+	if (chunk.fill == 0) {
+		return true;
+	}
+
+	// Wait for the previous request: we need its buffer, and it might overlap with this one
+	// (rewritten partial block), so it must complete first.
+	reap(next, true);
+
+	if (_error) {
+		return false;
+	}
+
+	const size_t aligned_fill = chunk.fill & ~(ALIGNMENT - 1);
+	const size_t write_size = (chunk.fill + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	memset(chunk.data + chunk.fill, 0, write_size - chunk.fill);
+
+	chunk.cb = {};
+	chunk.cb.aio_fildes = _fd;
+	chunk.cb.aio_buf = chunk.data;
+	chunk.cb.aio_nbytes = write_size;
+	chunk.cb.aio_offset = chunk.offset;
+	chunk.cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+	if (aio_write(&chunk.cb) != 0) {
+		_error = true;
+		return false;
+	}
+
+	chunk.in_flight = true;
+	chunk.submit_time = hrt_absolute_time();
+
+	// continue with the next chunk, starting with the partial block (if any)
+	next.offset = chunk.offset + aligned_fill;
+	next.fill = chunk.fill - aligned_fill;
+	memcpy(next.data, chunk.data + aligned_fill, next.fill);
+	_current ^= 1;
+
+	return true;
+}
+
+bool AsyncFileWriter::reap(Chunk &chunk, bool wait)
+{
+	if (!chunk.in_flight) {
+		return true;
+	}
+
+	int err = aio_error(&chunk.cb);
+
+	if (wait) {
+		const aiocb *list[1] = { &chunk.cb };
+
+		while (err == EINPROGRESS) {
+			aio_suspend(list, 1, nullptr);
+			err = aio_error(&chunk.cb);
+		}
+	}
+
+	if (err == EINPROGRESS) {
+		return false;
+	}
+
+	const ssize_t ret = aio_return(&chunk.cb);
+	chunk.in_flight = false;
+
+	const hrt_abstime latency = hrt_elapsed_time(&chunk.submit_time);
+	perf_set_elapsed(_perf_write, latency);
+
+	if (_latency_histogram) {
+		int bucket = 0;
+
+		for (hrt_abstime limit = 1000; bucket < NUM_LATENCY_BUCKETS - 1 && latency >= limit; limit *= 10) {
+			++bucket;
+		}
+
+		perf_count(_latency_histogram[bucket]);
+	}
+
+	if (err != 0 || ret != static_cast<ssize_t>(chunk.cb.aio_nbytes)) {
+		PX4_ERR("async write failed (%i, %zi)", err, ret);
+		errno = err != 0 ? err : ENOSPC;
+		_error = true;
+	}
+
+	return true;
+}
+
+bool AsyncFileWriter::reap_fsync(bool wait)
+{
+	if (!_fsync_in_flight) {
+		return true;
+	}
+
+	int err = aio_error(&_fsync_cb);
+
+	if (wait) {
+		const aiocb *list[1] = { &_fsync_cb };
+
+		while (err == EINPROGRESS) {
+			aio_suspend(list, 1, nullptr);
+			err = aio_error(&_fsync_cb);
+		}
+	}
+
+	if (err == EINPROGRESS) {
+		return false;
+	}
+
+	aio_return(&_fsync_cb);
+	_fsync_in_flight = false;
+	perf_set_elapsed(_perf_fsync, hrt_elapsed_time(&_fsync_submit_time));
+
+	if (err != 0) {
+		// not fatal: the data might still be written
+		PX4_WARN("fsync failed (%i)", err);
+	}
+
+	return true;
+}
+
+} // namespace logger
+} // namespace px4
+
+#endif /* __PX4_LINUX */
@@ -0,0 +1,142 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#if defined(__PX4_LINUX)
+
+#include <aio.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <drivers/drv_hrt.h>
+#include <perf/perf_counter.h>
+
+namespace px4
+{
+namespace logger
+{
+
+/**
+ * @class AsyncFileWriter
+ * Linux file writer backend that never blocks the caller on storage (as long as the storage
+ * keeps up on average): data is collected in two aligned chunks, which are alternately
+ * submitted with POSIX AIO (the file is opened with O_DIRECT if the file system supports it).
+ * fsync is asynchronous as well.
+ *
+ * The completion latency of each write and fsync is reported via the perf counters passed to
+ * open(), and optionally a histogram of the write latencies via a set of PC_COUNT counters.
+ */
+class AsyncFileWriter
+{
+public:
+	AsyncFileWriter() = default;
+	~AsyncFileWriter();
+
+	static constexpr int NUM_LATENCY_BUCKETS = 4; ///< <1ms, <10ms, <100ms, >=100ms
+
+	/**
+	 * Open (create) a file for writing
+	 * @param latency_histogram nullptr or array of NUM_LATENCY_BUCKETS PC_COUNT counters
+	 * @return file descriptor, <0 on error (errno is set)
+	 */
+	int open(const char *filename, perf_counter_t perf_write, perf_counter_t perf_fsync,
+		 perf_counter_t *latency_histogram);
+
+	/**
+	 * Append data to the file. Only blocks if both chunks are still in flight.
+	 * @return false on error (including errors of previously submitted writes)
+	 */
+	bool write(const void *data, size_t size);
+
+	/**
+	 * Submit the buffered data (including a partial chunk) and an fsync, without waiting.
+	 */
+	bool sync();
+
+	/**
+	 * Write all pending data, wait for completion and close the file
+	 * @return 0 on success, -1 otherwise
+	 */
+	int close();
+
+	bool is_open() const { return _fd >= 0; }
+
+	bool direct_io() const { return _direct_io; }
+
+	static constexpr size_t CHUNK_SIZE = 64 * 1024;
+	static constexpr size_t ALIGNMENT = 4096; ///< O_DIRECT offset & size alignment (max logical block size)
+
+private:
+	struct Chunk {
+		aiocb cb{};
+		uint8_t *data{nullptr};
+		size_t fill{0}; ///< number of valid bytes in data
+		off_t offset{0}; ///< file offset of data[0]
+		bool in_flight{false};
+		hrt_abstime submit_time{0};
+	};
+
+	/**
+	 * Check for (and optionally wait for) the completion of a request
+	 * @return true if the request is completed
+	 */
+	bool reap(Chunk &chunk, bool wait);
+
+	bool reap_fsync(bool wait);
+
+	/**
+	 * submit the current chunk and switch to the next one. A trailing partial
+	 * alignment block is copied to the next chunk and rewritten with the next submission.
+	 */
+	bool submit();
+
+	Chunk _chunks[2];
+	int _current{0};
+	int _fd{-1};
+	bool _direct_io{false};
+	bool _error{false};
+	off_t _file_size{0}; ///< real (unpadded) file size
+
+	aiocb _fsync_cb{};
+	bool _fsync_in_flight{false};
+	hrt_abstime _fsync_submit_time{0};
+
+	perf_counter_t _perf_write{nullptr};
+	perf_counter_t _perf_fsync{nullptr};
+	perf_counter_t *_latency_histogram{nullptr};
+};
+
+} // namespace logger
+} // namespace px4
+
+#endif /* __PX4_LINUX */
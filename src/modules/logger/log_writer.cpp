@@ -103,7 +103,7 @@ bool LogWriter::is_started(LogType type) const
 		ret = _log_writer_file->is_started(type);
 	}
 
-	if (_log_writer_mavlink && type == LogType::Full) {
+	if (_log_writer_mavlink && type == _mavlink_log_type) {
 		ret = ret || _log_writer_mavlink->is_started();
 	}
 
@@ -116,17 +116,17 @@ bool LogWriter::is_started(LogType type, Backend query_backend) const
 		return _log_writer_file->is_started(type);
 	}
 
-	if (query_backend == BackendMavlink && _log_writer_mavlink && type == LogType::Full) {
+	if (query_backend == BackendMavlink && _log_writer_mavlink && type == _mavlink_log_type) {
 		return _log_writer_mavlink->is_started();
 	}
 
 	return false;
 }
 
-void LogWriter::start_log_file(LogType type, const char *filename)
+void LogWriter::start_log_file(LogType type, const char *filename, size_t compression_block_size)
 {
 	if (_log_writer_file) {
-		_log_writer_file->start_log(type, filename);
+		_log_writer_file->start_log(type, filename, compression_block_size);
 	}
 }
 
@@ -166,7 +166,7 @@ int LogWriter::write_message(LogType type, void *ptr, size_t size, uint64_t drop
 		ret_file = _log_writer_file_for_write->write_message(type, ptr, size, dropout_start);
 	}
 
-	if (_log_writer_mavlink_for_write && type == LogType::Full) {
+	if (_log_writer_mavlink_for_write && type == _mavlink_log_type) {
 		ret_mavlink = _log_writer_mavlink_for_write->write_message(ptr, size);
 	}
 
@@ -178,6 +178,31 @@ int LogWriter::write_message(LogType type, void *ptr, size_t size, uint64_t drop
 	return ret_mavlink;
 }
 
+void *LogWriter::reserve_message(LogType type, size_t size, uint64_t dropout_start)
+{
+	if (_log_writer_file_for_write) {
+		return _log_writer_file_for_write->reserve_message(type, size, dropout_start);
+	}
+
+	return nullptr;
+}
+
+int LogWriter::commit_message(LogType type, void *ptr, size_t size)
+{
+	int ret_mavlink = 0;
+
+	// the message in the file buffer is valid until the writer thread consumed it
+	if (_log_writer_mavlink_for_write && type == _mavlink_log_type) {
+		ret_mavlink = _log_writer_mavlink_for_write->write_message(ptr, size);
+	}
+
+	if (_log_writer_file_for_write) {
+		_log_writer_file_for_write->commit_message(type, size);
+	}
+
+	return ret_mavlink;
+}
+
 void LogWriter::select_write_backend(Backend sel_backend)
 {
 	if (sel_backend & BackendFile) {
@@ -62,10 +62,27 @@ public:
 
 	Backend backend() const { return _backend; }
 
+	/**
+	 * Select which log type is streamed via the mavlink backend (default: full log).
+	 * Must not be changed while mavlink logging is running.
+	 */
+	void set_mavlink_log_type(LogType type) { _mavlink_log_type = type; }
+
+	/** @see LogWriterMavlink::set_ack_window() */
+	void set_mavlink_ack_window(int window)
+	{
+		if (_log_writer_mavlink) { _log_writer_mavlink->set_ack_window(window); }
+	}
+
+	LogType mavlink_log_type() const { return _mavlink_log_type; }
+
 	/** stop all running threads and wait for them to exit */
 	void thread_stop();
 
-	void start_log_file(LogType type, const char *filename);
+	/**
+	 * @param compression_block_size >0: write a compressed file with this block size (see ulog_compression.h)
+	 */
+	void start_log_file(LogType type, const char *filename, size_t compression_block_size = 0);
 
 	void stop_log_file(LogType type);
 
@@ -88,10 +105,27 @@ public:
 	 * @param dropout_start timestamp when lastest dropout occured. 0 if no dropout at the moment.
 	 * @return 0 on success (or if no logging started),
 	 *         -1 if not enough space in the buffer left (file backend), -2 mavlink backend failed
-	 *  add type -> pass through, but not to mavlink if mission log
+	 *  add type -> pass through, but to mavlink only for mavlink_log_type()
 	 */
 	int write_message(LogType type, void *ptr, size_t size, uint64_t dropout_start = 0);
 
+	/**
+	 * Reserve space for a single ulog message in the file buffer, so that it can be constructed
+	 * in place (avoids copying it), and must then be finished with commit_message().
+	 * The caller must call lock() before calling this, but can release it until commit_message(),
+	 * and no other message must be written to the same log type in between.
+	 * @return pointer to size bytes, or nullptr if not possible (file backend not running,
+	 *         dropout, not enough contiguous space), in which case write_message() has to be used.
+	 */
+	void *reserve_message(LogType type, size_t size, uint64_t dropout_start = 0);
+
+	/**
+	 * Finish a message started with reserve_message(). The caller must call lock() before calling this.
+	 * @param ptr pointer returned by reserve_message()
+	 * @return 0 on success, -2 mavlink backend failed
+	 */
+	int commit_message(LogType type, void *ptr, size_t size);
+
 	/**
 	 * Select a backend, so that future calls to write_message() only write to the selected
 	 * sel_backend, until unselect_write_backend() is called.
@@ -176,6 +210,7 @@ private:
 	LogWriterMavlink *_log_writer_mavlink_for_write = nullptr;
 
 	const Backend _backend;
+	LogType _mavlink_log_type{LogType::Full};
 };
 
 
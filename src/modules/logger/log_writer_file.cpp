@@ -63,11 +63,29 @@ LogWriterFile::LogWriterFile(size_t buffer_size)
 
 	{
 		300, // buffer size for the mission log (can be kept fairly small)
-		perf_alloc(PC_ELAPSED, "logger_sd_write_mission"), perf_alloc(PC_ELAPSED, "logger_sd_fsync_mission")}
+		perf_alloc(PC_ELAPSED, "logger_sd_write_mission"), perf_alloc(PC_ELAPSED, "logger_sd_fsync_mission")},
+
+	{
+		// the secondary log is typically a decimated subset of the full log
+		math::max(buffer_size / 4, _min_write_chunk + 300),
+		perf_alloc(PC_ELAPSED, "logger_sd_write_secondary"), perf_alloc(PC_ELAPSED, "logger_sd_fsync_secondary")}
 }
 {
 	pthread_mutex_init(&_mtx, nullptr);
 	pthread_cond_init(&_cv, nullptr);
+
+#if defined(__PX4_LINUX)
+	// histogram of the write completion latencies (shared by all log types)
+	_perf_write_latency[0] = perf_alloc(PC_COUNT, "logger_sd_write_lt1ms");
+	_perf_write_latency[1] = perf_alloc(PC_COUNT, "logger_sd_write_lt10ms");
+	_perf_write_latency[2] = perf_alloc(PC_COUNT, "logger_sd_write_lt100ms");
+	_perf_write_latency[3] = perf_alloc(PC_COUNT, "logger_sd_write_ge100ms");
+
+	for (LogFileBuffer &buffer : _buffers) {
+		buffer.set_latency_histogram(_perf_write_latency);
+	}
+
+#endif /* __PX4_LINUX */
 }
 
 bool LogWriterFile::init()
@@ -79,9 +97,22 @@ LogWriterFile::~LogWriterFile()
 {
 	pthread_mutex_destroy(&_mtx);
 	pthread_cond_destroy(&_cv);
+
+#if defined(__PX4_LINUX)
+
+	for (LogFileBuffer &buffer : _buffers) {
+		buffer.close_file();
+		buffer.set_latency_histogram(nullptr);
+	}
+
+	for (perf_counter_t &perf : _perf_write_latency) {
+		perf_free(perf);
+	}
+
+#endif /* __PX4_LINUX */
 }
 
-void LogWriterFile::start_log(LogType type, const char *filename)
+void LogWriterFile::start_log(LogType type, const char *filename, size_t compression_block_size)
 {
 	// At this point we don't expect the file to be open, but it can happen for very fast consecutive stop & start
 	// calls. In that case we wait for the thread to close the file first.
@@ -95,7 +126,8 @@ void LogWriterFile::start_log(LogType type, const char *filename)
 
 	unlock();
 
-	if (type == LogType::Full) {
+	// the hardfault handler appends plain ULog data, which does not work for compressed files
+	if (type == LogType::Full && compression_block_size == 0) {
 		// register the current file with the hardfault handler: if the system crashes,
 		// the hardfault handler will append the crash log to that file on the next reboot.
 		// Note that we don't deregister it when closing the log, so that crashes after disarming
@@ -107,8 +139,9 @@ void LogWriterFile::start_log(LogType type, const char *filename)
 		}
 	}
 
-	if (_buffers[(int)type].start_log(filename)) {
-		PX4_INFO("Opened %s log file: %s", log_type_str(type), filename);
+	if (_buffers[(int)type].start_log(filename, compression_block_size)) {
+		PX4_INFO("Opened %s log file: %s%s", log_type_str(type), filename,
+			 _buffers[(int)type].compressed() ? " (compressed)" : "");
 		notify();
 	}
 }
@@ -173,7 +206,9 @@ void LogWriterFile::thread_stop()
 {
 	// this will terminate the main loop of the writer thread
 	_exit_thread = true;
-	_buffers[0]._should_run = _buffers[1]._should_run = false;
+	for (LogFileBuffer &buffer : _buffers) {
+		buffer._should_run = false;
+	}
 
 	notify();
 
@@ -203,7 +238,9 @@ void LogWriterFile::run()
 			bool start = false;
 			pthread_mutex_lock(&_mtx);
 			pthread_cond_wait(&_cv, &_mtx);
-			start = _buffers[0]._should_run || _buffers[1]._should_run;
+			for (const LogFileBuffer &buffer : _buffers) {
+				start = start || buffer._should_run;
+			}
 			pthread_mutex_unlock(&_mtx);
 
 			if (start) {
@@ -235,7 +272,8 @@ void LogWriterFile::run()
 
 			constexpr size_t min_available[(int)LogType::Count] = {
 				_min_write_chunk,
-				1 // For the mission log, write as soon as there is data available
+				1, // For the mission log, write as soon as there is data available
+				_min_write_chunk
 			};
 
 			/* Check all buffers for available data. Mission log is first to avoid drops */
@@ -287,8 +325,14 @@ void LogWriterFile::run()
 			}
 
 
-			if (_buffers[0].fd() < 0 && _buffers[1].fd() < 0) {
-				// stop when both files are closed
+			bool all_closed = true;
+
+			for (const LogFileBuffer &buffer : _buffers) {
+				all_closed = all_closed && buffer.fd() < 0;
+			}
+
+			if (all_closed) {
+				// stop when all files are closed
 				break;
 			}
 
@@ -314,7 +358,8 @@ int LogWriterFile::write_message(LogType type, void *ptr, size_t size, uint64_t
 			while ((ret = write(type, ptr, 0, dropout_start)) == -1) {
 				unlock();
 				notify();
-				px4_usleep(3000);
+				// waiting for the writer thread: wall clock, also in lockstep (where the replay waits for the logger)
+				system_usleep(3000);
 				lock();
 			}
 		}
@@ -328,7 +373,7 @@ int LogWriterFile::write_message(LogType type, void *ptr, size_t size, uint64_t
 			while ((ret = write(type, uptr, write_size, 0)) == -1) {
 				unlock();
 				notify();
-				px4_usleep(3000);
+				system_usleep(3000);
 				lock();
 			}
 
@@ -342,6 +387,24 @@ int LogWriterFile::write_message(LogType type, void *ptr, size_t size, uint64_t
 	return write(type, ptr, size, dropout_start);
 }
 
+void *LogWriterFile::reserve_message(LogType type, size_t size, uint64_t dropout_start)
+{
+	// dropouts and reliable transfers are handled by write_message()
+	if (!is_started(type) || dropout_start || _need_reliable_transfer) {
+		return nullptr;
+	}
+
+	return _buffers[(int)type].reserve(size);
+}
+
+void LogWriterFile::commit_message(LogType type, size_t size)
+{
+	// the log might have been stopped in the meantime (on a write error)
+	if (is_started(type)) {
+		_buffers[(int)type].commit(size);
+	}
+}
+
 int LogWriterFile::write(LogType type, void *ptr, size_t size, uint64_t dropout_start)
 {
 	if (!is_started(type)) {
@@ -379,6 +442,8 @@ const char *log_type_str(LogType type)
 
 	case LogType::Mission: return "mission";
 
+	case LogType::Secondary: return "secondary";
+
 	case LogType::Count: break;
 	}
 
@@ -393,10 +458,16 @@ LogWriterFile::LogFileBuffer::LogFileBuffer(size_t log_buffer_size, perf_counter
 
 LogWriterFile::LogFileBuffer::~LogFileBuffer()
 {
+#if defined(__PX4_LINUX)
+	_async_writer.close();
+#else
+
 	if (_fd >= 0) {
 		close(_fd);
 	}
 
+#endif /* __PX4_LINUX */
+
 	delete[] _buffer;
 
 	perf_free(_perf_write);
@@ -443,9 +514,24 @@ size_t LogWriterFile::LogFileBuffer::get_read_ptr(void **ptr, bool *is_part)
 	}
 }
 
-bool LogWriterFile::LogFileBuffer::start_log(const char *filename)
+bool LogWriterFile::LogFileBuffer::start_log(const char *filename, size_t compression_block_size)
 {
+	_compress = false;
+
+	if (compression_block_size > 0) {
+		if (_compressor.init(compression_block_size)) {
+			_compress = true;
+
+		} else {
+			PX4_ERR("Can't create compression buffers, logging uncompressed");
+		}
+	}
+
+#if defined(__PX4_LINUX)
+	_fd = _async_writer.open(filename, _perf_write, _perf_fsync, _latency_histogram);
+#else
 	_fd = ::open(filename, O_CREAT | O_WRONLY, PX4_O_MODE_666);
+#endif /* __PX4_LINUX */
 
 	if (_fd < 0) {
 		PX4_ERR("Can't open log file %s, errno: %d", filename, errno);
@@ -457,8 +543,7 @@ bool LogWriterFile::LogFileBuffer::start_log(const char *filename)
 
 		if (_buffer == nullptr) {
 			PX4_ERR("Can't create log buffer");
-			::close(_fd);
-			_fd = -1;
+			close_file();
 			return false;
 		}
 	}
@@ -467,30 +552,121 @@ bool LogWriterFile::LogFileBuffer::start_log(const char *filename)
 	_head = 0;
 	_count = 0;
 	_total_written = 0;
+	_file_size = 0;
+
+	if (_compress) {
+		const ulog_compression::file_header_s header = _compressor.file_header();
+
+		if (!write_all(&header, sizeof(header))) {
+			PX4_ERR("Can't write log file header, errno: %d", errno);
+			close_file();
+			return false;
+		}
+	}
 
 	_should_run = true;
 
 	return true;
 }
 
-void LogWriterFile::LogFileBuffer::fsync() const
+void LogWriterFile::LogFileBuffer::fsync()
 {
+#if defined(__PX4_LINUX)
+	// asynchronous, the latency is measured by the writer
+	_async_writer.sync();
+#else
 	perf_begin(_perf_fsync);
 	::fsync(_fd);
 	perf_end(_perf_fsync);
+#endif /* __PX4_LINUX */
 }
 
-ssize_t LogWriterFile::LogFileBuffer::write_to_file(const void *buffer, size_t size, bool call_fsync) const
+ssize_t LogWriterFile::LogFileBuffer::write_to_file(const void *buffer, size_t size, bool call_fsync)
 {
-	perf_begin(_perf_write);
-	ssize_t ret = ::write(_fd, buffer, size);
-	perf_end(_perf_write);
+	if (!_compress) {
+#if defined(__PX4_LINUX)
+		ssize_t ret = write_all(buffer, size) ? size : -1;
+#else
+		perf_begin(_perf_write);
+		ssize_t ret = ::write(_fd, buffer, size);
+		perf_end(_perf_write);
+
+		if (ret > 0) {
+			_file_size += ret;
+		}
+
+#endif /* __PX4_LINUX */
+
+		if (call_fsync) {
+			fsync();
+		}
+
+		return ret;
+	}
+
+	const uint8_t *data = static_cast<const uint8_t *>(buffer);
+	size_t consumed = 0;
+
+	while (consumed < size) {
+		consumed += _compressor.append(data + consumed, size - consumed);
+
+		if (_compressor.full() && !write_block()) {
+			return -1;
+		}
+	}
 
 	if (call_fsync) {
+		// also write the partial block, so that at most the data since the last fsync is lost on a crash
+		if (!_compressor.empty() && !write_block()) {
+			return -1;
+		}
+
 		fsync();
 	}
 
-	return ret;
+	return consumed;
+}
+
+bool LogWriterFile::LogFileBuffer::write_block()
+{
+	size_t size;
+	const uint8_t *block = _compressor.encode_block(size);
+	return write_all(block, size);
+}
+
+bool LogWriterFile::LogFileBuffer::write_all(const void *buffer, size_t size)
+{
+#if defined(__PX4_LINUX)
+
+	if (!_async_writer.write(buffer, size)) {
+		return false;
+	}
+
+	_file_size += size;
+	return true;
+#else
+	const uint8_t *data = static_cast<const uint8_t *>(buffer);
+
+	while (size > 0) {
+		perf_begin(_perf_write);
+		ssize_t ret = ::write(_fd, data, size);
+		perf_end(_perf_write);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return false;
+		}
+
+		data += ret;
+		size -= ret;
+		_file_size += ret;
+	}
+
+	return true;
+#endif /* __PX4_LINUX */
 }
 
 void LogWriterFile::LogFileBuffer::close_file()
@@ -499,12 +675,23 @@ void LogWriterFile::LogFileBuffer::close_file()
 	_count = 0;
 
 	if (_fd >= 0) {
+		if (_compress && !_compressor.empty() && !write_block()) {
+			PX4_WARN("writing last block failed (%i)", errno);
+		}
+
+#if defined(__PX4_LINUX)
+		int res = _async_writer.close();
+#else
 		int res = close(_fd);
+#endif /* __PX4_LINUX */
 		_fd = -1;
 
 		if (res) {
 			PX4_WARN("closing log file failed (%i)", errno);
 
+		} else if (_compress) {
+			PX4_INFO("closed logfile, bytes written: %zu (compressed: %zu)", _total_written, _file_size);
+
 		} else {
 			PX4_INFO("closed logfile, bytes written: %zu", _total_written);
 		}
@@ -38,6 +38,9 @@
 #include <pthread.h>
 #include <drivers/drv_hrt.h>
 #include <perf/perf_counter.h>
+#include <lib/ulog_compression/ulog_compression.h>
+
+#include "async_file_writer.h"
 
 namespace px4
 {
@@ -51,6 +54,7 @@ namespace logger
 enum class LogType {
 	Full = 0, //!< Normal, full size log
 	Mission,  //!< reduced mission log (e.g. for geotagging)
+	Secondary, //!< additional log with a separately configured topic set and rates (e.g. decimated)
 
 	Count
 };
@@ -77,7 +81,10 @@ public:
 
 	void thread_stop();
 
-	void start_log(LogType type, const char *filename);
+	/**
+	 * @param compression_block_size >0: compress the file in blocks of this size
+	 */
+	void start_log(LogType type, const char *filename, size_t compression_block_size = 0);
 
 	void stop_log(LogType type);
 
@@ -86,6 +93,12 @@ public:
 	/** @see LogWriter::write_message() */
 	int write_message(LogType type, void *ptr, size_t size, uint64_t dropout_start = 0);
 
+	/** @see LogWriter::reserve_message() */
+	void *reserve_message(LogType type, size_t size, uint64_t dropout_start = 0);
+
+	/** @see LogWriter::commit_message() */
+	void commit_message(LogType type, size_t size);
+
 	void lock()
 	{
 		pthread_mutex_lock(&_mtx);
@@ -156,7 +169,7 @@ private:
 
 		~LogFileBuffer();
 
-		bool start_log(const char *filename);
+		bool start_log(const char *filename, size_t compression_block_size);
 
 		void close_file();
 
@@ -167,13 +180,39 @@ private:
 		 */
 		inline void write_no_check(void *ptr, size_t size);
 
+		/**
+		 * Get a pointer to size contiguous free bytes at the write position
+		 * @return nullptr if not enough contiguous space available
+		 */
+		void *reserve(size_t size)
+		{
+			if (_buffer == nullptr || size > available() || size > _buffer_size - _head) {
+				return nullptr;
+			}
+
+			return &_buffer[_head];
+		}
+
+		/**
+		 * Mark size bytes of a previously reserved region as written
+		 */
+		void commit(size_t size)
+		{
+			_head = (_head + size) % _buffer_size;
+			_count += size;
+		}
+
 		size_t available() const { return _buffer_size - _count; }
 
 		int fd() const { return _fd; }
 
-		inline ssize_t write_to_file(const void *buffer, size_t size, bool call_fsync) const;
+		/**
+		 * Write to the file (through the compressor if enabled)
+		 * @return number of bytes consumed from buffer, <0 on error
+		 */
+		inline ssize_t write_to_file(const void *buffer, size_t size, bool call_fsync);
 
-		inline void fsync() const;
+		inline void fsync();
 
 		void mark_read(size_t n) { _count -= n; _total_written += n; }
 
@@ -181,9 +220,25 @@ private:
 		size_t buffer_size() const { return _buffer_size; }
 		size_t count() const { return _count; }
 
+		bool compressed() const { return _compress; }
+
+#if defined(__PX4_LINUX)
+		void set_latency_histogram(perf_counter_t *latency_histogram) { _latency_histogram = latency_histogram; }
+#endif /* __PX4_LINUX */
+
 		bool _should_run = false;
 
 	private:
+		/**
+		 * Compress the buffered data and write the block to the file
+		 */
+		bool write_block();
+
+		/**
+		 * write all data (retrying on partial writes)
+		 */
+		bool write_all(const void *buffer, size_t size);
+
 		const size_t _buffer_size;
 		int	_fd = -1;
 		uint8_t *_buffer = nullptr;
@@ -192,10 +247,23 @@ private:
 		size_t _total_written = 0;
 		perf_counter_t _perf_write;
 		perf_counter_t _perf_fsync;
+
+		bool _compress = false;
+		ulog_compression::Compressor _compressor;
+		size_t _file_size = 0; ///< bytes written to the file (compressed)
+
+#if defined(__PX4_LINUX)
+		AsyncFileWriter _async_writer;
+		perf_counter_t *_latency_histogram = nullptr;
+#endif /* __PX4_LINUX */
 	};
 
 	LogFileBuffer _buffers[(int)LogType::Count];
 
+#if defined(__PX4_LINUX)
+	perf_counter_t _perf_write_latency[AsyncFileWriter::NUM_LATENCY_BUCKETS] {};
+#endif /* __PX4_LINUX */
+
 	bool 		_exit_thread = false;
 	bool		_need_reliable_transfer = false;
 	pthread_mutex_t		_mtx;
@@ -75,6 +75,7 @@ void LogWriterMavlink::start_log()
 	_ulog_stream_data.msg_sequence = 0;
 	_ulog_stream_data.length = 0;
 	_ulog_stream_data.first_message_offset = 0;
+	_num_unacked = 0;
 
 	_is_started = true;
 }
@@ -115,6 +116,11 @@ int LogWriterMavlink::write_message(void *ptr, size_t size)
 	return 0;
 }
 
+void LogWriterMavlink::set_ack_window(int window)
+{
+	_ack_window = math::constrain(window, 1, (int)ulog_stream_ack_s::MAX_WINDOW_SIZE);
+}
+
 void LogWriterMavlink::set_need_reliable_transfer(bool need_reliable)
 {
 	if (!need_reliable && _need_reliable_transfer) {
@@ -122,6 +128,12 @@ void LogWriterMavlink::set_need_reliable_transfer(bool need_reliable)
 			// make sure to send previous data using reliable transfer
 			publish_message();
 		}
+
+		// all reliable data must be received before continuing with unreliable data
+		if (is_started() && wait_for_acks(0)) {
+			PX4_ERR("Ack timeout. Stopping mavlink log");
+			stop_log();
+		}
 	}
 
 	_need_reliable_transfer = need_reliable;
@@ -139,48 +151,60 @@ int LogWriterMavlink::publish_message()
 	_ulog_stream_pub.publish(_ulog_stream_data);
 
 	if (_need_reliable_transfer) {
-		// we need to wait for an ack. Note that this blocks the main logger thread, so if a file logging
-		// is already running, it will miss samples.
-		px4_pollfd_struct_t fds[1];
-		fds[0].fd = _ulog_stream_ack_sub;
-		fds[0].events = POLLIN;
-		bool got_ack = false;
-		const int timeout_ms = ulog_stream_ack_s::ACK_TIMEOUT * ulog_stream_ack_s::ACK_MAX_TRIES;
+		if (_num_unacked == 0) {
+			_first_unacked_sequence = _ulog_stream_data.msg_sequence;
+		}
 
-		hrt_abstime started = hrt_absolute_time();
+		++_num_unacked;
 
-		do {
-			int ret = px4_poll(fds, sizeof(fds) / sizeof(fds[0]), timeout_ms);
+		// we need to wait for an ack if the window is full. Note that this blocks the main logger thread,
+		// so if a file logging is already running, it will miss samples.
+		if (wait_for_acks(_ack_window - 1)) {
+			PX4_ERR("Ack timeout. Stopping mavlink log");
+			stop_log();
+			return -2;
+		}
+	}
 
-			if (ret <= 0) {
-				break;
-			}
+	_ulog_stream_data.msg_sequence++;
+	_ulog_stream_data.length = 0;
+	_ulog_stream_data.first_message_offset = 255;
+	return 0;
+}
 
-			if (fds[0].revents & POLLIN) {
-				ulog_stream_ack_s ack;
-				orb_copy(ORB_ID(ulog_stream_ack), _ulog_stream_ack_sub, &ack);
+int LogWriterMavlink::wait_for_acks(int max_unacked)
+{
+	px4_pollfd_struct_t fds[1];
+	fds[0].fd = _ulog_stream_ack_sub;
+	fds[0].events = POLLIN;
+	const int timeout_ms = ulog_stream_ack_s::ACK_TIMEOUT * ulog_stream_ack_s::ACK_MAX_TRIES;
 
-				if (ack.msg_sequence == _ulog_stream_data.msg_sequence) {
-					got_ack = true;
-				}
+	hrt_abstime last_progress = hrt_absolute_time();
 
-			} else {
-				break;
-			}
-		} while (!got_ack && hrt_elapsed_time(&started) / 1000 < timeout_ms);
+	while (_num_unacked > max_unacked) {
+		int ret = px4_poll(fds, sizeof(fds) / sizeof(fds[0]), timeout_ms);
 
-		if (!got_ack) {
-			PX4_ERR("Ack timeout. Stopping mavlink log");
-			stop_log();
+		if (ret <= 0 || !(fds[0].revents & POLLIN)) {
 			return -2;
 		}
 
-		PX4_DEBUG("got ack in %i ms", (int)(hrt_elapsed_time(&started) / 1000));
+		ulog_stream_ack_s ack;
+		orb_copy(ORB_ID(ulog_stream_ack), _ulog_stream_ack_sub, &ack);
+
+		// the ack is cumulative: all messages up to msg_sequence are acked
+		const uint16_t num_acked = ack.msg_sequence - _first_unacked_sequence + 1;
+
+		// a repeated ack of the last acked message (num_acked == 0) is no progress
+		if ((num_acked > 0) && (num_acked <= _num_unacked)) {
+			_num_unacked -= num_acked;
+			_first_unacked_sequence = ack.msg_sequence + 1;
+			last_progress = hrt_absolute_time();
+
+		} else if (hrt_elapsed_time(&last_progress) / 1000 > (hrt_abstime)timeout_ms) {
+			return -2;
+		}
 	}
 
-	_ulog_stream_data.msg_sequence++;
-	_ulog_stream_data.length = 0;
-	_ulog_stream_data.first_message_offset = 255;
 	return 0;
 }
 
@@ -71,16 +71,32 @@ public:
 		return _need_reliable_transfer;
 	}
 
+	/**
+	 * Set the maximum number of messages (that need an ack) in flight.
+	 * 1 means each message is acked before sending the next one.
+	 */
+	void set_ack_window(int window);
+
 private:
 
 	/** publish message, wait for ack if needed & reset message */
 	int publish_message();
 
+	/**
+	 * wait until at most max_unacked messages are not acked yet
+	 * @return 0 on success, -2 on timeout
+	 */
+	int wait_for_acks(int max_unacked);
+
 	ulog_stream_s _ulog_stream_data{};
 	uORB::PublicationQueued<ulog_stream_s> _ulog_stream_pub{ORB_ID(ulog_stream)};
 	int _ulog_stream_ack_sub{-1};
 	bool _need_reliable_transfer{false};
 	bool _is_started{false};
+
+	int _ack_window{1};
+	int _num_unacked{0}; ///< number of published messages that are not acked yet
+	uint16_t _first_unacked_sequence{0};
 };
 
 }
@@ -50,6 +50,7 @@
 #include <uORB/topics/vehicle_command_ack.h>
 
 #include <drivers/drv_hrt.h>
+#include <drivers/drv_orb_dev.h>
 #include <mathlib/math/Limits.hpp>
 #include <px4_platform_common/getopt.h>
 #include <px4_platform_common/log.h>
@@ -84,6 +85,10 @@ struct timer_callback_data_s {
 
 	watchdog_data_t watchdog_data;
 	volatile bool watchdog_triggered = false;
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	px4::atomic<int> *wakeups = nullptr; ///< incremented for every post of the semaphore
+#endif
 };
 
 /* This is used to schedule work for the logger (periodic scan for updated topics) */
@@ -109,6 +114,14 @@ static void timer_callback(void *arg)
 		return;
 	}
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+
+	if (data->wakeups != nullptr) {
+		data->wakeups->fetch_add(1);
+	}
+
+#endif
+
 	px4_sem_post(&data->semaphore);
 
 }
@@ -173,7 +186,7 @@ int Logger::task_spawn(int argc, char *argv[])
 
 int Logger::print_status()
 {
-	PX4_INFO("Running in mode: %s", configured_backend_mode());
+	PX4_INFO("Running in mode: %s%s", configured_backend_mode(), _event_driven ? " (event-driven)" : "");
 
 	bool is_logging = false;
 
@@ -189,8 +202,14 @@ int Logger::print_status()
 		is_logging = true;
 	}
 
-	if (_writer.is_started(LogType::Full, LogWriter::BackendMavlink)) {
-		PX4_INFO("Mavlink Logging Running (Full log)");
+	if (_writer.is_started(LogType::Secondary, LogWriter::BackendFile)) {
+		PX4_INFO("Secondary File Logging Running (%i topics):", _num_secondary_subs);
+		print_statistics(LogType::Secondary);
+		is_logging = true;
+	}
+
+	if (_writer.is_started(_writer.mavlink_log_type(), LogWriter::BackendMavlink)) {
+		PX4_INFO("Mavlink Logging Running (%s log)", log_type_str(_writer.mavlink_log_type()));
 		is_logging = true;
 	}
 
@@ -198,6 +217,13 @@ int Logger::print_status()
 		PX4_INFO("Not logging");
 	}
 
+	for (const LoggerSubscription &sub : _subscriptions) {
+		if (sub.batch_queue_size > 0) {
+			PX4_INFO("Batch topic %s(%i): queue size: %i, lost samples: %u", sub.get_topic()->o_name, sub.get_instance(),
+				 sub.batch_queue_size, sub.lost_samples);
+		}
+	}
+
 	return 0;
 }
 
@@ -241,12 +267,13 @@ Logger *Logger::instantiate(int argc, char *argv[])
 	bool log_name_timestamp = false;
 	LogWriter::Backend backend = LogWriter::BackendAll;
 	const char *poll_topic = nullptr;
+	bool event_driven = false;
 
 	int myoptind = 1;
 	int ch;
 	const char *myoptarg = nullptr;
 
-	while ((ch = px4_getopt(argc, argv, "r:b:etfm:p:x", &myoptind, &myoptarg)) != EOF) {
+	while ((ch = px4_getopt(argc, argv, "r:b:etfm:p:xu", &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'r': {
 				unsigned long r = strtoul(myoptarg, nullptr, 10);
@@ -308,6 +335,10 @@ Logger *Logger::instantiate(int argc, char *argv[])
 			poll_topic = myoptarg;
 			break;
 
+		case 'u':
+			event_driven = true;
+			break;
+
 		case '?':
 			error_flag = true;
 			break;
@@ -332,7 +363,8 @@ Logger *Logger::instantiate(int argc, char *argv[])
 		return nullptr;
 	}
 
-	Logger *logger = new Logger(backend, log_buffer_size, log_interval, poll_topic, log_mode, log_name_timestamp);
+	Logger *logger = new Logger(backend, log_buffer_size, log_interval, poll_topic, log_mode, log_name_timestamp,
+				    event_driven);
 
 #if defined(DBGPRINT) && defined(__PX4_NUTTX)
 	struct mallinfo alloc_info = mallinfo();
@@ -361,9 +393,10 @@ Logger *Logger::instantiate(int argc, char *argv[])
 
 
 Logger::Logger(LogWriter::Backend backend, size_t buffer_size, uint32_t log_interval, const char *poll_topic_name,
-	       LogMode log_mode, bool log_name_timestamp) :
+	       LogMode log_mode, bool log_name_timestamp, bool event_driven) :
 	_log_mode(log_mode),
 	_log_name_timestamp(log_name_timestamp),
+	_event_driven(event_driven),
 	_writer(backend, buffer_size),
 	_log_interval(log_interval)
 {
@@ -371,6 +404,12 @@ Logger::Logger(LogWriter::Backend backend, size_t buffer_size, uint32_t log_inte
 	_log_dirs_max = param_find("SDLOG_DIRS_MAX");
 	_sdlog_profile_handle = param_find("SDLOG_PROFILE");
 	_mission_log = param_find("SDLOG_MISSION");
+	_compress = param_find("SDLOG_COMPRESS");
+	_compress_block_size = param_find("SDLOG_CMP_BLOCK");
+	_secondary_profile = param_find("SDLOG_PROF_SEC");
+	_secondary_interval = param_find("SDLOG_SEC_INT");
+	_mavlink_secondary = param_find("SDLOG_MAV_SEC");
+	_mavlink_ack_window = param_find("SDLOG_MAV_WIN");
 
 	if (poll_topic_name) {
 		const orb_metadata *const *topics = orb_get_topics();
@@ -386,6 +425,11 @@ Logger::Logger(LogWriter::Backend backend, size_t buffer_size, uint32_t log_inte
 			PX4_ERR("Failed to find topic %s", poll_topic_name);
 		}
 	}
+
+	if (_polling_topic_meta && _event_driven) {
+		PX4_WARN("polling on a topic, ignoring event-driven mode");
+		_event_driven = false;
+	}
 }
 
 Logger::~Logger()
@@ -452,7 +496,10 @@ bool Logger::add_topic(const char *name, uint32_t interval_ms, uint8_t instance)
 					PX4_DEBUG("logging topic %s(%d), interval: %i, already added, only setting interval",
 						  topics[i]->o_name, instance, interval_ms);
 
-					_subscriptions[j].set_interval_ms(interval_ms);
+					// the secondary log does not change the rates of the full log
+					if (!_adding_secondary_topics) {
+						_subscriptions[j].set_interval_ms(interval_ms);
+					}
 
 					subscription = &_subscriptions[j];
 					already_added = true;
@@ -468,9 +515,81 @@ bool Logger::add_topic(const char *name, uint32_t interval_ms, uint8_t instance)
 		}
 	}
 
+	if (subscription && _adding_secondary_topics) {
+		if (!subscription->secondary) {
+			++_num_secondary_subs;
+		}
+
+		subscription->secondary = true;
+		subscription->secondary_interval_ms = math::max((uint16_t)math::min(interval_ms, (uint32_t)UINT16_MAX),
+						      _secondary_min_interval_ms);
+	}
+
 	return (subscription != nullptr);
 }
 
+bool Logger::add_batch_topic(const char *name, uint8_t queue_size, uint8_t instance)
+{
+	if (queue_size < 2) {
+		return add_topic(name, 0, instance);
+	}
+
+	if (!add_topic(name, 0, instance)) {
+		return false;
+	}
+
+	for (LoggerSubscription &sub : _subscriptions) {
+		if ((strcmp(sub.get_topic()->o_name, name) == 0) && (sub.get_instance() == instance)) {
+			// batch topics are never rate-limited
+			sub.set_interval_ms(0);
+			sub.batch_queue_size = queue_size;
+			PX4_DEBUG("logging topic %s(%d) in batch mode, queue size: %i", name, instance, queue_size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Logger::initialize_batch_queues()
+{
+	for (LoggerSubscription &sub : _subscriptions) {
+		if (sub.batch_queue_size == 0) {
+			continue;
+		}
+
+		// subscribing creates the topic if it does not exist yet. An already published queue gets reallocated.
+		int fd = orb_subscribe_multi(sub.get_topic(), sub.get_instance());
+
+		if (fd >= 0) {
+			if (px4_ioctl(fd, ORBIOCSETQUEUESIZE, sub.batch_queue_size) != PX4_OK) {
+				PX4_WARN("%s: failed to set queue size to %i, samples might get lost",
+					 sub.get_topic()->o_name, sub.batch_queue_size);
+			}
+
+			orb_unsubscribe(fd);
+		}
+
+		sub.subscribe();
+	}
+}
+
+void Logger::write_batch_dropout(LoggerSubscription &sub, uint32_t lost_samples, uint64_t timestamp)
+{
+	sub.lost_samples += lost_samples;
+
+	// duration of the gap between the last logged and the current sample
+	uint64_t duration_ms = 0;
+
+	if ((sub.last_timestamp != 0) && (timestamp > sub.last_timestamp)) {
+		duration_ms = (timestamp - sub.last_timestamp) / 1000;
+	}
+
+	ulog_message_dropout_s dropout{};
+	dropout.duration = (uint16_t)math::min(duration_ms, (uint64_t)UINT16_MAX);
+	write_message(LogType::Full, &dropout, sizeof(dropout));
+}
+
 bool Logger::add_topic_multi(const char *name, uint32_t interval_ms)
 {
 	// add all possible instances
@@ -492,12 +611,18 @@ bool Logger::copy_if_updated(int sub_idx, void *buffer, bool try_to_subscribe)
 
 	} else if (try_to_subscribe) {
 		if (sub.subscribe()) {
+			register_update_notifier(sub_idx);
+
 			write_add_logged_msg(LogType::Full, sub);
 
 			if (sub_idx < _num_mission_subs) {
 				write_add_logged_msg(LogType::Mission, sub);
 			}
 
+			if (sub.secondary) {
+				write_add_logged_msg(LogType::Secondary, sub);
+			}
+
 			// copy first data
 			updated = sub.copy(buffer);
 		}
@@ -506,6 +631,167 @@ bool Logger::copy_if_updated(int sub_idx, void *buffer, bool try_to_subscribe)
 	return updated;
 }
 
+bool Logger::is_logged(LogType type, int sub_idx) const
+{
+	switch (type) {
+	case LogType::Mission: return sub_idx < _num_mission_subs;
+
+	case LogType::Secondary: return _subscriptions[sub_idx].secondary;
+
+	default: return true;
+	}
+}
+
+size_t Logger::write_subscription(int sub_idx, bool try_to_subscribe, hrt_abstime loop_time)
+{
+	LoggerSubscription &sub = _subscriptions[sub_idx];
+
+	// in batch mode write all queued samples, otherwise only the latest
+	const int max_samples = (sub.batch_queue_size > 0) ? sub.batch_queue_size : 1;
+	size_t total_size = 0;
+
+	// each message consists of a header followed by an orb data object
+	const size_t msg_size = sizeof(ulog_message_data_header_s) + sub.get_topic()->o_size_no_padding;
+	const uint16_t write_msg_size = static_cast<uint16_t>(msg_size - ULOG_MSG_HEADER_LEN);
+	const uint16_t write_msg_id = sub.msg_id;
+	// the uORB copy includes the padding
+	const size_t reserve_size = sizeof(ulog_message_data_header_s) + sub.get_topic()->o_size;
+
+	for (int sample = 0; sample < max_samples; ++sample) {
+		const bool was_valid = sub.valid();
+		const unsigned last_generation = sub.last_generation();
+
+		/* if this topic has been updated, copy the new data into the message buffer
+		 * and write a message to the log.
+		 * To avoid an extra copy, the message is constructed directly in the log buffer if possible.
+		 * The uORB copy is done without holding the lock, so that the writer thread is not blocked.
+		 */
+		uint8_t *reserved = nullptr;
+		bool updated = false;
+
+		if (was_valid) {
+			if (!sub.updated()) {
+				break;
+			}
+
+			_writer.lock();
+			reserved = static_cast<uint8_t *>(_writer.reserve_message(LogType::Full, reserve_size,
+							  _statistics[(int)LogType::Full].dropout_start));
+			_writer.unlock();
+
+			uint8_t *buffer = reserved ? reserved : _msg_buffer;
+			updated = sub.copy(buffer + sizeof(ulog_message_data_header_s));
+
+		} else {
+			// subscribing writes the format & add logged messages
+			_writer.lock();
+			updated = copy_if_updated(sub_idx, _msg_buffer + sizeof(ulog_message_data_header_s), try_to_subscribe);
+			_writer.unlock();
+		}
+
+		if (!updated) {
+			// the reservation is simply dropped
+			break;
+		}
+
+		uint8_t *msg = reserved ? reserved : _msg_buffer;
+
+		_writer.lock();
+
+		if (sub.batch_queue_size > 0) {
+			// every topic starts with the timestamp
+			uint64_t timestamp;
+			memcpy(&timestamp, msg + sizeof(ulog_message_data_header_s), sizeof(timestamp));
+
+			// the generation skips the samples that were overwritten in the queue
+			if (was_valid && (sub.last_timestamp != 0) && (sub.last_generation() - last_generation > 1)) {
+				if (reserved) {
+					// the dropout message must go first
+					memcpy(_msg_buffer, reserved, msg_size);
+					msg = _msg_buffer;
+					reserved = nullptr;
+				}
+
+				write_batch_dropout(sub, sub.last_generation() - last_generation - 1, timestamp);
+			}
+
+			sub.last_timestamp = timestamp;
+		}
+
+		//write one byte after another (necessary because of alignment)
+		msg[0] = (uint8_t)write_msg_size;
+		msg[1] = (uint8_t)(write_msg_size >> 8);
+		msg[2] = static_cast<uint8_t>(ULogMessageType::DATA);
+		msg[3] = (uint8_t)write_msg_id;
+		msg[4] = (uint8_t)(write_msg_id >> 8);
+
+		// PX4_INFO("topic: %s, size = %zu, out_size = %zu", sub.get_topic()->o_name, sub.get_topic()->o_size, msg_size);
+
+		// full log
+		if (reserved) {
+			_writer.commit_message(LogType::Full, reserved, msg_size);
+			total_size += msg_size;
+
+		} else if (write_message(LogType::Full, msg, msg_size)) {
+			total_size += msg_size;
+		}
+
+		// mission log
+		if (sub_idx < _num_mission_subs) {
+			if (_writer.is_started(LogType::Mission)) {
+				if (_mission_subscriptions[sub_idx].next_write_time < (loop_time / 100000)) {
+					unsigned delta_time = _mission_subscriptions[sub_idx].min_delta_ms;
+
+					if (delta_time > 0) {
+						_mission_subscriptions[sub_idx].next_write_time = (loop_time / 100000) + delta_time / 100;
+					}
+
+					// msg is still valid, as we hold the lock
+					write_message(LogType::Mission, msg, msg_size);
+				}
+			}
+		}
+
+		// secondary log (decimated independently from the full log)
+		if (sub.secondary && loop_time >= sub.secondary_next_write && _writer.is_started(LogType::Secondary)) {
+			sub.secondary_next_write = loop_time + sub.secondary_interval_ms * 1000;
+			write_message(LogType::Secondary, msg, msg_size);
+		}
+
+		_writer.unlock();
+	}
+
+	return total_size;
+}
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+bool Logger::lockstep_idle(void *arg)
+{
+	Logger *logger = static_cast<Logger *>(arg);
+
+	if (logger->_lockstep_polling_sub >= 0) {
+		// the logger leaves the polling state before it copies the update, so if it is still (or again)
+		// polling after the check, the check saw the topic state while the logger was blocked
+		bool updated = true;
+
+		return logger->_lockstep_polling.load()
+		       && (orb_check(logger->_lockstep_polling_sub, &updated) == PX4_OK) && !updated
+		       && logger->_lockstep_polling.load();
+	}
+
+	return logger->_lockstep_wakeups.load() == 0;
+}
+#endif
+
+void Logger::register_update_notifier(int sub_idx)
+{
+	if (_event_driven && _subscriptions[sub_idx].valid()) {
+		if (!_subscriptions[sub_idx].register_update_notifier(&_update_notifier, sub_idx)) {
+			PX4_ERR("failed to register callback for %s", _subscriptions[sub_idx].get_topic()->o_name);
+		}
+	}
+}
+
 void Logger::add_default_topics()
 {
 	add_topic("actuator_controls_0", 100);
@@ -597,6 +883,10 @@ void Logger::add_debug_topics()
 	add_topic("debug_key_value");
 	add_topic("debug_value");
 	add_topic("debug_vect");
+
+	// published with 'uorb instrument start' and 'work_queue instrument start'
+	add_topic("uorb_topic_statistics");
+	add_topic("work_item_statistics");
 }
 
 void Logger::add_estimator_replay_topics()
@@ -680,10 +970,12 @@ int Logger::add_topics_from_file(const char *fname)
 			continue;
 		}
 
-		// read line with format: <topic_name>[, <interval>]
+		// read line with format: <topic_name>[, <interval>[, <batch queue size>]]
+		// (a batch queue size > 1 logs every sample of the topic, see add_batch_topic())
 		char topic_name[80];
 		uint32_t interval_ms = 0;
-		int nfields = sscanf(line, "%s %u", topic_name, &interval_ms);
+		uint32_t batch_queue_size = 0;
+		int nfields = sscanf(line, "%s %u%*[ ,]%u", topic_name, &interval_ms, &batch_queue_size);
 
 		if (nfields > 0) {
 			int name_len = strlen(topic_name);
@@ -692,8 +984,17 @@ int Logger::add_topics_from_file(const char *fname)
 				topic_name[name_len - 1] = '\0';
 			}
 
-			/* add topic with specified interval_ms */
-			if (add_topic(topic_name, interval_ms)) {
+			bool added;
+
+			if (batch_queue_size > 1) {
+				added = add_batch_topic(topic_name, (uint8_t)math::min(batch_queue_size, (uint32_t)UINT8_MAX));
+
+			} else {
+				/* add topic with specified interval_ms */
+				added = add_topic(topic_name, interval_ms);
+			}
+
+			if (added) {
 				ntopics++;
 
 			} else {
@@ -746,6 +1047,38 @@ void Logger::initialize_configured_topics()
 		sdlog_profile = SDLogProfileMask::DEFAULT;
 	}
 
+	add_profile_topics(sdlog_profile);
+}
+
+void Logger::initialize_secondary_topics()
+{
+	int32_t secondary_profile = 0;
+
+	if (_secondary_profile != PARAM_INVALID) {
+		param_get(_secondary_profile, &secondary_profile);
+	}
+
+	if (secondary_profile == 0) {
+		return;
+	}
+
+	int32_t min_interval_ms = 0;
+
+	if (_secondary_interval != PARAM_INVALID) {
+		param_get(_secondary_interval, &min_interval_ms);
+	}
+
+	_secondary_min_interval_ms = math::constrain(min_interval_ms, (int32_t)0, (int32_t)UINT16_MAX);
+
+	_adding_secondary_topics = true;
+	add_profile_topics((SDLogProfileMask)secondary_profile);
+	_adding_secondary_topics = false;
+
+	PX4_INFO("secondary log: %i topics", _num_secondary_subs);
+}
+
+void Logger::add_profile_topics(SDLogProfileMask sdlog_profile)
+{
 	// load appropriate topics for profile
 	// the order matters: if several profiles add the same topic, the logging rate of the last one will be used
 	if (sdlog_profile & SDLogProfileMask::DEFAULT) {
@@ -853,6 +1186,34 @@ void Logger::run()
 		initialize_configured_topics();
 	}
 
+	if (_mavlink_ack_window != PARAM_INVALID) {
+		int32_t ack_window = 1;
+		param_get(_mavlink_ack_window, &ack_window);
+		_writer.set_mavlink_ack_window(ack_window);
+	}
+
+	initialize_secondary_topics();
+
+	if (_num_secondary_subs > 0) {
+		int mkdir_ret = mkdir(LOG_ROOT[(int)LogType::Secondary], S_IRWXU | S_IRWXG | S_IRWXO);
+
+		if (mkdir_ret != 0 && errno != EEXIST) {
+			PX4_ERR("failed creating log root dir: %s (%i)", LOG_ROOT[(int)LogType::Secondary], errno);
+		}
+
+		int32_t mavlink_secondary = 0;
+
+		if (_mavlink_secondary != PARAM_INVALID) {
+			param_get(_mavlink_secondary, &mavlink_secondary);
+		}
+
+		if (mavlink_secondary) {
+			_writer.set_mavlink_log_type(LogType::Secondary);
+		}
+	}
+
+	initialize_batch_queues();
+
 	//all topics added. Get required message buffer size
 	int max_msg_size = 0;
 
@@ -901,6 +1262,10 @@ void Logger::run()
 
 	if (_log_mode == LogMode::boot_until_disarm || _log_mode == LogMode::boot_until_shutdown) {
 		start_log_file(LogType::Full);
+
+		if (_num_secondary_subs > 0) {
+			start_log_file(LogType::Secondary);
+		}
 	}
 
 	/* init the update timer */
@@ -910,6 +1275,12 @@ void Logger::run()
 	/* timer_semaphore use case is a signal */
 	px4_sem_setprotocol(&timer_callback_data.semaphore, SEM_PRIO_NONE);
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	timer_callback_data.wakeups = &_lockstep_wakeups;
+	_update_notifier.set_wakeup_counter(&_lockstep_wakeups);
+	bool lockstep_woken = false;
+#endif
+
 	int polling_topic_sub = -1;
 
 	if (_polling_topic_meta) {
@@ -934,6 +1305,22 @@ void Logger::run()
 		hrt_call_every(&timer_call, _log_interval, _log_interval, timer_callback, &timer_callback_data);
 	}
 
+	if (_event_driven) {
+		// publications wake us up in addition to the timer, which is still needed for the housekeeping
+		// (and to pick up the rate-limited topics)
+		_update_notifier.set_semaphore(&timer_callback_data.semaphore);
+
+		for (int sub_idx = 0; sub_idx < (int)_subscriptions.size(); ++sub_idx) {
+			register_update_notifier(sub_idx);
+		}
+	}
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	// let the replay (which drives the time) wait for the logger iterations
+	_lockstep_polling_sub = polling_topic_sub;
+	_lockstep_component = px4_lockstep_register_component(lockstep_idle, this);
+#endif
+
 	// check for new subscription data
 	hrt_abstime next_subscribe_check = 0;
 	int next_subscribe_topic_index = -1; // this is used to distribute the checks over time
@@ -961,7 +1348,9 @@ void Logger::run()
 
 		const hrt_abstime loop_time = hrt_absolute_time();
 
-		if (_writer.is_started(LogType::Full)) { // mission log only runs when full log is also started
+		// mission and secondary file logs only run when the full log is also started, but the secondary
+		// log might be streamed via mavlink
+		if (_writer.is_started(LogType::Full) || _writer.is_started(LogType::Secondary)) {
 
 			/* check if we need to output the process load */
 			if (_next_load_print != 0 && loop_time >= _next_load_print) {
@@ -983,62 +1372,67 @@ void Logger::run()
 					parameter_update_sub.copy(&pupdate);
 
 					write_changed_parameters(LogType::Full);
+
+					if (_writer.is_started(LogType::Secondary)) {
+						write_changed_parameters(LogType::Secondary);
+					}
 				}
 			}
 
-			/* wait for lock on log buffer */
-			_writer.lock();
-
-			int sub_idx = 0;
-
-			for (LoggerSubscription &sub : _subscriptions) {
-				/* if this topic has been updated, copy the new data into the message buffer
-				 * and write a message to the log
-				 */
-				const bool try_to_subscribe = (sub_idx == next_subscribe_topic_index);
+			// the subscriptions take the lock on the log buffer only while writing
+			if (_event_driven) {
+				uint32_t updated[TopicUpdateNotifier::WORDS];
+				_update_notifier.take(updated);
 
-				if (copy_if_updated(sub_idx, _msg_buffer + sizeof(ulog_message_data_header_s), try_to_subscribe)) {
-					// each message consists of a header followed by an orb data object
-					const size_t msg_size = sizeof(ulog_message_data_header_s) + sub.get_topic()->o_size_no_padding;
-					const uint16_t write_msg_size = static_cast<uint16_t>(msg_size - ULOG_MSG_HEADER_LEN);
-					const uint16_t write_msg_id = sub.msg_id;
+				for (int word = 0; word < TopicUpdateNotifier::WORDS; ++word) {
+					while (updated[word] != 0) {
+						const int bit = __builtin_ctz(updated[word]);
+						updated[word] &= ~(1u << bit);
 
-					//write one byte after another (necessary because of alignment)
-					_msg_buffer[0] = (uint8_t)write_msg_size;
-					_msg_buffer[1] = (uint8_t)(write_msg_size >> 8);
-					_msg_buffer[2] = static_cast<uint8_t>(ULogMessageType::DATA);
-					_msg_buffer[3] = (uint8_t)write_msg_id;
-					_msg_buffer[4] = (uint8_t)(write_msg_id >> 8);
+						const int sub_idx = word * 32 + bit;
+						LoggerSubscription &sub = _subscriptions[sub_idx];
 
-					// PX4_INFO("topic: %s, size = %zu, out_size = %zu", sub.get_topic()->o_name, sub.get_topic()->o_size, msg_size);
+						// topics without rate limit: write all queued samples
+						for (int i = 0; i < MAX_QUEUED_UPDATES; ++i) {
+							const size_t bytes = write_subscription(sub_idx, false, loop_time);
 
-					// full log
-					if (write_message(LogType::Full, _msg_buffer, msg_size)) {
+							if (bytes == 0) {
+								break;
+							}
 
 #ifdef DBGPRINT
-						total_bytes += msg_size;
+							total_bytes += bytes;
 #endif /* DBGPRINT */
-					}
-
-					// mission log
-					if (sub_idx < _num_mission_subs) {
-						if (_writer.is_started(LogType::Mission)) {
-							if (_mission_subscriptions[sub_idx].next_write_time < (loop_time / 100000)) {
-								unsigned delta_time = _mission_subscriptions[sub_idx].min_delta_ms;
-
-								if (delta_time > 0) {
-									_mission_subscriptions[sub_idx].next_write_time = (loop_time / 100000) + delta_time / 100;
-								}
+						}
 
-								write_message(LogType::Mission, _msg_buffer, msg_size);
-							}
+						if (sub.updated_ignore_interval()) {
+							// rate-limited (or not yet fully drained), check again on the next iteration
+							_update_notifier.notify(sub_idx, false);
 						}
 					}
 				}
 
-				++sub_idx;
+				// subscribe to topics that were not advertised yet
+				if (next_subscribe_topic_index != -1) {
+					write_subscription(next_subscribe_topic_index, true, loop_time);
+				}
+
+			} else {
+				for (int sub_idx = 0; sub_idx < (int)_subscriptions.size(); ++sub_idx) {
+					const bool try_to_subscribe = (sub_idx == next_subscribe_topic_index);
+					const size_t bytes = write_subscription(sub_idx, try_to_subscribe, loop_time);
+
+#ifdef DBGPRINT
+					total_bytes += bytes;
+#else
+					(void)bytes;
+#endif /* DBGPRINT */
+				}
 			}
 
+			/* wait for lock on log buffer */
+			_writer.lock();
+
 			// check for new logging message(s)
 			log_message_s log_message;
 
@@ -1114,7 +1508,9 @@ void Logger::run()
 			// - we'll get the data immediately once we start logging (no need to wait for the next subscribe timeout)
 			if (next_subscribe_topic_index != -1) {
 				if (!_subscriptions[next_subscribe_topic_index].valid()) {
-					_subscriptions[next_subscribe_topic_index].subscribe();
+					if (_subscriptions[next_subscribe_topic_index].subscribe()) {
+						register_update_notifier(next_subscribe_topic_index);
+					}
 				}
 
 				if (++next_subscribe_topic_index >= (int)_subscriptions.size()) {
@@ -1132,7 +1528,14 @@ void Logger::run()
 			px4_pollfd_struct_t fds[1];
 			fds[0].fd = polling_topic_sub;
 			fds[0].events = POLLIN;
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			_lockstep_polling.store(true);
+#endif
 			int pret = px4_poll(fds, 1, 1000);
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			// before the orb_copy() below, see lockstep_idle()
+			_lockstep_polling.store(false);
+#endif
 
 			if (pret < 0) {
 				PX4_ERR("poll failed (%i)", pret);
@@ -1152,14 +1555,42 @@ void Logger::run()
 			 * And on linux this is quite accurate as well, but under NuttX it is not accurate,
 			 * because usleep() has only a granularity of CONFIG_MSEC_PER_TICK (=1ms).
 			 */
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+
+			if (lockstep_woken) {
+				// the wakeup of this iteration is handled
+				_lockstep_wakeups.fetch_sub(1);
+			}
+
+#endif
+
 			while (px4_sem_wait(&timer_callback_data.semaphore) != 0) {}
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+			lockstep_woken = true;
+#endif
 		}
 	}
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	px4_lockstep_unregister_component(_lockstep_component);
+	_lockstep_component = -1;
+#endif
+
 	stop_log_file(LogType::Full);
 	stop_log_file(LogType::Mission);
+	stop_log_file(LogType::Secondary);
 
 	hrt_cancel(&timer_call);
+
+	if (_event_driven) {
+		for (LoggerSubscription &sub : _subscriptions) {
+			sub.unregisterCallback();
+		}
+
+		_update_notifier.set_semaphore(nullptr);
+	}
+
 	px4_sem_destroy(&timer_callback_data.semaphore);
 
 	// stop the writer thread
@@ -1259,6 +1690,10 @@ bool Logger::start_stop_logging(MissionLogType mission_log_type)
 			start_log_file(LogType::Mission);
 		}
 
+		if (_num_secondary_subs > 0) {
+			start_log_file(LogType::Secondary);
+		}
+
 	} else if (want_stop) {
 		// delayed stop: we measure the process loads and then stop
 		initialize_load_output(PrintLoadReason::Postflight);
@@ -1267,6 +1702,10 @@ bool Logger::start_stop_logging(MissionLogType mission_log_type)
 		if (mission_log_type != MissionLogType::Disabled) {
 			stop_log_file(LogType::Mission);
 		}
+
+		if (_num_secondary_subs > 0) {
+			stop_log_file(LogType::Secondary);
+		}
 	}
 
 	return bret;
@@ -1409,6 +1848,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 		replay_suffix = "_replayed";
 	}
 
+	const char *extension = (compression_block_size(type) > 0) ? "ulgz" : "ulg";
+
 	char *log_file_name = _file_name[(int)type].log_file_name;
 
 	if (time_ok) {
@@ -1420,7 +1861,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 
 		char log_file_name_time[16] = "";
 		strftime(log_file_name_time, sizeof(log_file_name_time), "%H_%M_%S", &tt);
-		snprintf(log_file_name, sizeof(LogFileName::log_file_name), "%s%s.ulg", log_file_name_time, replay_suffix);
+		snprintf(log_file_name, sizeof(LogFileName::log_file_name), "%s%s.%s", log_file_name_time, replay_suffix,
+			 extension);
 		snprintf(file_name + n, file_name_size - n, "/%s", log_file_name);
 
 	} else {
@@ -1435,7 +1877,8 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 		/* look for the next file that does not exist */
 		while (file_number <= MAX_NO_LOGFILE) {
 			/* format log file path: e.g. /fs/microsd/log/sess001/log001.ulg */
-			snprintf(log_file_name, sizeof(LogFileName::log_file_name), "log%03u%s.ulg", file_number, replay_suffix);
+			snprintf(log_file_name, sizeof(LogFileName::log_file_name), "log%03u%s.%s", file_number, replay_suffix,
+				 extension);
 			snprintf(file_name + n, file_name_size - n, "/%s", log_file_name);
 
 			if (!util::file_exist(file_name)) {
@@ -1454,6 +1897,25 @@ int Logger::get_log_file_name(LogType type, char *file_name, size_t file_name_si
 	return 0;
 }
 
+size_t Logger::compression_block_size(LogType type) const
+{
+	int32_t compress = 0;
+	int32_t block_size_kb = 0;
+
+	if (type != LogType::Full || _compress == PARAM_INVALID || _compress_block_size == PARAM_INVALID) {
+		return 0;
+	}
+
+	param_get(_compress, &compress);
+	param_get(_compress_block_size, &block_size_kb);
+
+	if (compress == 0) {
+		return 0;
+	}
+
+	return math::constrain(block_size_kb, (int32_t)4, (int32_t)60) * 1024;
+}
+
 void Logger::setReplayFile(const char *file_name)
 {
 	if (_replay_file_name) {
@@ -1483,7 +1945,7 @@ void Logger::start_log_file(LogType type)
 		mavlink_log_info(&_mavlink_log_pub, "[logger] file: %s", file_name);
 	}
 
-	_writer.start_log_file(type, file_name);
+	_writer.start_log_file(type, file_name, compression_block_size(type));
 	_writer.select_write_backend(LogWriter::BackendFile);
 	_writer.set_need_reliable_transfer(true);
 	write_header(type);
@@ -1494,6 +1956,9 @@ void Logger::start_log_file(LogType type)
 		write_parameters(type);
 		write_perf_data(true);
 		write_console_output();
+
+	} else if (type == LogType::Secondary) {
+		write_parameters(type);
 	}
 
 	write_all_add_logged_msg(type);
@@ -1533,18 +1998,23 @@ void Logger::start_log_mavlink()
 		return;
 	}
 
-	PX4_INFO("Start mavlink log");
+	const LogType type = _writer.mavlink_log_type();
+	PX4_INFO("Start mavlink log (type: %s)", log_type_str(type));
 
 	_writer.start_log_mavlink();
 	_writer.select_write_backend(LogWriter::BackendMavlink);
 	_writer.set_need_reliable_transfer(true);
-	write_header(LogType::Full);
-	write_version(LogType::Full);
-	write_formats(LogType::Full);
-	write_parameters(LogType::Full);
-	write_perf_data(true);
-	write_console_output();
-	write_all_add_logged_msg(LogType::Full);
+	write_header(type);
+	write_version(type);
+	write_formats(type);
+	write_parameters(type);
+
+	if (type == LogType::Full) {
+		write_perf_data(true);
+		write_console_output();
+	}
+
+	write_all_add_logged_msg(type);
 	_writer.set_need_reliable_transfer(false);
 	_writer.unselect_write_backend();
 	_writer.notify();
@@ -1797,15 +2267,10 @@ void Logger::write_formats(LogType type)
 	WrittenFormats written_formats;
 
 	// write all subscribed formats
-	size_t sub_count = _subscriptions.size();
-
-	if (type == LogType::Mission) {
-		sub_count = _num_mission_subs;
-	}
-
-	for (size_t i = 0; i < sub_count; ++i) {
-		const LoggerSubscription &sub = _subscriptions[i];
-		write_format(type, *sub.get_topic(), written_formats, msg);
+	for (int i = 0; i < (int)_subscriptions.size(); ++i) {
+		if (is_logged(type, i)) {
+			write_format(type, *_subscriptions[i].get_topic(), written_formats, msg);
+		}
 	}
 
 	_writer.unlock();
@@ -1815,18 +2280,24 @@ void Logger::write_all_add_logged_msg(LogType type)
 {
 	_writer.lock();
 
-	size_t sub_count = _subscriptions.size();
-
-	if (type == LogType::Mission) {
-		sub_count = _num_mission_subs;
-	}
+	for (int i = 0; i < (int)_subscriptions.size(); ++i) {
+		if (!is_logged(type, i)) {
+			continue;
+		}
 
-	for (size_t i = 0; i < sub_count; ++i) {
 		LoggerSubscription &sub = _subscriptions[i];
 
 		if (sub.valid()) {
 			write_add_logged_msg(type, sub);
 		}
+
+		if (type == LogType::Secondary) {
+			sub.secondary_next_write = 0;
+
+		} else {
+			// a new log starts: samples published before are not counted as lost
+			sub.last_timestamp = 0;
+		}
 	}
 
 	_writer.unlock();
@@ -2056,6 +2527,9 @@ void Logger::write_version(LogType type)
 
 	if (type == LogType::Mission) {
 		write_info(type, "log_type", "mission");
+
+	} else if (type == LogType::Secondary) {
+		write_info(type, "log_type", "secondary");
 	}
 }
 
@@ -2231,19 +2705,24 @@ It supports 2 backends:
 
 Both backends can be enabled and used at the same time.
 
-The file backend supports 2 types of log files: full (the normal log) and a mission
-log. The mission log is a reduced ulog file and can be used for example for geotagging or
+The file backend supports 3 types of log files: full (the normal log), a mission
+log and a secondary log. The mission log is a reduced ulog file and can be used for example for geotagging or
 vehicle management. It can be enabled and configured via SDLOG_MISSION parameter.
-The normal log is always a superset of the mission log.
+The secondary log contains the topics of the logging profiles selected with SDLOG_PROF_SEC, limited to
+the rate set with SDLOG_SEC_INT, and is written to a separate directory. Instead of the full log, it can
+also be streamed via MAVLink (SDLOG_MAV_SEC).
+The normal log is always a superset of the mission and the secondary log. All logs share the same
+topic subscriptions, so each topic is only copied once per update.
 
 ### Implementation
 The implementation uses two threads:
 - The main thread, running at a fixed rate (or polling on a topic if started with -p) and checking for
-  data updates
+  data updates. In event-driven mode (-u), the topics notify the logger on updates, so that only the
+  updated topics are checked, and topics without rate limit wake up the logger on every sample.
 - The writer thread, writing data to the file
 
-In between there is a write buffer with configurable size (and another fixed-size buffer for
-the mission log). It should be large to avoid dropouts.
+In between there is a write buffer with configurable size (and smaller buffers for
+the mission and secondary logs). It should be large to avoid dropouts.
 
 ### Examples
 Typical usage to start logging immediately:
@@ -2264,6 +2743,8 @@ $ logger on
 	PRINT_MODULE_USAGE_PARAM_INT('b', 12, 4, 10000, "Log buffer size in KiB", true);
 	PRINT_MODULE_USAGE_PARAM_STRING('p', nullptr, "<topic_name>",
 					 "Poll on a topic instead of running with fixed rate (Log rate and topic intervals are ignored if this is set)", true);
+	PRINT_MODULE_USAGE_PARAM_FLAG('u',
+				      "Event-driven: only handle updated topics, and log every sample of topics without rate limit", true);
 	PRINT_MODULE_USAGE_COMMAND_DESCR("on", "start logging now, override arming (logger must be running)");
 	PRINT_MODULE_USAGE_COMMAND_DESCR("off", "stop logging now, override arming (logger must be running)");
 	PRINT_MODULE_USAGE_DEFAULT_COMMANDS();
@@ -37,7 +37,9 @@
 #include "messages.h"
 #include <containers/Array.hpp>
 #include "util.h"
+#include <px4_platform_common/atomic.h>
 #include <px4_platform_common/defines.h>
+#include <px4_platform_common/sem.h>
 #include <drivers/drv_hrt.h>
 #include <version/version.h>
 #include <parameters/param.h>
@@ -45,6 +47,7 @@
 #include <px4_platform_common/module.h>
 
 #include <uORB/Subscription.hpp>
+#include <uORB/SubscriptionCallback.hpp>
 #include <uORB/SubscriptionInterval.hpp>
 #include <uORB/topics/log_message.h>
 #include <uORB/topics/manual_control_setpoint.h>
@@ -85,15 +88,121 @@ inline bool operator&(SDLogProfileMask a, SDLogProfileMask b)
 
 static constexpr uint8_t MSG_ID_INVALID = UINT8_MAX;
 
-struct LoggerSubscription : public uORB::SubscriptionInterval {
+/**
+ * Collects the update notifications of the logged topics (event-driven mode), so that the logger
+ * only needs to look at the topics that changed.
+ * notify() is called from the publisher's context (with the topic locked, possibly from an ISR on NuttX).
+ */
+class TopicUpdateNotifier
+{
+public:
+	static constexpr int MAX_TOPICS = 128;
+	static constexpr int WORDS = MAX_TOPICS / 32;
+
+	/**
+	 * @param semaphore posted to wake up the logger
+	 */
+	void set_semaphore(px4_sem_t *semaphore) { _semaphore = semaphore; }
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	/**
+	 * @param wakeups incremented for every post of the semaphore
+	 */
+	void set_wakeup_counter(px4::atomic<int> *wakeups) { _wakeups = wakeups; }
+#endif
+
+	/**
+	 * Mark a topic as updated.
+	 * @param index subscription index
+	 * @param wake_up wake up the logger (otherwise the topic is handled on the next logger iteration)
+	 */
+	void notify(int index, bool wake_up)
+	{
+		_updated[index / 32].fetch_or(1u << (index % 32));
+
+		// post at most once per logger iteration
+		if (wake_up && (_semaphore != nullptr) && !_wakeup_pending.exchange(true)) {
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+
+			if (_wakeups != nullptr) {
+				_wakeups->fetch_add(1);
+			}
+
+#endif
+			px4_sem_post(_semaphore);
+		}
+	}
+
+	/**
+	 * Get and clear all pending updates. Call this after the logger woke up.
+	 */
+	void take(uint32_t updated[WORDS])
+	{
+		_wakeup_pending.store(false);
+
+		for (int i = 0; i < WORDS; i++) {
+			updated[i] = _updated[i].exchange(0);
+		}
+	}
+
+private:
+	px4::atomic<uint32_t> _updated[WORDS] {};
+	px4::atomic_bool _wakeup_pending{false};
+	px4_sem_t *_semaphore{nullptr};
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	px4::atomic<int> *_wakeups {nullptr};
+#endif
+};
+
+struct LoggerSubscription : public uORB::SubscriptionCallback {
 
 	uint8_t msg_id{MSG_ID_INVALID};
 
+	uint8_t batch_queue_size{0};	///< >0: log every sample (queue size of the topic), 0: latest sample only
+	uint32_t lost_samples{0};	///< number of samples lost in batch mode
+	uint64_t last_timestamp{0};	///< timestamp of the last logged sample (batch mode)
+
+	bool secondary{false};			///< also logged to the secondary log
+	uint16_t secondary_interval_ms{0};	///< minimum time between 2 writes to the secondary log [ms]
+	hrt_abstime secondary_next_write{0};	///< next time to write to the secondary log
+
 	LoggerSubscription() = default;
 
 	LoggerSubscription(const orb_metadata *meta, uint32_t interval_ms = 0, uint8_t instance = 0) :
-		uORB::SubscriptionInterval(meta, interval_ms * 1000, instance)
-	{}
+		uORB::SubscriptionCallback(meta, 0, instance)
+	{
+		set_interval_ms(interval_ms);
+	}
+
+	/**
+	 * Get update notifications (event-driven mode). Topics without rate limit wake up the logger
+	 * on every update, so that no sample is missed.
+	 * The subscription must be valid.
+	 */
+	bool register_update_notifier(TopicUpdateNotifier *notifier, int index)
+	{
+		_notifier = notifier;
+		_index = index;
+		return registerCallback();
+	}
+
+	/**
+	 * Check for an update, ignoring the interval
+	 */
+	bool updated_ignore_interval() { return _subscription.updated(); }
+
+	unsigned last_generation() const { return _subscription.get_last_generation(); }
+
+	void call() override
+	{
+		if (_notifier != nullptr) {
+			_notifier->notify(_index, _interval_us == 0);
+		}
+	}
+
+private:
+	TopicUpdateNotifier *_notifier{nullptr};
+	uint8_t _index{0};
 };
 
 class Logger : public ModuleBase<Logger>
@@ -107,7 +216,7 @@ public:
 	};
 
 	Logger(LogWriter::Backend backend, size_t buffer_size, uint32_t log_interval, const char *poll_topic_name,
-	       LogMode log_mode, bool log_name_timestamp);
+	       LogMode log_mode, bool log_name_timestamp, bool event_driven);
 
 	~Logger();
 
@@ -147,6 +256,18 @@ public:
 	bool add_topic(const char *name, uint32_t interval_ms = 0, uint8_t instance = 0);
 	bool add_topic_multi(const char *name, uint32_t interval_ms = 0);
 
+	/**
+	 * Add a topic to be logged without losing samples (batch mode): the queue of the topic is enlarged,
+	 * and all samples published since the last logger iteration are written. Lost samples (queue overflow)
+	 * are written as dropout messages.
+	 * The queue can also be enlarged after the topic was published (the queued samples are kept), but never shrunk.
+	 * @param name topic name
+	 * @param queue_size requested queue size (>1)
+	 * @param instance orb topic instance
+	 * @return true on success
+	 */
+	bool add_batch_topic(const char *name, uint8_t queue_size, uint8_t instance = 0);
+
 	/**
 	 * add a logged topic (called by add_topic() above).
 	 * In addition, it subscribes to the first instance of the topic, if it's advertised,
@@ -173,11 +294,14 @@ private:
 	};
 
 	static constexpr size_t 	MAX_TOPICS_NUM = 90; /**< Maximum number of logged topics */
+	static_assert(MAX_TOPICS_NUM <= TopicUpdateNotifier::MAX_TOPICS, "TopicUpdateNotifier too small");
 	static constexpr int		MAX_MISSION_TOPICS_NUM = 5; /**< Maximum number of mission topics */
+	static constexpr int		MAX_QUEUED_UPDATES = 16; /**< Maximum number of samples written per topic and iteration (event-driven) */
 	static constexpr unsigned	MAX_NO_LOGFILE = 999;	/**< Maximum number of log files */
 	static constexpr const char	*LOG_ROOT[(int)LogType::Count] = {
 		PX4_STORAGEDIR "/log",
-		PX4_STORAGEDIR "/mission_log"
+		PX4_STORAGEDIR "/mission_log",
+		PX4_STORAGEDIR "/log_secondary"
 	};
 
 	struct LogFileName {
@@ -228,6 +352,11 @@ private:
 
 	void start_log_file(LogType type);
 
+	/**
+	 * @return compression block size for a new file log (0 if not compressed)
+	 */
+	size_t compression_block_size(LogType type) const;
+
 	void stop_log_file(LogType type);
 
 	void start_log_mavlink();
@@ -237,7 +366,7 @@ private:
 	/** check if mavlink logging can be started */
 	bool can_start_mavlink_log() const
 	{
-		return !_writer.is_started(LogType::Full, LogWriter::BackendMavlink)
+		return !_writer.is_started(_writer.mavlink_log_type(), LogWriter::BackendMavlink)
 		       && (_writer.backend() & LogWriter::BackendMavlink) != 0;
 	}
 
@@ -294,6 +423,43 @@ private:
 
 	inline bool copy_if_updated(int sub_idx, void *buffer, bool try_to_subscribe);
 
+	/**
+	 * Check if a subscription is part of a log type (the full log contains all of them)
+	 */
+	bool is_logged(LogType type, int sub_idx) const;
+
+	/**
+	 * Copy a subscription if updated and write it to the full (and mission) log.
+	 * If possible, the data is copied directly into the log buffer.
+	 * Must be called without holding _writer.lock() (it is taken only to write the messages).
+	 * @return number of bytes written to the full log (0 if not updated)
+	 */
+	size_t write_subscription(int sub_idx, bool try_to_subscribe, hrt_abstime loop_time);
+
+	/**
+	 * Enable update notifications for a subscription (event-driven mode), if it is valid.
+	 */
+	void register_update_notifier(int sub_idx);
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	/**
+	 * Lockstep component callback (see px4_lockstep_register_component()): true if the logger is blocked
+	 * waiting for the next iteration and nothing woke it up yet.
+	 */
+	static bool lockstep_idle(void *arg);
+#endif
+
+	/**
+	 * Enlarge the queues of the batch topics (creating the topics if necessary)
+	 */
+	void initialize_batch_queues();
+
+	/**
+	 * Write a dropout message for samples lost in batch mode.
+	 * Must be called with _writer.lock() held.
+	 */
+	void write_batch_dropout(LoggerSubscription &sub, uint32_t lost_samples, uint64_t timestamp);
+
 	/**
 	 * Write exactly one ulog message to the logger and handle dropouts.
 	 * Must be called with _writer.lock() held.
@@ -327,6 +493,17 @@ private:
 	 */
 	void initialize_configured_topics();
 
+	/**
+	 * Add the topics of all the profiles set in a mask
+	 */
+	void add_profile_topics(SDLogProfileMask sdlog_profile);
+
+	/**
+	 * Select the topics of the secondary log based on the SDLOG_PROF_SEC parameter (these are added to the
+	 * full log as well if not part of it yet). Must be called after all other topics are added.
+	 */
+	void initialize_secondary_topics();
+
 	void add_default_topics();
 	void add_estimator_replay_topics();
 	void add_thermal_calibration_topics();
@@ -380,10 +557,22 @@ private:
 
 	LogMode						_log_mode;
 	const bool					_log_name_timestamp;
+	bool						_event_driven; ///< only handle updated topics (instead of checking all)
+
+	TopicUpdateNotifier				_update_notifier; ///< (must outlive _subscriptions)
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	int						_lockstep_component{-1};
+	px4::atomic<int>				_lockstep_wakeups{0}; ///< semaphore posts not handled yet
+	px4::atomic_bool				_lockstep_polling{false}; ///< blocked in poll() on the polling topic
+	int						_lockstep_polling_sub{-1};
+#endif
 	Array<LoggerSubscription, MAX_TOPICS_NUM>	_subscriptions; ///< all subscriptions for full & mission log (in front)
 	MissionSubscription 				_mission_subscriptions[MAX_MISSION_TOPICS_NUM] {}; ///< additional data for mission subscriptions
 	int						_num_mission_subs{0};
+	int						_num_secondary_subs{0};
+	bool						_adding_secondary_topics{false}; ///< add_topic() selects topics for the secondary log
+	uint16_t					_secondary_min_interval_ms{0};
 
 	LogWriter					_writer;
 	uint32_t					_log_interval{0};
@@ -406,6 +595,12 @@ private:
 	param_t						_log_utc_offset{PARAM_INVALID};
 	param_t						_log_dirs_max{PARAM_INVALID};
 	param_t						_mission_log{PARAM_INVALID};
+	param_t						_compress{PARAM_INVALID};
+	param_t						_compress_block_size{PARAM_INVALID};
+	param_t						_secondary_profile{PARAM_INVALID};
+	param_t						_secondary_interval{PARAM_INVALID};
+	param_t						_mavlink_secondary{PARAM_INVALID};
+	param_t						_mavlink_ack_window{PARAM_INVALID};
 };
 
 } //namespace logger
@@ -154,3 +154,101 @@ PARAM_DEFINE_INT32(SDLOG_DIRS_MAX, 0);
  * @group SD Logging
  */
 PARAM_DEFINE_INT32(SDLOG_UUID, 1);
+
+/**
+ * Log file compression
+ *
+ * If enabled, the full log is written as compressed ULog file (.ulgz), using
+ * independently compressed blocks (LZ4 block format). This reduces the file size
+ * and I/O load at the cost of CPU time on the log writer thread.
+ *
+ * Compressed files can be read by the replay module, and converted to
+ * ULog files with Tools/ulog_decompress.py.
+ *
+ * The mission log is not compressed.
+ *
+ * @value 0 Disabled
+ * @value 1 LZ4 blocks
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_COMPRESS, 0);
+
+/**
+ * Log file compression block size
+ *
+ * Larger blocks compress better, but more data is lost on a crash
+ * (at most the data since the last fsync, about 1 second, is lost in either case).
+ *
+ * @unit KB
+ * @min 4
+ * @max 60
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_CMP_BLOCK, 32);
+
+/**
+ * Secondary log profile
+ *
+ * Selects the topics of the secondary log, which is written in addition to the full log
+ * (to PX4_STORAGEDIR/log_secondary) and uses the same topic sets as SDLOG_PROFILE.
+ * Topics that are not part of the full log yet are added to it as well.
+ * All logs share the same subscriptions, so this adds little CPU load.
+ *
+ * 0 disables the secondary log.
+ *
+ * @min 0
+ * @max 255
+ * @bit 0 Default set (general log analysis)
+ * @bit 1 Estimator replay (EKF2)
+ * @bit 2 Thermal calibration
+ * @bit 3 System identification
+ * @bit 4 High rate
+ * @bit 5 Debug
+ * @bit 6 Sensor comparison
+ * @bit 7 Computer Vision and Avoidance
+ * @reboot_required true
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_PROF_SEC, 0);
+
+/**
+ * Secondary log minimum interval
+ *
+ * Minimum time between two samples of a topic in the secondary log. Topics with
+ * a larger interval in their profile use that one.
+ *
+ * @unit ms
+ * @min 0
+ * @max 10000
+ * @reboot_required true
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_SEC_INT, 100);
+
+/**
+ * Stream the secondary log via MAVLink
+ *
+ * If enabled (and the secondary log is configured), MAVLink log streaming sends
+ * the secondary log instead of the full log.
+ *
+ * @boolean
+ * @reboot_required true
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_MAV_SEC, 0);
+
+/**
+ * MAVLink log streaming ack window
+ *
+ * Maximum number of acked ULog streaming messages (used for the log header) in flight.
+ * With 1, each message is acked before the next is sent, which limits the header
+ * transfer to one message per round-trip. Larger values increase the throughput on
+ * high-latency links; unacked messages are retransmitted selectively.
+ * The receiver must be able to handle out-of-order retransmissions.
+ *
+ * @min 1
+ * @max 8
+ * @reboot_required true
+ * @group SD Logging
+ */
+PARAM_DEFINE_INT32(SDLOG_MAV_WIN, 1);
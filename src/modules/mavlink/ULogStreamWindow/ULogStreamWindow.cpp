@@ -0,0 +1,121 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "ULogStreamWindow.hpp"
+
+int ULogStreamWindow::push(uint16_t sequence, uint64_t now_us)
+{
+	if (full()) {
+		return -1;
+	}
+
+	const int slot = (_head + _count) % MAX_SIZE;
+	_slots[slot].sequence = sequence;
+	_slots[slot].last_sent = now_us;
+	_slots[slot].tries = 1;
+	_slots[slot].acked = false;
+	++_count;
+	return slot;
+}
+
+bool ULogStreamWindow::ack(uint16_t sequence, uint64_t now_us)
+{
+	for (int i = 0; i < _count; ++i) {
+		Slot &slot = _slots[(_head + i) % MAX_SIZE];
+
+		if (slot.sequence == sequence && !slot.acked) {
+			slot.acked = true;
+
+			// only use messages sent once, otherwise we don't know which transmission got acked
+			if (slot.tries == 1 && now_us >= slot.last_sent) {
+				const uint64_t sample = now_us - slot.last_sent;
+				_rtt_us = (_rtt_us == 0) ? sample : (7 * _rtt_us + sample) / 8;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ULogStreamWindow::release(uint16_t &last_sequence)
+{
+	bool released = false;
+
+	while (_count > 0 && _slots[_head].acked) {
+		last_sequence = _slots[_head].sequence;
+		_head = (_head + 1) % MAX_SIZE;
+		--_count;
+		released = true;
+	}
+
+	return released;
+}
+
+int ULogStreamWindow::next_retransmit(uint64_t now_us, uint64_t min_timeout_us)
+{
+	const uint64_t timeout_us = (2 * _rtt_us > min_timeout_us) ? 2 * _rtt_us : min_timeout_us;
+
+	for (int i = 0; i < _count; ++i) {
+		const int index = (_head + i) % MAX_SIZE;
+		Slot &slot = _slots[index];
+
+		if (!slot.acked && now_us - slot.last_sent > timeout_us) {
+			slot.last_sent = now_us;
+
+			if (slot.tries < UINT8_MAX) {
+				++slot.tries;
+			}
+
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+uint8_t ULogStreamWindow::max_tries() const
+{
+	uint8_t tries = 0;
+
+	for (int i = 0; i < _count; ++i) {
+		const Slot &slot = _slots[(_head + i) % MAX_SIZE];
+
+		if (!slot.acked && slot.tries > tries) {
+			tries = slot.tries;
+		}
+	}
+
+	return tries;
+}
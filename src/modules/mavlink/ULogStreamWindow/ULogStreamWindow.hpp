@@ -0,0 +1,110 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ULogStreamWindow.hpp
+ *
+ * Sender-side bookkeeping of the acked ULog streaming messages (LOGGING_DATA_ACKED) for a
+ * sliding window protocol: up to MAX_SIZE messages can be in flight, each one is acked
+ * individually by the receiver and only the unacked ones are retransmitted after a timeout.
+ * The timeout adapts to the measured round-trip time, so that high-latency links do not cause
+ * spurious retransmissions.
+ * The message data itself is stored by the user, indexed by the slot returned from push().
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class ULogStreamWindow
+{
+public:
+	static constexpr int MAX_SIZE = 8;
+
+	ULogStreamWindow() = default;
+	~ULogStreamWindow() = default;
+
+	void reset() { _head = 0; _count = 0; _rtt_us = 0; }
+
+	/**
+	 * Add a (sent) message
+	 * @param now_us current time [us]
+	 * @return slot index in [0, MAX_SIZE) to store the message data, or -1 if full
+	 */
+	int push(uint16_t sequence, uint64_t now_us);
+
+	/**
+	 * Mark a message as acked (in any order)
+	 * @param now_us current time [us] (to measure the round-trip time)
+	 * @return true if the message was pending
+	 */
+	bool ack(uint16_t sequence, uint64_t now_us);
+
+	/**
+	 * Remove the acked messages at the front of the window (the ones that are acked in order)
+	 * @param last_sequence set to the sequence of the last removed message
+	 * @return true if at least one message was removed
+	 */
+	bool release(uint16_t &last_sequence);
+
+	/**
+	 * Get the next message that needs to be retransmitted because it was not acked within the timeout.
+	 * Call repeatedly until it returns -1. Each call counts as a transmission.
+	 * @param min_timeout_us minimum ack timeout, it is increased to twice the round-trip time if larger
+	 * @return slot index or -1
+	 */
+	int next_retransmit(uint64_t now_us, uint64_t min_timeout_us);
+
+	/** smoothed round-trip time [us], 0 if not measured yet */
+	uint64_t rtt() const { return _rtt_us; }
+
+	/** maximum number of transmissions of any pending message */
+	uint8_t max_tries() const;
+
+	int size() const { return _count; }
+	bool empty() const { return _count == 0; }
+	bool full() const { return _count == MAX_SIZE; }
+
+private:
+	struct Slot {
+		uint64_t last_sent{0};
+		uint16_t sequence{0};
+		uint8_t tries{0};
+		bool acked{false};
+	};
+
+	Slot _slots[MAX_SIZE] {};
+	int _head{0}; ///< slot index of the oldest pending message
+	int _count{0};
+	uint64_t _rtt_us{0};
+};
@@ -0,0 +1,227 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file ULogStreamWindowTest.cpp
+ *
+ * Tests the sliding window bookkeeping, and measures the throughput of a loopback link
+ * with packet loss for different window sizes and round-trip times.
+ */
+
+#include <gtest/gtest.h>
+#include <ULogStreamWindow.hpp>
+
+#include <stdio.h>
+#include <vector>
+
+TEST(ULogStreamWindowTest, InOrderAck)
+{
+	ULogStreamWindow window;
+	uint16_t last = 0;
+
+	for (int i = 0; i < ULogStreamWindow::MAX_SIZE; ++i) {
+		EXPECT_GE(window.push(i, 0), 0);
+	}
+
+	EXPECT_TRUE(window.full());
+	EXPECT_EQ(window.push(100, 0), -1);
+
+	EXPECT_TRUE(window.ack(0, 1000));
+	EXPECT_FALSE(window.ack(0, 1000)); // duplicate
+	EXPECT_TRUE(window.release(last));
+	EXPECT_EQ(last, 0);
+	EXPECT_EQ(window.size(), ULogStreamWindow::MAX_SIZE - 1);
+	EXPECT_EQ(window.rtt(), 1000u);
+}
+
+TEST(ULogStreamWindowTest, SelectiveAck)
+{
+	ULogStreamWindow window;
+	uint16_t last = 0;
+
+	// sequence wraps around
+	for (uint16_t seq = 65534; seq != 2; ++seq) {
+		EXPECT_GE(window.push(seq, 0), 0);
+	}
+
+	EXPECT_TRUE(window.ack(65535, 10));
+	EXPECT_TRUE(window.ack(1, 10));
+
+	// the first one is missing: nothing can be released
+	EXPECT_FALSE(window.release(last));
+
+	// only the first and the third message are retransmitted
+	const int first = window.next_retransmit(100000, 50000);
+	const int third = window.next_retransmit(100000, 50000);
+	EXPECT_GE(first, 0);
+	EXPECT_GE(third, 0);
+	EXPECT_EQ(window.next_retransmit(100000, 50000), -1);
+	EXPECT_EQ(window.max_tries(), 2);
+
+	EXPECT_TRUE(window.ack(65534, 100010));
+	EXPECT_TRUE(window.release(last));
+	EXPECT_EQ(last, 65535);
+	EXPECT_EQ(window.size(), 2);
+
+	EXPECT_TRUE(window.ack(0, 100020));
+	EXPECT_TRUE(window.release(last));
+	EXPECT_EQ(last, 1);
+	EXPECT_TRUE(window.empty());
+}
+
+/**
+ * Simulates the acked transfer of num_messages over a link with a fixed bandwidth and round-trip time,
+ * dropping every drop_every'th message and ack.
+ * @return achieved payload throughput [B/s] (0 if not all messages got received)
+ */
+static double simulate_link(int window_size, uint64_t rtt_us, int num_messages, int drop_every)
+{
+	static constexpr int payload = 249; // ulog_stream_s::data
+	static constexpr uint64_t tx_interval_us = 2000; // link bandwidth: 1 message per 2 ms (~128 KB/s)
+	static constexpr uint64_t ack_timeout_us = 50000; // ulog_stream_ack_s::ACK_TIMEOUT
+	static constexpr uint64_t dt_us = 100;
+
+	struct InFlight {
+		uint64_t arrival;
+		uint16_t sequence;
+	};
+
+	ULogStreamWindow window;
+	uint16_t slot_sequence[ULogStreamWindow::MAX_SIZE];
+	std::vector<InFlight> data_link, ack_link;
+	std::vector<bool> received(num_messages, false);
+	int next_sequence = 0;
+	int transmissions = 0;
+	int acks_sent = 0;
+	uint64_t link_free = 0;
+	uint64_t now = 0;
+
+	auto transmit = [&](uint16_t sequence) {
+		link_free = now + tx_interval_us;
+
+		if (++transmissions % drop_every != 0) {
+			data_link.push_back({now + rtt_us / 2, sequence});
+		}
+	};
+
+	while (now < 600000000) {
+		// receiver: ack every received message
+		for (auto it = data_link.begin(); it != data_link.end();) {
+			if (it->arrival <= now) {
+				received[it->sequence] = true;
+
+				if (++acks_sent % drop_every != 0) {
+					ack_link.push_back({now + rtt_us / 2, it->sequence});
+				}
+
+				it = data_link.erase(it);
+
+			} else {
+				++it;
+			}
+		}
+
+		// sender: handle acks
+		for (auto it = ack_link.begin(); it != ack_link.end();) {
+			if (it->arrival <= now) {
+				window.ack(it->sequence, now);
+				it = ack_link.erase(it);
+
+			} else {
+				++it;
+			}
+		}
+
+		uint16_t last;
+		window.release(last);
+
+		if (next_sequence == num_messages && window.empty()) {
+			break;
+		}
+
+		if (now >= link_free) {
+			// retransmissions first, then new data if the window allows it
+			const int slot = window.next_retransmit(now, ack_timeout_us);
+
+			if (slot >= 0) {
+				transmit(slot_sequence[slot]);
+
+			} else if (next_sequence < num_messages && window.size() < window_size) {
+				slot_sequence[window.push(next_sequence, now)] = next_sequence;
+				transmit(next_sequence++);
+			}
+		}
+
+		now += dt_us;
+	}
+
+	for (bool r : received) {
+		if (!r) {
+			return 0.;
+		}
+	}
+
+	return (double)num_messages * payload / (now * 1e-6);
+}
+
+TEST(ULogStreamWindowTest, LoopbackThroughput)
+{
+	const uint64_t rtts_us[] = {10000, 100000, 500000};
+	const int window_sizes[] = {1, 2, 4, ULogStreamWindow::MAX_SIZE};
+	const int num_messages = 400; // about the size of a log header
+	const int drop_every = 25; // 4% loss in both directions
+
+	for (uint64_t rtt_us : rtts_us) {
+		double throughput_window_1 = 0.;
+
+		for (int window_size : window_sizes) {
+			const double throughput = simulate_link(window_size, rtt_us, num_messages, drop_every);
+			printf("RTT: %4i ms, window: %i: %8.0f B/s\n", (int)(rtt_us / 1000), window_size, throughput);
+
+			// every message must arrive
+			EXPECT_GT(throughput, 0.);
+
+			if (window_size == 1) {
+				throughput_window_1 = throughput;
+
+			} else {
+				EXPECT_GT(throughput, throughput_window_1);
+			}
+		}
+
+		// throughput scales with the window size on high-latency links
+		if (rtt_us >= 100000) {
+			EXPECT_GT(simulate_link(ULogStreamWindow::MAX_SIZE, rtt_us, num_messages, drop_every), 4. * throughput_window_1);
+		}
+	}
+}
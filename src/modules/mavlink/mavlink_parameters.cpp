@@ -50,6 +50,11 @@ MavlinkParametersManager::MavlinkParametersManager(Mavlink *mavlink) :
 {
 }
 
+MavlinkParametersManager::~MavlinkParametersManager()
+{
+	end_param_batch(hrt_absolute_time(), true);
+}
+
 unsigned
 MavlinkParametersManager::get_size()
 {
@@ -131,6 +136,7 @@ MavlinkParametersManager::handle_message(const mavlink_message_t *msg)
 
 				} else {
 					// According to the mavlink spec we should always acknowledge a write operation.
+					batch_param_set(hrt_absolute_time());
 					param_set(param, &(set.param_value));
 					send_param(param);
 				}
@@ -290,6 +296,34 @@ MavlinkParametersManager::send(const hrt_abstime t)
 
 	// Send while burst is not exceeded, we still have buffer space and still something to send
 	while ((i++ < max_num_to_send) && (_mavlink->get_free_tx_buf() >= get_size()) && send_params()) {}
+
+	end_param_batch(t, false);
+}
+
+void
+MavlinkParametersManager::batch_param_set(const hrt_abstime t)
+{
+	if (_param_batch_start == 0) {
+		param_batch_begin();
+		_param_batch_start = t;
+	}
+
+	_param_batch_last_set = t;
+}
+
+void
+MavlinkParametersManager::end_param_batch(const hrt_abstime t, bool force)
+{
+	if (_param_batch_start == 0) {
+		return;
+	}
+
+	if (force || (t > _param_batch_last_set + PARAM_BATCH_IDLE_TIMEOUT)
+	    || (t > _param_batch_start + PARAM_BATCH_MAX_DURATION)) {
+
+		param_batch_commit();
+		_param_batch_start = 0;
+	}
 }
 
 bool
@@ -319,10 +353,23 @@ MavlinkParametersManager::send_untransmitted()
 		parameter_update_s value;
 		_mavlink_parameter_sub.update(&value);
 
-		// Schedule an update if not already the case
+		// only the range of the changed parameters needs to be checked, if known and no update was missed
+		// (the topic is not queued, so a missed update would leave its range unchecked)
+		const bool range_known = (value.changed > 0) && (value.instance == _param_update_instance + 1);
+		_param_update_instance = value.instance;
+
+		const int update_index = range_known ? value.changed_index_min : 0;
+		const int update_end = range_known ? value.changed_index_max + 1 : (int) param_count();
+
+		// Schedule an update if not already the case, otherwise extend it
 		if (_param_update_time == 0) {
 			_param_update_time = value.timestamp;
-			_param_update_index = 0;
+			_param_update_index = update_index;
+			_param_update_end = update_end;
+
+		} else {
+			_param_update_index = (update_index < _param_update_index) ? update_index : _param_update_index;
+			_param_update_end = (update_end > _param_update_end) ? update_end : _param_update_end;
 		}
 	}
 
@@ -350,10 +397,10 @@ MavlinkParametersManager::send_untransmitted()
 					break;
 				}
 			}
-		} while ((_mavlink->get_free_tx_buf() >= get_size()) && (_param_update_index < (int) param_count()));
+		} while ((_mavlink->get_free_tx_buf() >= get_size()) && (_param_update_index < _param_update_end));
 
 		// Flag work as done once all params have been sent
-		if (_param_update_index >= (int) param_count()) {
+		if (_param_update_index >= _param_update_end) {
 			_param_update_time = 0;
 		}
 	}
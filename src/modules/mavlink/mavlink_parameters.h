@@ -54,13 +54,15 @@
 #include <uORB/topics/parameter_update.h>
 #include <drivers/drv_hrt.h>
 
+using namespace time_literals;
+
 class Mavlink;
 
 class MavlinkParametersManager
 {
 public:
 	explicit MavlinkParametersManager(Mavlink *mavlink);
-	~MavlinkParametersManager() = default;
+	~MavlinkParametersManager();
 
 	/**
 	 * Handle sending of messages. Call this regularly at a fixed frequency.
@@ -101,6 +103,14 @@ protected:
 
 	int send_param(param_t param, int component_id = -1);
 
+	/**
+	 * Parameter sets are batched (@see param_batch_begin()), so that a parameter upload results in a single
+	 * parameter_update. The batch ends when no parameter was set for PARAM_BATCH_IDLE_TIMEOUT,
+	 * or at the latest after PARAM_BATCH_MAX_DURATION. It only defers the notifications of this (the receiver) thread.
+	 */
+	void batch_param_set(const hrt_abstime t);
+	void end_param_batch(const hrt_abstime t, bool force);
+
 	// Item of a single-linked list to store requested uavcan parameters
 	struct _uavcan_open_request_list_item {
 		uavcan_parameter_request_s req;
@@ -136,6 +146,13 @@ protected:
 	uORB::Subscription _mavlink_parameter_sub{ORB_ID(parameter_update)};
 	hrt_abstime _param_update_time{0};
 	int _param_update_index{0};
+	int _param_update_end{0};
+	uint32_t _param_update_instance{UINT32_MAX}; ///< instance of the last parameter_update (the first is 0)
+
+	static constexpr hrt_abstime PARAM_BATCH_IDLE_TIMEOUT = 100_ms;
+	static constexpr hrt_abstime PARAM_BATCH_MAX_DURATION = 500_ms;
+	hrt_abstime _param_batch_start{0}; ///< start of the current batch of parameter sets, 0 if none
+	hrt_abstime _param_batch_last_set{0}; ///< time of the last parameter set in the current batch
 
 	Mavlink *_mavlink;
 };
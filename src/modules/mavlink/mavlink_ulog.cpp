@@ -62,14 +62,13 @@ MavlinkULog::MavlinkULog(int datarate, float max_rate_factor, uint8_t target_sys
 	}
 
 	_waiting_for_initial_ack = true;
-	_last_sent_time = hrt_absolute_time(); //(ab)use this timestamp during initialization
-	_next_rate_check = _last_sent_time + _rate_calculation_delta_t * 1.e6f;
+	_start_time = hrt_absolute_time();
+	_next_rate_check = _start_time + _rate_calculation_delta_t * 1.e6f;
 }
 
 void MavlinkULog::start_ack_received()
 {
 	if (_waiting_for_initial_ack) {
-		_last_sent_time = 0;
 		_waiting_for_initial_ack = false;
 		PX4_DEBUG("got logger ack");
 	}
@@ -83,7 +82,7 @@ int MavlinkULog::handle_update(mavlink_channel_t channel)
 		      "Invalid uorb ulog_stream.data length");
 
 	if (_waiting_for_initial_ack) {
-		if (hrt_elapsed_time(&_last_sent_time) > 3e5) {
+		if (hrt_elapsed_time(&_start_time) > 3e5) {
 			PX4_WARN("no ack from logger (is it running?)");
 			return -1;
 		}
@@ -91,63 +90,37 @@ int MavlinkULog::handle_update(mavlink_channel_t channel)
 		return 0;
 	}
 
-	// check if we're waiting for an ACK
-	if (_last_sent_time) {
-		bool check_for_updates = false;
-
-		if (_ack_received) {
-			_last_sent_time = 0;
-			check_for_updates = true;
+	// re-send the messages that did not get acked in time (only those)
+	lock();
+	const hrt_abstime now = hrt_absolute_time();
+	int slot;
 
-		} else {
+	while ((slot = _window.next_retransmit(now, ulog_stream_ack_s::ACK_TIMEOUT * 1000)) >= 0) {
+		PX4_DEBUG("re-sending ulog mavlink message %i", _window_data[slot].msg_sequence);
+		send_acked(channel, _window_data[slot]);
+	}
 
-			if (hrt_elapsed_time(&_last_sent_time) > ulog_stream_ack_s::ACK_TIMEOUT * 1000) {
-				if (++_sent_tries > ulog_stream_ack_s::ACK_MAX_TRIES) {
-					return -ETIMEDOUT;
-
-				} else {
-					PX4_DEBUG("re-sending ulog mavlink message (try=%i)", _sent_tries);
-					_last_sent_time = hrt_absolute_time();
-
-					const ulog_stream_s &ulog_data = _ulog_stream_sub.get();
-
-					mavlink_logging_data_acked_t msg;
-					msg.sequence = ulog_data.msg_sequence;
-					msg.length = ulog_data.length;
-					msg.first_message_offset = ulog_data.first_message_offset;
-					msg.target_system = _target_system;
-					msg.target_component = _target_component;
-					memcpy(msg.data, ulog_data.data, sizeof(msg.data));
-					mavlink_msg_logging_data_acked_send_struct(channel, &msg);
-				}
-			}
-		}
+	const bool timed_out = _window.max_tries() > ulog_stream_ack_s::ACK_MAX_TRIES;
+	bool window_full = _window.full();
+	unlock();
 
-		if (!check_for_updates) {
-			return 0;
-		}
+	if (timed_out) {
+		return -ETIMEDOUT;
 	}
 
-	while ((_current_num_msgs < _max_num_messages) && _ulog_stream_sub.update()) {
+	// the logger does not exceed the window, but if it does, we leave the data in the queue
+	while ((_current_num_msgs < _max_num_messages) && !window_full && _ulog_stream_sub.update()) {
 		const ulog_stream_s &ulog_data = _ulog_stream_sub.get();
 
 		if (ulog_data.timestamp > 0) {
 			if (ulog_data.flags & ulog_stream_s::FLAGS_NEED_ACK) {
-				_sent_tries = 1;
-				_last_sent_time = hrt_absolute_time();
 				lock();
-				_wait_for_ack_sequence = ulog_data.msg_sequence;
-				_ack_received = false;
+				slot = _window.push(ulog_data.msg_sequence, hrt_absolute_time());
+				_window_data[slot] = ulog_data;
+				window_full = _window.full();
 				unlock();
 
-				mavlink_logging_data_acked_t msg;
-				msg.sequence = ulog_data.msg_sequence;
-				msg.length = ulog_data.length;
-				msg.first_message_offset = ulog_data.first_message_offset;
-				msg.target_system = _target_system;
-				msg.target_component = _target_component;
-				memcpy(msg.data, ulog_data.data, sizeof(msg.data));
-				mavlink_msg_logging_data_acked_send_struct(channel, &msg);
+				send_acked(channel, ulog_data);
 
 			} else {
 				mavlink_logging_data_t msg;
@@ -184,6 +157,18 @@ int MavlinkULog::handle_update(mavlink_channel_t channel)
 	return 0;
 }
 
+void MavlinkULog::send_acked(mavlink_channel_t channel, const ulog_stream_s &ulog_data)
+{
+	mavlink_logging_data_acked_t msg;
+	msg.sequence = ulog_data.msg_sequence;
+	msg.length = ulog_data.length;
+	msg.first_message_offset = ulog_data.first_message_offset;
+	msg.target_system = _target_system;
+	msg.target_component = _target_component;
+	memcpy(msg.data, ulog_data.data, sizeof(msg.data));
+	mavlink_msg_logging_data_acked_send_struct(channel, &msg);
+}
+
 void MavlinkULog::initialize()
 {
 	if (_init) {
@@ -235,9 +220,11 @@ void MavlinkULog::handle_ack(mavlink_logging_ack_t ack)
 	lock();
 
 	if (_instance) { // make sure stop() was not called right before
-		if (_wait_for_ack_sequence == ack.sequence) {
-			_ack_received = true;
-			publish_ack(ack.sequence);
+		uint16_t last_sequence;
+
+		if (_window.ack(ack.sequence, hrt_absolute_time()) && _window.release(last_sequence)) {
+			// the logger only needs to know up to where all messages are acked
+			publish_ack(last_sequence);
 		}
 	}
 
@@ -51,11 +51,17 @@
 #include <uORB/topics/ulog_stream.h>
 #include <uORB/topics/ulog_stream_ack.h>
 
+#include <ULogStreamWindow.hpp>
+
 #include "mavlink_bridge_header.h"
 
 /**
  * @class MavlinkULog
  * ULog streaming class. At most one instance (stream) can exist, assigned to a specific mavlink channel.
+ *
+ * Messages that need an ack are sent with a sliding window: the logger can have several of them in flight,
+ * they are acked individually by the receiver and only the unacked ones are retransmitted.
+ * The logger gets a cumulative ack (the last sequence up to which all messages are acked).
  */
 class MavlinkULog
 {
@@ -116,6 +122,8 @@ private:
 
 	void publish_ack(uint16_t sequence);
 
+	void send_acked(mavlink_channel_t channel, const ulog_stream_s &ulog_data);
+
 	static px4_sem_t _lock;
 	static bool _init;
 	static MavlinkULog *_instance;
@@ -123,10 +131,10 @@ private:
 
 	uORB::SubscriptionData<ulog_stream_s> _ulog_stream_sub{ORB_ID(ulog_stream)};
 	uORB::Publication<ulog_stream_ack_s> _ulog_stream_ack_pub{ORB_ID(ulog_stream_ack)};
-	uint16_t _wait_for_ack_sequence;
-	uint8_t _sent_tries = 0;
-	volatile bool _ack_received = false; ///< set to true if a matching ack received
-	hrt_abstime _last_sent_time = 0; ///< last time we sent a message that requires an ack
+	static_assert(ULogStreamWindow::MAX_SIZE >= ulog_stream_ack_s::MAX_WINDOW_SIZE, "ULogStreamWindow too small");
+	ULogStreamWindow _window; ///< messages waiting for an ack (protected by lock())
+	ulog_stream_s _window_data[ULogStreamWindow::MAX_SIZE]; ///< data of the messages in _window
+	hrt_abstime _start_time = 0; ///< time when the stream was requested (to check for the initial ack)
 	bool _waiting_for_initial_ack = false;
 	const uint8_t _target_system;
 	const uint8_t _target_component;
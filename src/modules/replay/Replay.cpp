@@ -47,18 +47,33 @@
 #include <px4_platform_common/time.h>
 #include <px4_platform_common/shutdown.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <fcntl.h>
 #include <float.h>
 #include <fstream>
+#include <functional>
+#include <sched.h>
+#include <inttypes.h>
 #include <iostream>
 #include <math.h>
+#include <queue>
 #include <time.h>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <logger/messages.h>
+#include <lib/ulog_compression/ulog_compression.h>
+
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+#include <px4_platform_common/px4_work_queue/WorkQueueManager.hpp>
+#endif
 
 #include "Replay.hpp"
 #include "ReplayEkf2.hpp"
@@ -85,6 +100,8 @@ Replay::CompatSensorCombinedDtType::CompatSensorCombinedDtType(int gyro_integral
 
 Replay::~Replay()
 {
+	closeReplayFile();
+
 	for (size_t i = 0; i < _subscriptions.size(); ++i) {
 		delete (_subscriptions[i]);
 	}
@@ -120,6 +137,19 @@ Replay::setupReplayFile(const char *file_name)
 		free(_replay_file);
 	}
 
+	if (ulog_compression::is_compressed_file(file_name)) {
+		// the replay reads the file non-sequentially: decompress it into a plain ULog file first
+		const string decompressed_file = string(file_name) + ".ulg";
+		PX4_INFO("decompressing log file to %s", decompressed_file.c_str());
+
+		if (ulog_compression::decompress_file(file_name, decompressed_file.c_str())) {
+			_replay_file = strdup(decompressed_file.c_str());
+			return;
+		}
+
+		PX4_ERR("failed to decompress %s", file_name);
+	}
+
 	_replay_file = strdup(file_name);
 }
 
@@ -166,16 +196,77 @@ Replay::setUserParams(const char *filename)
 }
 
 bool
-Replay::readFileHeader(std::ifstream &file)
+Replay::openReplayFile()
+{
+	closeReplayFile();
+
+	int fd = ::open(_replay_file, O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping stays valid
+
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	// the data is mostly accessed sequentially (index creation and replay)
+	posix_madvise(data, file_stat.st_size, POSIX_MADV_SEQUENTIAL);
+
+	_file_data = (const uint8_t *)data;
+	_file_size = file_stat.st_size;
+	return true;
+}
+
+void
+Replay::closeReplayFile()
+{
+	if (_file_data) {
+		munmap((void *)_file_data, _file_size);
+		_file_data = nullptr;
+		_file_size = 0;
+	}
+}
+
+const uint8_t *
+Replay::getMessage(uint64_t pos, ulog_message_header_s &message_header) const
+{
+	const uint64_t end = std::min(_file_size, _read_until_file_position);
+
+	if (pos + ULOG_MSG_HEADER_LEN > end) {
+		return nullptr;
+	}
+
+	memcpy(&message_header, _file_data + pos, ULOG_MSG_HEADER_LEN);
+
+	if (pos + ULOG_MSG_HEADER_LEN + message_header.msg_size > end) {
+		return nullptr;
+	}
+
+	return _file_data + pos + ULOG_MSG_HEADER_LEN;
+}
+
+bool
+Replay::readFileHeader()
 {
-	file.seekg(0);
 	ulog_file_header_s msg_header;
-	file.read((char *)&msg_header, sizeof(msg_header));
 
-	if (!file) {
+	if (_file_size < sizeof(msg_header)) {
 		return false;
 	}
 
+	memcpy(&msg_header, _file_data, sizeof(msg_header));
+
 	_file_start_time = msg_header.timestamp;
 	//verify it's an ULog file
 	char magic[8];
@@ -190,75 +281,72 @@ Replay::readFileHeader(std::ifstream &file)
 }
 
 bool
-Replay::readFileDefinitions(std::ifstream &file)
+Replay::readFileDefinitions()
 {
 	PX4_INFO("Applying params from ULog file...");
 
 	ulog_message_header_s message_header;
-	file.seekg(sizeof(ulog_file_header_s));
+	uint64_t pos = sizeof(ulog_file_header_s);
 
 	while (true) {
-		file.read((char *)&message_header, ULOG_MSG_HEADER_LEN);
+		const uint8_t *message = getMessage(pos, message_header);
 
-		if (!file) {
+		if (!message) {
 			return false;
 		}
 
 		switch (message_header.msg_type) {
 		case (int)ULogMessageType::FLAG_BITS:
-			if (!readFlagBits(file, message_header.msg_size)) {
+			if (!readFlagBits(message, message_header.msg_size)) {
 				return false;
 			}
 
 			break;
 
 		case (int)ULogMessageType::FORMAT:
-			if (!readFormat(file, message_header.msg_size)) {
+			if (!readFormat(message, message_header.msg_size)) {
 				return false;
 			}
 
 			break;
 
 		case (int)ULogMessageType::PARAMETER:
-			if (!readAndApplyParameter(file, message_header.msg_size)) {
+			if (!readAndApplyParameter(message, message_header.msg_size)) {
 				return false;
 			}
 
 			break;
 
 		case (int)ULogMessageType::ADD_LOGGED_MSG:
-			_data_section_start = file.tellg() - (streamoff)ULOG_MSG_HEADER_LEN;
+			_data_section_start = pos;
 			return true;
 
 		case (int)ULogMessageType::INFO: //skip
 		case (int)ULogMessageType::INFO_MULTIPLE: //skip
-			file.seekg(message_header.msg_size, ios::cur);
 			break;
 
 		default:
-			PX4_ERR("unknown log definition type %i, size %i (offset %i)",
-				(int)message_header.msg_type, (int)message_header.msg_size, (int)file.tellg());
-			file.seekg(message_header.msg_size, ios::cur);
+			PX4_ERR("unknown log definition type %i, size %i (offset %" PRIu64 ")",
+				(int)message_header.msg_type, (int)message_header.msg_size, pos);
 			break;
 		}
+
+		pos += ULOG_MSG_HEADER_LEN + message_header.msg_size;
 	}
 
 	return true;
 }
 
 bool
-Replay::readFlagBits(std::ifstream &file, uint16_t msg_size)
+Replay::readFlagBits(const uint8_t *message, uint16_t msg_size)
 {
 	if (msg_size != 40) {
 		PX4_ERR("unsupported message length for FLAG_BITS message (%i)", msg_size);
 		return false;
 	}
 
-	_read_buffer.reserve(msg_size);
-	uint8_t *message = (uint8_t *)_read_buffer.data();
-	file.read((char *)message, msg_size);
-	//uint8_t *compat_flags = message;
-	uint8_t *incompat_flags = message + 8;
+	//const uint8_t *compat_flags = message;
+	const uint8_t *incompat_flags = message + 8;
 
 	// handle & validate the flags
 	bool contains_appended_data = incompat_flags[0] & ULOG_INCOMPAT_FLAG0_DATA_APPENDED_MASK;
@@ -294,18 +382,9 @@ Replay::readFlagBits(std::ifstream &file, uint16_t msg_size)
 }
 
 bool
-Replay::readFormat(std::ifstream &file, uint16_t msg_size)
+Replay::readFormat(const uint8_t *message, uint16_t msg_size)
 {
-	_read_buffer.reserve(msg_size + 1);
-	char *format = (char *)_read_buffer.data();
-	file.read(format, msg_size);
-	format[msg_size] = 0;
-
-	if (!file) {
-		return false;
-	}
-
-	string str_format(format);
+	string str_format((const char *)message, msg_size);
 	size_t pos = str_format.find(':');
 
 	if (pos == string::npos) {
@@ -320,27 +399,21 @@ Replay::readFormat(std::ifstream &file, uint16_t msg_size)
 }
 
 bool
-Replay::readAndAddSubscription(std::ifstream &file, uint16_t msg_size)
+Replay::addSubscription(const uint8_t *message, uint16_t msg_size)
 {
-	_read_buffer.reserve(msg_size + 1);
-	char *message = (char *)_read_buffer.data();
-	streampos this_message_pos = file.tellg() - (streamoff)ULOG_MSG_HEADER_LEN;
-	file.read(message, msg_size);
-	message[msg_size] = 0;
-
-	if (!file) {
+	if (msg_size < 3) {
 		return false;
 	}
 
-	if (file.tellg() <= _subscription_file_pos) { //already read this subscription
+	uint8_t multi_id = message[0];
+	uint16_t msg_id = ((uint16_t) message[1]) | (((uint16_t) message[2]) << 8);
+	string topic_name((const char *)message + 3, strnlen((const char *)message + 3, msg_size - 3));
+
+	if (msg_id < _subscriptions.size() && _subscriptions[msg_id]) {
+		PX4_WARN("msg_id %i of %s already used. Will ignore it", msg_id, topic_name.c_str());
 		return true;
 	}
 
-	_subscription_file_pos = file.tellg();
-
-	uint8_t multi_id = *(uint8_t *)message;
-	uint16_t msg_id = ((uint16_t) message[1]) | (((uint16_t) message[2]) << 8);
-	string topic_name(message + 3);
 	const orb_metadata *orb_meta = findTopic(topic_name);
 
 	if (!orb_meta) {
@@ -407,32 +480,13 @@ Replay::readAndAddSubscription(std::ifstream &file, uint16_t msg_size)
 		return true;
 	}
 
-	//find first data message (and the timestamp)
-	streampos cur_pos = file.tellg();
-	subscription->next_read_pos = this_message_pos; //this will be skipped
-
-	if (!nextDataMessage(file, *subscription, msg_id)) {
-		return false;
-	}
-
-	file.seekg(cur_pos);
-
-	if (!subscription->orb_meta) {
-		//no message found. This is not a fatal error
-		return true;
-	}
-
-	PX4_DEBUG("adding subscription for %s (msg_id %i)", subscription->orb_meta->o_name, msg_id);
-
-	//add subscription
+	//add subscription (it will be used once the index is complete)
 	if (_subscriptions.size() <= msg_id) {
 		_subscriptions.resize(msg_id + 1);
 	}
 
 	_subscriptions[msg_id] = subscription;
 
-	onSubscriptionAdded(*_subscriptions[msg_id], msg_id);
-
 	return true;
 }
 
@@ -467,52 +521,157 @@ Replay::findFieldOffset(const string &format, const string &field_name, int &off
 	return false;
 }
 
-bool
-Replay::readAndHandleAdditionalMessages(std::ifstream &file, std::streampos end_position)
+void
+Replay::DataIndex::push_back(uint64_t offset)
 {
-	ulog_message_header_s message_header;
+	// start a new chunk when the current one is full or the delta does not fit
+	if (_chunks.empty() || (_deltas.size() - _chunks.back().first_index >= CHUNK_SIZE)
+	    || (offset - _chunks.back().base > UINT32_MAX)) {
+		_chunks.push_back(Chunk{offset, _deltas.size()});
+	}
 
-	while (file.tellg() < end_position) {
-		file.read((char *)&message_header, ULOG_MSG_HEADER_LEN);
+	_deltas.push_back((uint32_t)(offset - _chunks.back().base));
+}
 
-		if (!file) {
-			return false;
-		}
+uint64_t
+Replay::DataIndex::operator[](size_t index) const
+{
+	// last chunk starting at or before index
+	auto chunk = std::upper_bound(_chunks.begin(), _chunks.end(), index, [](size_t i, const Chunk & c) {
+		return i < c.first_index;
+	}) - 1;
+
+	return chunk->base + _deltas[index];
+}
 
+void
+Replay::DataIndex::clear()
+{
+	_chunks.clear();
+	_chunks.shrink_to_fit();
+	_deltas.clear();
+	_deltas.shrink_to_fit();
+}
+
+bool
+Replay::buildIndex()
+{
+	ulog_message_header_s message_header;
+	uint64_t pos = _data_section_start;
+	uint64_t num_data_messages = 0;
+	const uint8_t *message;
+
+	while ((message = getMessage(pos, message_header))) {
 		switch (message_header.msg_type) {
-		case (int)ULogMessageType::PARAMETER:
-			if (!readAndApplyParameter(file, message_header.msg_size)) {
+		case (int)ULogMessageType::ADD_LOGGED_MSG:
+			if (!addSubscription(message, message_header.msg_size)) {
 				return false;
 			}
 
 			break;
 
+		case (int)ULogMessageType::DATA:
+			if (message_header.msg_size >= 2) {
+				uint16_t msg_id;
+				memcpy(&msg_id, message, sizeof(msg_id));
+				Subscription *subscription = msg_id < _subscriptions.size() ? _subscriptions[msg_id] : nullptr;
+
+				if (!subscription) {
+					break;
+				}
+
+				if (message_header.msg_size == subscription->orb_meta->o_size_no_padding + 2) {
+					subscription->data_offsets.push_back(pos);
+					++num_data_messages;
+
+				} else { //sanity check failed!
+					PX4_ERR("data message %s has wrong size %i (expected %i). Skipping",
+						subscription->orb_meta->o_name, message_header.msg_size,
+						subscription->orb_meta->o_size_no_padding + 2);
+				}
+			}
+
+			break;
+
+		case (int)ULogMessageType::PARAMETER:
 		case (int)ULogMessageType::DROPOUT:
-			readDropout(file, message_header.msg_size);
+			_additional_message_offsets.push_back(pos);
+			break;
+
+		case (int)ULogMessageType::REMOVE_LOGGED_MSG: //skip these
+		case (int)ULogMessageType::INFO:
+		case (int)ULogMessageType::INFO_MULTIPLE:
+		case (int)ULogMessageType::SYNC:
+		case (int)ULogMessageType::LOGGING:
 			break;
 
-		default: //skip all others
-			file.seekg(message_header.msg_size, ios::cur);
+		default:
+			//this really should not happen
+			PX4_ERR("unknown log message type %i, size %i (offset %" PRIu64 ")",
+				(int)message_header.msg_type, (int)message_header.msg_size, pos);
 			break;
 		}
+
+		pos += ULOG_MSG_HEADER_LEN + message_header.msg_size;
 	}
 
+	// move each subscription to its first data message
+	for (size_t msg_id = 0; msg_id < _subscriptions.size(); ++msg_id) {
+		Subscription *subscription = _subscriptions[msg_id];
+
+		if (!subscription) {
+			continue;
+		}
+
+		if (!nextDataMessage(*subscription)) {
+			//no message found. This is not a fatal error
+			delete subscription->compat;
+			delete subscription;
+			_subscriptions[msg_id] = nullptr;
+			continue;
+		}
+
+		PX4_DEBUG("adding subscription for %s (msg_id %i)", subscription->orb_meta->o_name, (int)msg_id);
+
+		onSubscriptionAdded(*subscription, msg_id);
+	}
+
+	PX4_INFO("Indexed %" PRIu64 " data messages", num_data_messages);
+
 	return true;
 }
 
-bool
-Replay::readAndApplyParameter(std::ifstream &file, uint16_t msg_size)
+void
+Replay::readAndHandleAdditionalMessages(uint64_t end_position)
 {
-	_read_buffer.reserve(msg_size);
-	uint8_t *message = (uint8_t *)_read_buffer.data();
-	file.read((char *)message, msg_size);
+	ulog_message_header_s message_header;
+
+	while (_next_additional_message < _additional_message_offsets.size() &&
+	       _additional_message_offsets[_next_additional_message] < end_position) {
+
+		const uint8_t *message = getMessage(_additional_message_offsets[_next_additional_message++], message_header);
 
-	if (!file) {
+		switch (message_header.msg_type) {
+		case (int)ULogMessageType::PARAMETER:
+			readAndApplyParameter(message, message_header.msg_size);
+			break;
+
+		case (int)ULogMessageType::DROPOUT:
+			readDropout(message, message_header.msg_size);
+			break;
+		}
+	}
+}
+
+bool
+Replay::readAndApplyParameter(const uint8_t *message, uint16_t msg_size)
+{
+	if (msg_size < 1 || message[0] + 1 > msg_size) {
 		return false;
 	}
 
 	uint8_t key_len = message[0];
-	string key((char *)message + 1, key_len);
+	string key((const char *)message + 1, key_len);
 
 	size_t pos = key.find(' ');
 
@@ -533,108 +692,51 @@ Replay::readAndApplyParameter(std::ifstream &file, uint16_t msg_size)
 		return true;
 	}
 
+	if (msg_size < 1 + key_len + sizeof(int32_t)) {
+		return false;
+	}
+
 	param_t handle = param_find(param_name.c_str());
 
 	if (handle != PARAM_INVALID) {
-		param_set(handle, (const void *)(message + 1 + key_len));
+		// copy the value, as it is not aligned in the file (floats are copied bitwise)
+		int32_t value;
+		memcpy(&value, message + 1 + key_len, sizeof(value));
+		param_set(handle, (const void *)&value);
 	}
 
 	return true;
 }
 
 bool
-Replay::readDropout(std::ifstream &file, uint16_t msg_size)
+Replay::readDropout(const uint8_t *message, uint16_t msg_size)
 {
 	uint16_t duration;
-	file.read((char *)&duration, sizeof(duration));
+
+	if (msg_size < sizeof(duration)) {
+		return false;
+	}
+
+	memcpy(&duration, message, sizeof(duration));
 
 	PX4_INFO("Dropout in replayed log, %i ms", (int)duration);
-	return file.good();
+	return true;
 }
 
 bool
-Replay::nextDataMessage(std::ifstream &file, Subscription &subscription, int msg_id)
+Replay::nextDataMessage(Subscription &subscription)
 {
-	ulog_message_header_s message_header;
-	file.seekg(subscription.next_read_pos);
-	//ignore the first message (it's data we already read)
-	file.read((char *)&message_header, ULOG_MSG_HEADER_LEN);
-
-	if (file) {
-		file.seekg(message_header.msg_size, ios::cur);
-	}
-
-	uint16_t file_msg_id;
-	bool done = false;
-
-	while (file && !done) {
-		streampos cur_pos = file.tellg();
-		file.read((char *)&message_header, ULOG_MSG_HEADER_LEN);
-
-		if (!file) {
-			break;
-		}
-
-		if (((streamoff)cur_pos) + ULOG_MSG_HEADER_LEN + message_header.msg_size > _read_until_file_position) {
-			file.setstate(std::ios::eofbit);
-			break;
-		}
-
-		switch (message_header.msg_type) {
-		case (int)ULogMessageType::ADD_LOGGED_MSG:
-			readAndAddSubscription(file, message_header.msg_size);
-			break;
-
-		case (int)ULogMessageType::DATA:
-			file.read((char *)&file_msg_id, sizeof(file_msg_id));
-
-			if (file) {
-				if (msg_id == file_msg_id) {
-					if (message_header.msg_size == subscription.orb_meta->o_size_no_padding + 2) {
-						subscription.next_read_pos = cur_pos;
-						file.seekg(subscription.timestamp_offset, ios::cur);
-						file.read((char *)&subscription.next_timestamp, sizeof(subscription.next_timestamp));
-						done = true;
-
-					} else { //sanity check failed!
-						PX4_ERR("data message %s has wrong size %i (expected %i). Skipping",
-							subscription.orb_meta->o_name, message_header.msg_size,
-							subscription.orb_meta->o_size_no_padding + 2);
-						file.seekg(message_header.msg_size - sizeof(file_msg_id), ios::cur);
-					}
-
-				} else { //not the one we are looking for
-					file.seekg(message_header.msg_size - sizeof(file_msg_id), ios::cur);
-				}
-			}
-
-			break;
-
-		case (int)ULogMessageType::REMOVE_LOGGED_MSG: //skip these
-		case (int)ULogMessageType::PARAMETER:
-		case (int)ULogMessageType::DROPOUT:
-		case (int)ULogMessageType::INFO:
-		case (int)ULogMessageType::INFO_MULTIPLE:
-		case (int)ULogMessageType::SYNC:
-		case (int)ULogMessageType::LOGGING:
-			file.seekg(message_header.msg_size, ios::cur);
-			break;
-
-		default:
-			//this really should not happen
-			PX4_ERR("unknown log message type %i, size %i (offset %i)",
-				(int)message_header.msg_type, (int)message_header.msg_size, (int)file.tellg());
-			file.seekg(message_header.msg_size, ios::cur);
-			break;
-		}
-	}
-
-	if (file.eof()) { //no more data messages for this subscription
+	if (subscription.next_index >= subscription.data_offsets.size()) {
+		//no more data messages for this subscription
 		subscription.orb_meta = nullptr;
-		file.clear();
+		subscription.data_offsets.clear();
+		return false;
 	}
 
-	return file.good();
+	subscription.next_read_pos = subscription.data_offsets[subscription.next_index++];
+	memcpy(&subscription.next_timestamp, _file_data + subscription.next_read_pos + ULOG_MSG_HEADER_LEN + 2 +
+	       subscription.timestamp_offset, sizeof(subscription.next_timestamp));
+	return true;
 }
 
 const orb_metadata *
@@ -710,7 +812,7 @@ Replay::sizeOfFullType(const std::string &type_name_full)
 }
 
 bool
-Replay::readDefinitionsAndApplyParams(std::ifstream &file)
+Replay::readDefinitionsAndApplyParams()
 {
 	// log reader currently assumes little endian
 	int num = 1;
@@ -720,18 +822,18 @@ Replay::readDefinitionsAndApplyParams(std::ifstream &file)
 		return false;
 	}
 
-	if (!file.is_open()) {
+	if (!openReplayFile()) {
 		PX4_ERR("Failed to open replay file");
 		return false;
 	}
 
-	if (!readFileHeader(file)) {
+	if (!readFileHeader()) {
 		PX4_ERR("Failed to read file header. Not a valid ULog file");
 		return false;
 	}
 
 	//initialize the formats and apply the parameters from the log file
-	if (!readFileDefinitions(file)) {
+	if (!readFileDefinitions()) {
 		PX4_ERR("Failed to read ULog definitions section. Broken file?");
 		return false;
 	}
@@ -743,89 +845,77 @@ Replay::readDefinitionsAndApplyParams(std::ifstream &file)
 void
 Replay::run()
 {
-	ifstream replay_file(_replay_file, ios::in | ios::binary);
+	if (!readDefinitionsAndApplyParams()) {
+		return;
+	}
 
-	if (!readDefinitionsAndApplyParams(replay_file)) {
+	if (!buildIndex()) {
+		PX4_ERR("Failed to read subscription");
 		return;
 	}
 
 	onEnterMainLoop();
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	// The replay drives the time: the first time set defines hrt_absolute_time() = 0 (there is no
+	// simulator), then start at the beginning of the log, so that the timestamps are kept as is.
+	struct timespec ts;
+	abstime_to_ts(&ts, 1);
+	px4_clock_settime(CLOCK_MONOTONIC, &ts);
+	advanceTime(_file_start_time);
+#endif
+
+	const auto wall_start_time = std::chrono::steady_clock::now();
 	_replay_start_time = hrt_absolute_time();
 
 	PX4_INFO("Replay in progress...");
 
-	ulog_message_header_s message_header;
-	replay_file.seekg(_data_section_start);
-
-	//we know the next message must be an ADD_LOGGED_MSG
-	replay_file.read((char *)&message_header, ULOG_MSG_HEADER_LEN);
-
-	if (!readAndAddSubscription(replay_file, message_header.msg_size)) {
-		PX4_ERR("Failed to read subscription");
-		return;
-	}
-
 	//we update the timestamps from the file by a constant offset to match
 	//the current replay time
 	const uint64_t timestamp_offset = _replay_start_time - _file_start_time;
 	uint32_t nr_published_messages = 0;
-	streampos last_additional_message_pos = _data_section_start;
-
-	while (!should_exit() && replay_file) {
-
-		//Find the next message to publish. Messages from different subscriptions don't need
-		//to be in chronological order, so we need to check all subscriptions
-		uint64_t next_file_time = 0;
-		int next_msg_id = -1;
-		bool first_time = true;
 
-		for (size_t i = 0; i < _subscriptions.size(); ++i) {
-			const Subscription *subscription = _subscriptions[i];
+	//Messages from different subscriptions don't need to be in chronological order, so we
+	//merge them on the timestamps: the queue contains the next message of each active subscription.
+	typedef std::pair<uint64_t, uint16_t> QueueEntry; // file timestamp, msg_id
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
 
-			if (!subscription) {
-				continue;
-			}
+	for (size_t i = 0; i < _subscriptions.size(); ++i) {
+		const Subscription *subscription = _subscriptions[i];
 
-			if (subscription->orb_meta && !subscription->ignored) {
-				if (first_time || subscription->next_timestamp < next_file_time) {
-					first_time = false;
-					next_msg_id = (int)i;
-					next_file_time = subscription->next_timestamp;
-				}
-			}
+		if (subscription && subscription->orb_meta && !subscription->ignored) {
+			queue.emplace(subscription->next_timestamp, (uint16_t)i);
 		}
+	}
 
-		if (next_msg_id == -1) {
-			break; //no active subscription anymore. We're done.
-		}
+	while (!should_exit() && !queue.empty()) {
+
+		const uint64_t next_file_time = queue.top().first;
+		const uint16_t next_msg_id = queue.top().second;
+		queue.pop();
 
 		Subscription &sub = *_subscriptions[next_msg_id];
 
-		if (next_file_time == 0) {
-			//someone didn't set the timestamp properly. Consider the message invalid
-			nextDataMessage(replay_file, sub, next_msg_id);
-			continue;
-		}
+		if (next_file_time != 0) {
+			//handle additional messages between last and next published data
+			readAndHandleAdditionalMessages(sub.next_read_pos);
+
+			const uint64_t publish_timestamp = handleTopicDelay(next_file_time, timestamp_offset);
 
-		//handle additional messages between last and next published data
-		replay_file.seekg(last_additional_message_pos);
-		streampos next_additional_message_pos = sub.next_read_pos;
-		readAndHandleAdditionalMessages(replay_file, next_additional_message_pos);
-		last_additional_message_pos = next_additional_message_pos;
+			// It's time to publish
+			readTopicDataToBuffer(sub);
+			memcpy(_read_buffer.data() + sub.timestamp_offset, &publish_timestamp, sizeof(uint64_t)); //adjust the timestamp
 
-		const uint64_t publish_timestamp = handleTopicDelay(next_file_time, timestamp_offset);
+			if (handleTopicUpdate(sub, _read_buffer.data())) {
+				++nr_published_messages;
+			}
 
-		// It's time to publish
-		readTopicDataToBuffer(sub, replay_file);
-		memcpy(_read_buffer.data() + sub.timestamp_offset, &publish_timestamp, sizeof(uint64_t)); //adjust the timestamp
+		} // else: someone didn't set the timestamp properly. Consider the message invalid
 
-		if (handleTopicUpdate(sub, _read_buffer.data(), replay_file)) {
-			++nr_published_messages;
+		if (nextDataMessage(sub)) {
+			queue.emplace(sub.next_timestamp, next_msg_id);
 		}
 
-		nextDataMessage(replay_file, sub, next_msg_id);
-
 		// TODO: output status (eg. every sec), including total duration...
 	}
 
@@ -846,11 +936,12 @@ Replay::run()
 	}
 
 	if (!should_exit()) {
-		PX4_INFO("Replay done (published %u msgs, %.3lf s)", nr_published_messages,
-			 (double)hrt_elapsed_time(&_replay_start_time) / 1.e6);
+		const double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_time).count();
+		PX4_INFO("Replay done (published %u msgs, %.3lf s, log duration %.3lf s)", nr_published_messages,
+			 wall_time, (double)hrt_elapsed_time(&_replay_start_time) / 1.e6);
 
 		//TODO: add parameter -q?
-		replay_file.close();
+		closeReplayFile();
 		px4_shutdown_request(false, false);
 	}
 
@@ -858,17 +949,17 @@ Replay::run()
 }
 
 void
-Replay::readTopicDataToBuffer(const Subscription &sub, std::ifstream &replay_file)
+Replay::readTopicDataToBuffer(const Subscription &sub)
 {
 	const size_t msg_read_size = sub.orb_meta->o_size_no_padding;
 	const size_t msg_write_size = sub.orb_meta->o_size;
 	_read_buffer.reserve(msg_write_size);
-	replay_file.seekg(sub.next_read_pos + (streamoff)(ULOG_MSG_HEADER_LEN + 2)); //skip header & msg id
-	replay_file.read((char *)_read_buffer.data(), msg_read_size);
+	//skip header & msg id
+	memcpy(_read_buffer.data(), _file_data + sub.next_read_pos + ULOG_MSG_HEADER_LEN + 2, msg_read_size);
 }
 
 bool
-Replay::handleTopicUpdate(Subscription &sub, void *data, std::ifstream &replay_file)
+Replay::handleTopicUpdate(Subscription &sub, void *data)
 {
 	return publishTopic(sub, data);
 }
@@ -878,6 +969,10 @@ Replay::handleTopicDelay(uint64_t next_file_time, uint64_t timestamp_offset)
 {
 	const uint64_t publish_timestamp = next_file_time + timestamp_offset;
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	// no need to wait, we set the time (timestamp_offset is 0)
+	advanceTime(next_file_time);
+#else
 	// wait if necessary
 	uint64_t cur_time = hrt_absolute_time();
 
@@ -886,9 +981,47 @@ Replay::handleTopicDelay(uint64_t next_file_time, uint64_t timestamp_offset)
 		px4_usleep(publish_timestamp - cur_time);
 	}
 
+#endif
+
 	return publish_timestamp;
 }
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+void
+Replay::advanceTime(uint64_t file_time)
+{
+	waitUntilIdle();
+
+	// if some topics have a timestamp smaller than the current time, publish them immediately
+	if (file_time > hrt_absolute_time()) {
+		struct timespec ts;
+		abstime_to_ts(&ts, file_time + 1); // offset of the first time set in run()
+		px4_clock_settime(CLOCK_MONOTONIC, &ts);
+
+		// handle the timers that got due
+		waitUntilIdle();
+	}
+}
+
+void
+Replay::waitUntilIdle()
+{
+	while (!should_exit()) {
+		// A callout can schedule work and work can schedule a callout, so we need to check that no
+		// callout was invoked while checking the work queues.
+		uint32_t invocations_before;
+		uint32_t invocations_after;
+
+		if (hrt_callouts_idle(&invocations_before) && px4::WorkQueueManagerIdle() && px4_lockstep_components_idle() &&
+		    hrt_callouts_idle(&invocations_after) && invocations_before == invocations_after) {
+			return;
+		}
+
+		sched_yield();
+	}
+}
+#endif
+
 bool
 Replay::publishTopic(Subscription &sub, void *data)
 {
@@ -1001,9 +1134,7 @@ Replay::applyParams(bool quiet)
 		return -ENOMEM;
 	}
 
-	ifstream replay_file(_replay_file, ios::in | ios::binary);
-
-	if (!r->readDefinitionsAndApplyParams(replay_file)) {
+	if (!r->readDefinitionsAndApplyParams()) {
 		ret = -1;
 	}
 
@@ -1025,6 +1156,15 @@ Replay::instantiate(int argc, char *argv[])
 		instance = new ReplayEkf2();
 
 	} else {
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+		PX4_INFO("Fast replay mode");
+#else
+
+		if (replay_mode && strcmp(replay_mode, "fast") == 0) {
+			PX4_WARN("fast replay needs a build with replay_mode=fast, replaying in real time");
+		}
+
+#endif
 		instance = new Replay();
 	}
 
@@ -1047,6 +1187,13 @@ There are 2 environment variables used for configuration: `replay`, which must b
 the log file to be replayed. The second is the mode, specified via `replay_mode`:
 - `replay_mode=ekf2`: specific EKF2 replay mode. It can only be used with the ekf2 module, but allows the replay
   to run as fast as possible.
+  `Tools/replay_batch.py` runs many EKF2 replays of the same log in parallel, each with its own parameter overrides
+  (e.g. for parameter sweeps).
+- `replay_mode=fast`: generic replay as fast as possible. PX4 must be built with it set as well
+  (`replay=<log file> replay_mode=fast make px4_sitl_default`), which enables the lockstep scheduler. The replay sets
+  the time to the timestamps of the log and waits for the work queues to be idle before continuing. This is only
+  deterministic for modules running on work queues (and the logger): modules running in their own task are not
+  waited for.
 - Generic otherwise: this can be used to replay any module(s), but the replay will be done with the same speed as the
   log was recorded.
 
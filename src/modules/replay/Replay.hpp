@@ -33,7 +33,6 @@
 
 #pragma once
 
-#include <fstream>
 #include <map>
 #include <vector>
 #include <set>
@@ -44,6 +43,7 @@
 #include <px4_platform_common/module.h>
 #include <uORB/uORBTopics.h>
 #include <uORB/topics/ekf2_timestamps.h>
+#include <logger/messages.h>
 
 namespace px4
 {
@@ -51,9 +51,10 @@ namespace px4
 /**
  * @class Replay
  * Parses an ULog file and replays it in 'real-time'. The timestamp of each replayed message is offset
- * to match the starting time of replay. It keeps a stream for each subscription to find the next message
- * to replay. This is necessary because data messages from different subscriptions don't need to be in
- * monotonic increasing order.
+ * to match the starting time of replay. The file is memory-mapped, and the data messages of each subscription
+ * are indexed in a single pass before replay. The subscriptions are then merged on their timestamps to find
+ * the next message to replay. This is necessary because data messages from different subscriptions don't
+ * need to be in monotonic increasing order.
  */
 class Replay : public ModuleBase<Replay>
 {
@@ -88,6 +89,7 @@ public:
 	 * Tell the replay module that we want to use replay mode.
 	 * After that, only 'replay start' must be executed (typically the last step after startup).
 	 * @param file_name file name of the used log replay file. Will be copied.
+	 *                  Compressed files (.ulgz) are decompressed to <file_name>.ulg.
 	 */
 	static void setupReplayFile(const char *file_name);
 
@@ -125,6 +127,33 @@ protected:
 		int _accelerometer_integral_dt_offset_intern;
 	};
 
+	/**
+	 * @class File offsets of the data messages of a subscription, in file order. The offsets are stored
+	 * as 32 bit deltas to the base offset of their chunk (4 instead of 8 bytes per message).
+	 */
+	class DataIndex
+	{
+	public:
+		void push_back(uint64_t offset);
+
+		uint64_t operator[](size_t index) const;
+
+		size_t size() const { return _deltas.size(); }
+
+		void clear();
+
+	private:
+		struct Chunk {
+			uint64_t base; ///< file offset of the first entry
+			size_t first_index; ///< index of the first entry
+		};
+
+		static constexpr size_t CHUNK_SIZE = 4096; ///< max entries per chunk
+
+		std::vector<Chunk> _chunks;
+		std::vector<uint32_t> _deltas;
+	};
+
 	struct Subscription {
 
 		const orb_metadata *orb_meta = nullptr; ///< if nullptr, this subscription is invalid
@@ -134,9 +163,12 @@ protected:
 
 		bool ignored = false; ///< if true, it will not be considered for publication in the main loop
 
-		std::streampos next_read_pos;
+		uint64_t next_read_pos; ///< file offset of the next message
 		uint64_t next_timestamp; ///< timestamp of the file
 
+		DataIndex data_offsets; ///< index: file offsets of all data messages of this subscription
+		size_t next_index = 0; ///< next entry in data_offsets
+
 		CompatBase *compat = nullptr;
 
 		// statistics
@@ -185,26 +217,38 @@ protected:
 	 */
 	virtual uint64_t handleTopicDelay(uint64_t next_file_time, uint64_t timestamp_offset);
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	/**
+	 * Advance the (lockstep) time to a timestamp of the file, after the consumers of the previously
+	 * published messages are done. The replay drives the time, so it runs as fast as possible.
+	 */
+	void advanceTime(uint64_t file_time);
+
+	/**
+	 * Wait until all work triggered by publications and timers is done: no hrt callout is due and
+	 * no WorkItem is scheduled or running, and all tasks registered as lockstep components (the logger)
+	 * are waiting. Other modules running in their own task are not considered.
+	 */
+	void waitUntilIdle();
+#endif
+
 	/**
 	 * handle the publication of a topic update
 	 * @return true if published, false otherwise
 	 */
-	virtual bool handleTopicUpdate(Subscription &sub, void *data, std::ifstream &replay_file);
+	virtual bool handleTopicUpdate(Subscription &sub, void *data);
 
 	/**
 	 * read a topic from the file (offset given by the subscription) into _read_buffer
 	 */
-	void readTopicDataToBuffer(const Subscription &sub, std::ifstream &replay_file);
+	void readTopicDataToBuffer(const Subscription &sub);
 
 	/**
-	 * Find next data message for this subscription, starting with the stored file offset.
-	 * Skip the first message, and if found, read the timestamp and store the new file offset.
-	 * This also takes care of new subscriptions and parameter updates. When reaching EOF,
-	 * the subscription is set to invalid.
-	 * File seek position is arbitrary after this call.
-	 * @return false on file error
+	 * Move the subscription to its next data message in the index, and read the timestamp.
+	 * When there is no more data, the subscription is set to invalid.
+	 * @return false if there is no more data
 	 */
-	bool nextDataMessage(std::ifstream &file, Subscription &subscription, int msg_id);
+	bool nextDataMessage(Subscription &subscription);
 
 	std::vector<Subscription *> _subscriptions;
 	std::vector<uint8_t> _read_buffer;
@@ -215,43 +259,63 @@ private:
 
 	uint64_t _file_start_time;
 	uint64_t _replay_start_time;
-	std::streampos _data_section_start; ///< first ADD_LOGGED_MSG message
+	uint64_t _data_section_start; ///< first ADD_LOGGED_MSG message
+
+	const uint8_t *_file_data{nullptr}; ///< memory-mapped replay file
+	uint64_t _file_size{0};
+
+	uint64_t _read_until_file_position = 1ULL << 60; ///< read limit if log contains appended data
 
-	/** keep track of file position to avoid adding a subscription multiple times. */
-	std::streampos _subscription_file_pos = 0;
+	std::vector<uint64_t> _additional_message_offsets; ///< parameter & dropout messages in the data section
+	size_t _next_additional_message{0}; ///< next entry in _additional_message_offsets to handle
 
-	int64_t _read_until_file_position = 1ULL << 60; ///< read limit if log contains appended data
+	bool openReplayFile();
+	void closeReplayFile();
 
-	bool readFileHeader(std::ifstream &file);
+	/**
+	 * Get a message from the mapped file
+	 * @param pos file offset of the message
+	 * @param message_header returned message header
+	 * @return message payload, nullptr if the message exceeds the file or read limit
+	 */
+	const uint8_t *getMessage(uint64_t pos, ulog_message_header_s &message_header) const;
+
+	bool readFileHeader();
 
 	/**
 	 * Read definitions section: check formats, apply parameters and store
 	 * the start of the data section.
 	 * @return true on success
 	 */
-	bool readFileDefinitions(std::ifstream &file);
+	bool readFileDefinitions();
+
+	/**
+	 * Read the data section once and build the index of data messages for each subscription.
+	 * Then move all subscriptions to their first data message.
+	 * @return true on success
+	 */
+	bool buildIndex();
 
-	///file parsing methods. They return false, when further parsing should be aborted.
-	bool readFormat(std::ifstream &file, uint16_t msg_size);
-	bool readAndAddSubscription(std::ifstream &file, uint16_t msg_size);
-	bool readFlagBits(std::ifstream &file, uint16_t msg_size);
+	///message parsing methods. They return false, when further parsing should be aborted.
+	bool readFormat(const uint8_t *message, uint16_t msg_size);
+	bool addSubscription(const uint8_t *message, uint16_t msg_size);
+	bool readFlagBits(const uint8_t *message, uint16_t msg_size);
 
 	/**
-	 * Read the file header and definitions sections. Apply the parameters from this section
-	 * and apply user-defined overridden parameters.
+	 * Open the replay file, read the file header and definitions sections. Apply the parameters from this
+	 * section and apply user-defined overridden parameters.
 	 * @return true on success
 	 */
-	bool readDefinitionsAndApplyParams(std::ifstream &file);
+	bool readDefinitionsAndApplyParams();
 
 	/**
-	 * Read and handle additional messages starting at current file position, while position < end_position.
+	 * Handle the additional messages in the data section that were not handled yet, while position < end_position.
 	 * This handles dropout and parameter update messages.
 	 * We need to handle these separately, because they have no timestamp. We look at the file position instead.
-	 * @return false on file error
 	 */
-	bool readAndHandleAdditionalMessages(std::ifstream &file, std::streampos end_position);
-	bool readDropout(std::ifstream &file, uint16_t msg_size);
-	bool readAndApplyParameter(std::ifstream &file, uint16_t msg_size);
+	void readAndHandleAdditionalMessages(uint64_t end_position);
+	bool readDropout(const uint8_t *message, uint16_t msg_size);
+	bool readAndApplyParameter(const uint8_t *message, uint16_t msg_size);
 
 	static const orb_metadata *findTopic(const std::string &name);
 
@@ -56,16 +56,30 @@ namespace px4
 {
 
 bool
-ReplayEkf2::handleTopicUpdate(Subscription &sub, void *data, std::ifstream &replay_file)
+ReplayEkf2::handleTopicUpdate(Subscription &sub, void *data)
 {
 	if (sub.orb_meta == ORB_ID(ekf2_timestamps)) {
 		ekf2_timestamps_s ekf2_timestamps;
 		memcpy(&ekf2_timestamps, data, sub.orb_meta->o_size);
 
-		if (!publishEkf2Topics(ekf2_timestamps, replay_file)) {
+		if (!publishEkf2Topics(ekf2_timestamps)) {
 			return false;
 		}
 
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+		// the estimator runs on a work queue: wait until it's done, and until the logger (which polls on
+		// the estimator output) logged it (a poll timeout would never trigger, as the replay drives the time)
+		waitUntilIdle();
+
+		bool updated = false;
+		orb_check(_vehicle_attitude_sub, &updated);
+
+		if (updated) {
+			vehicle_attitude_s att;
+			orb_copy(ORB_ID(vehicle_attitude), _vehicle_attitude_sub, &att);
+		}
+
+#else
 		px4_pollfd_struct_t fds[1];
 		fds[0].fd = _vehicle_attitude_sub;
 		fds[0].events = POLLIN;
@@ -93,6 +107,7 @@ ReplayEkf2::handleTopicUpdate(Subscription &sub, void *data, std::ifstream &repl
 			}
 		}
 
+#endif
 		return true;
 
 	} else if (sub.orb_meta == ORB_ID(vehicle_status) || sub.orb_meta == ORB_ID(vehicle_land_detected)
@@ -141,13 +156,13 @@ ReplayEkf2::onSubscriptionAdded(Subscription &sub, uint16_t msg_id)
 }
 
 bool
-ReplayEkf2::publishEkf2Topics(const ekf2_timestamps_s &ekf2_timestamps, std::ifstream &replay_file)
+ReplayEkf2::publishEkf2Topics(const ekf2_timestamps_s &ekf2_timestamps)
 {
 	auto handle_sensor_publication = [&](int16_t timestamp_relative, uint16_t msg_id) {
 		if (timestamp_relative != ekf2_timestamps_s::RELATIVE_TIMESTAMP_INVALID) {
 			// timestamp_relative is already given in 0.1 ms
 			uint64_t t = timestamp_relative + ekf2_timestamps.timestamp / 100; // in 0.1 ms
-			findTimestampAndPublish(t, msg_id, replay_file);
+			findTimestampAndPublish(t, msg_id);
 		}
 	};
 
@@ -160,7 +175,7 @@ ReplayEkf2::publishEkf2Topics(const ekf2_timestamps_s &ekf2_timestamps, std::ifs
 	handle_sensor_publication(ekf2_timestamps.visual_odometry_timestamp_rel, _vehicle_visual_odometry_msg_id);
 
 	// sensor_combined: publish last because ekf2 is polling on this
-	if (!findTimestampAndPublish(ekf2_timestamps.timestamp / 100, _sensor_combined_msg_id, replay_file)) {
+	if (!findTimestampAndPublish(ekf2_timestamps.timestamp / 100, _sensor_combined_msg_id)) {
 		if (_sensor_combined_msg_id == msg_id_invalid) {
 			// subscription not found yet or sensor_combined not contained in log
 			return false;
@@ -170,7 +185,7 @@ ReplayEkf2::publishEkf2Topics(const ekf2_timestamps_s &ekf2_timestamps, std::ifs
 
 		} else {
 			// we should publish a topic, just publish the same again
-			readTopicDataToBuffer(*_subscriptions[_sensor_combined_msg_id], replay_file);
+			readTopicDataToBuffer(*_subscriptions[_sensor_combined_msg_id]);
 			publishTopic(*_subscriptions[_sensor_combined_msg_id], _read_buffer.data());
 		}
 	}
@@ -179,7 +194,7 @@ ReplayEkf2::publishEkf2Topics(const ekf2_timestamps_s &ekf2_timestamps, std::ifs
 }
 
 bool
-ReplayEkf2::findTimestampAndPublish(uint64_t timestamp, uint16_t msg_id, std::ifstream &replay_file)
+ReplayEkf2::findTimestampAndPublish(uint64_t timestamp, uint16_t msg_id)
 {
 	if (msg_id == msg_id_invalid) {
 		// could happen if a topic is not logged
@@ -189,7 +204,7 @@ ReplayEkf2::findTimestampAndPublish(uint64_t timestamp, uint16_t msg_id, std::if
 	Subscription &sub = *_subscriptions[msg_id];
 
 	while (sub.next_timestamp / 100 < timestamp && sub.orb_meta) {
-		nextDataMessage(replay_file, sub, msg_id);
+		nextDataMessage(sub);
 	}
 
 	if (!sub.orb_meta) { // no messages anymore
@@ -204,7 +219,7 @@ ReplayEkf2::findTimestampAndPublish(uint64_t timestamp, uint16_t msg_id, std::if
 		return false;
 	}
 
-	readTopicDataToBuffer(sub, replay_file);
+	readTopicDataToBuffer(sub);
 	publishTopic(sub, _read_buffer.data());
 	return true;
 }
@@ -249,6 +264,10 @@ uint64_t
 ReplayEkf2::handleTopicDelay(uint64_t next_file_time, uint64_t timestamp_offset)
 {
 	// no need for usleep
+#if defined(ENABLE_LOCKSTEP_SCHEDULER)
+	// but keep the time in sync with the log
+	advanceTime(next_file_time);
+#endif
 	return next_file_time;
 }
 
@@ -120,9 +120,31 @@ public:
 	 */
 	bool copy(void *dst) { return published() ? _node->copy(dst, _last_generation) : false; }
 
+	/**
+	 * Borrow a reference to the data instead of copying it, see SubscriptionReadGuard.
+	 * @param token Set to identify the borrowed data for borrow_valid().
+	 * @return Pointer to the data, nullptr if not published.
+	 */
+	const void *borrow(DeviceNode::BorrowToken &token) { return published() ? _node->borrow(_last_generation, token) : nullptr; }
+
+	/**
+	 * Check if data returned by borrow() is still unmodified.
+	 */
+	bool borrow_valid(const DeviceNode::BorrowToken &token) const { return valid() && _node->borrow_valid(token); }
+
+	/**
+	 * Mark the data returned by borrow() as read, i.e. advance the subscription.
+	 */
+	void borrow_release(const DeviceNode::BorrowToken &token) { if (valid()) { _node->borrow_release(token, _last_generation); } }
+
 	uint8_t		get_instance() const { return _instance; }
 	orb_id_t	get_topic() const { return _meta; }
 
+	/**
+	 * Generation of the latest copied data (publication count).
+	 */
+	unsigned	get_last_generation() const { return _last_generation; }
+
 protected:
 
 	friend class SubscriptionCallback;
@@ -178,4 +200,86 @@ private:
 	T _data{};
 };
 
+/**
+ * Read-only reference to the latest (or next queued) data of a subscription, without copying it.
+ *
+ * The reference points directly into the queue of the topic. Publishers are not blocked
+ * and eventually overwrite it, so check valid() after reading the data, and fall back to
+ * Subscription::copy() if it fails. Only use this for data that is read in place and
+ * for a short time, e.g.:
+ *
+ *	uORB::SubscriptionReadGuard<vehicle_status_s> status{_vehicle_status_sub};
+ *
+ *	if (status.updated()) {
+ *		const bool armed = (status->arming_state == vehicle_status_s::ARMING_STATE_ARMED);
+ *
+ *		if (status.valid()) {
+ *			...
+ *		}
+ *	}
+ */
+template<class T>
+class SubscriptionReadGuard
+{
+public:
+	/**
+	 * Constructor. Borrows the data the subscription would copy next.
+	 *
+	 * @param subscription The subscription to read, its topic must be of type T.
+	 */
+	explicit SubscriptionReadGuard(Subscription &subscription) :
+		_subscription(subscription)
+	{
+		_updated = _subscription.updated();
+		_data = static_cast<const T *>(_subscription.borrow(_token));
+	}
+
+	~SubscriptionReadGuard() { release(); }
+
+	// no copy, assignment, move, move assignment
+	SubscriptionReadGuard(const SubscriptionReadGuard &) = delete;
+	SubscriptionReadGuard &operator=(const SubscriptionReadGuard &) = delete;
+	SubscriptionReadGuard(SubscriptionReadGuard &&) = delete;
+	SubscriptionReadGuard &operator=(SubscriptionReadGuard &&) = delete;
+
+	/**
+	 * True if the borrowed data was not seen by the subscription before.
+	 */
+	bool updated() const { return _updated && (_data != nullptr); }
+
+	/**
+	 * True if the data is available and was not overwritten yet. Check this after reading the data.
+	 */
+	bool valid()
+	{
+		_validated = (_data != nullptr) && _subscription.borrow_valid(_token);
+		return _validated;
+	}
+
+	/**
+	 * Release the data. The subscription only advances if the data was successfully read, i.e.
+	 * valid() returned true or the data is still unmodified, otherwise the next copy() or
+	 * guard gets it again (or newer data if it was overwritten).
+	 */
+	void release()
+	{
+		if ((_data != nullptr) && (_validated || _subscription.borrow_valid(_token))) {
+			_subscription.borrow_release(_token);
+		}
+
+		_data = nullptr;
+	}
+
+	const T *get() const { return _data; }
+	const T *operator->() const { return _data; }
+	const T &operator*() const { return *_data; }
+
+private:
+	Subscription &_subscription;
+	DeviceNode::BorrowToken _token{};
+	const T *_data{nullptr};
+	bool _updated{false};
+	bool _validated{false};
+};
+
 } // namespace uORB
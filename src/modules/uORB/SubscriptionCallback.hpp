@@ -61,6 +61,8 @@ public:
 	{
 	}
 
+	SubscriptionCallback() = default;
+
 	virtual ~SubscriptionCallback()
 	{
 		unregisterCallback();
@@ -33,6 +33,7 @@
 
 #include "uORBDeviceMaster.hpp"
 #include "uORBDeviceNode.hpp"
+#include "uORBInstrumentation.hpp"
 #include "uORBManager.hpp"
 #include "uORBUtils.hpp"
 
@@ -51,6 +52,8 @@ uORB::DeviceMaster::DeviceMaster()
 
 uORB::DeviceMaster::~DeviceMaster()
 {
+	delete _instrumentation_reporter;
+
 	px4_sem_destroy(&_lock);
 }
 
@@ -135,7 +138,7 @@ uORB::DeviceMaster::advertise(const struct orb_metadata *meta, int *instance, in
 
 		} else {
 			// add to the node map;.
-			_node_list.add(node);
+			addDeviceNodeLocked(node);
 		}
 
 		group_tries++;
@@ -367,16 +370,28 @@ void uORB::DeviceMaster::showTop(char **topic_filter, int num_filters)
 
 			PX4_INFO_RAW("\033[H"); // move cursor home and clear screen
 			PX4_INFO_RAW(CLEAR_LINE "update: 1s, num topics: %i\n", num_topics);
-			PX4_INFO_RAW(CLEAR_LINE "%-*s INST #SUB #MSG #LOST #QSIZE\n", (int)max_topic_name_length - 2, "TOPIC NAME");
+			PX4_INFO_RAW(CLEAR_LINE "%-*s INST #SUB #MSG #LOST #QSIZE%s\n", (int)max_topic_name_length - 2, "TOPIC NAME",
+				     _instrumentation_enabled ? "   LAT(us) P99(us) MAX(us)  LAG CB(us)" : "");
 			cur_node = first_node;
 
 			while (cur_node) {
 
 				if (!print_active_only || cur_node->pub_msg_delta > 0) {
-					PX4_INFO_RAW(CLEAR_LINE "%-*s %2i %4i %4i %5i %i\n", (int)max_topic_name_length,
+					PX4_INFO_RAW(CLEAR_LINE "%-*s %2i %4i %4i %5i %6i", (int)max_topic_name_length,
 						     cur_node->node->get_meta()->o_name, (int)cur_node->node->get_instance(),
 						     (int)cur_node->node->subscriber_count(), cur_node->pub_msg_delta,
 						     (int)cur_node->lost_msg_delta, cur_node->node->get_queue_size());
+
+					const TopicInstrumentation *instr = cur_node->node->instrumentation();
+
+					if (instr != nullptr) {
+						const float lag_mean = (instr->copies > 0) ? (float)instr->lag_sum / instr->copies : 0.f;
+
+						PX4_INFO_RAW(" %9u %7u %7u %4.1f %6u", (unsigned)instr->latency.mean(), (unsigned)instr->latency.percentile(0.99f),
+							     (unsigned)instr->latency.max, (double)lag_mean, (unsigned)instr->callback_time.mean());
+					}
+
+					PX4_INFO_RAW("\n");
 				}
 
 				cur_node = cur_node->next;
@@ -409,6 +424,47 @@ void uORB::DeviceMaster::showTop(char **topic_filter, int num_filters)
 
 #undef CLEAR_LINE
 
+void uORB::DeviceMaster::setInstrumentation(bool enable)
+{
+	lock();
+
+	_instrumentation_enabled = enable;
+
+	for (uORB::DeviceNode *node : _node_list) {
+		node->set_instrumentation(enable);
+	}
+
+	unlock();
+
+	if (enable) {
+		if (_instrumentation_reporter == nullptr) {
+			_instrumentation_reporter = new InstrumentationReporter(*this);
+		}
+
+		if (_instrumentation_reporter != nullptr) {
+			_instrumentation_reporter->start();
+		}
+
+	} else if (_instrumentation_reporter != nullptr) {
+		_instrumentation_reporter->stop();
+	}
+}
+
+uORB::DeviceNode *uORB::DeviceMaster::getNextDeviceNode(uORB::DeviceNode *node)
+{
+	lock();
+
+	uORB::DeviceNode *next = (node != nullptr) ? node->getSibling() : nullptr;
+
+	if (next == nullptr) {
+		next = _node_list.getHead();
+	}
+
+	unlock();
+
+	return next;
+}
+
 uORB::DeviceNode *uORB::DeviceMaster::getDeviceNode(const char *nodepath)
 {
 	lock();
@@ -442,11 +498,42 @@ uORB::DeviceNode *uORB::DeviceMaster::getDeviceNode(const struct orb_metadata *m
 
 uORB::DeviceNode *uORB::DeviceMaster::getDeviceNodeLocked(const struct orb_metadata *meta, const uint8_t instance)
 {
-	for (uORB::DeviceNode *node : _node_list) {
-		if ((strcmp(node->get_name(), meta->o_name) == 0) && (node->get_instance() == instance)) {
+	for (uORB::DeviceNode *node = _node_hash[nodeHash(meta->o_name, instance)]; node != nullptr; node = node->_hash_next) {
+		// the metadata pointer is unique per topic, only compare names if it differs
+		if ((node->get_instance() == instance) &&
+		    ((node->get_meta() == meta) || (strcmp(node->get_name(), meta->o_name) == 0))) {
 			return node;
 		}
 	}
 
 	return nullptr;
 }
+
+void uORB::DeviceMaster::addDeviceNodeLocked(uORB::DeviceNode *node)
+{
+	_node_list.add(node);
+
+	if (_instrumentation_enabled) {
+		node->set_instrumentation(true);
+	}
+
+	const unsigned bucket = nodeHash(node->get_name(), node->get_instance());
+	node->_hash_next = _node_hash[bucket];
+	_node_hash[bucket] = node;
+}
+
+unsigned uORB::DeviceMaster::nodeHash(const char *name, const uint8_t instance)
+{
+	static_assert((NODE_HASH_BUCKETS & (NODE_HASH_BUCKETS - 1)) == 0, "NODE_HASH_BUCKETS must be a power of 2");
+
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+
+	for (const char *c = name; *c != '\0'; ++c) {
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	}
+
+	hash = (hash ^ instance) * 16777619u;
+
+	return hash & (NODE_HASH_BUCKETS - 1);
+}
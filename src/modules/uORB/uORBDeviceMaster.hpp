@@ -42,6 +42,7 @@ namespace uORB
 {
 class DeviceNode;
 class DeviceMaster;
+class InstrumentationReporter;
 class Manager;
 }
 
@@ -84,6 +85,21 @@ public:
 	 */
 	void showTop(char **topic_filter, int num_filters);
 
+	/**
+	 * Enable or disable the latency and rate instrumentation of all topics,
+	 * and the publication of uorb_topic_statistics.
+	 */
+	void setInstrumentation(bool enable);
+
+	bool instrumentationEnabled() const { return _instrumentation_enabled; }
+
+	/**
+	 * Iterate over all nodes, wrapping around at the end.
+	 * @param node previous node, nullptr to start at the beginning
+	 * @return next node, nullptr if there are no nodes
+	 */
+	uORB::DeviceNode *getNextDeviceNode(uORB::DeviceNode *node);
+
 private:
 	// Private constructor, uORB::Manager takes care of its creation
 	DeviceMaster();
@@ -110,10 +126,37 @@ private:
 	 */
 	uORB::DeviceNode *getDeviceNodeLocked(const struct orb_metadata *meta, const uint8_t instance);
 
+	/**
+	 * Add a new node to the node list and the lookup index.
+	 * _lock must already be held when calling this.
+	 */
+	void addDeviceNodeLocked(uORB::DeviceNode *node);
+
+	/**
+	 * Bucket of a node in the lookup index.
+	 */
+	static unsigned nodeHash(const char *name, const uint8_t instance);
+
 	List<uORB::DeviceNode *> _node_list;
 
+#ifdef __PX4_NUTTX
+	static constexpr unsigned NODE_HASH_BUCKETS = 64; ///< must be a power of 2
+#else
+	static constexpr unsigned NODE_HASH_BUCKETS = 256; ///< must be a power of 2
+#endif
+
+	/**
+	 * Index over _node_list keyed by topic name and instance, so that lookups do not
+	 * have to walk all nodes. Buckets are chained through DeviceNode::_hash_next.
+	 * Like _node_list, nodes are never removed.
+	 */
+	uORB::DeviceNode *_node_hash[NODE_HASH_BUCKETS] {};
+
 	hrt_abstime       _last_statistics_output;
 
+	bool _instrumentation_enabled{false};
+	InstrumentationReporter *_instrumentation_reporter{nullptr};
+
 	px4_sem_t	_lock; /**< lock to protect access to all class members (also for derived classes) */
 
 	void		lock() { do {} while (px4_sem_wait(&_lock) != 0); }
@@ -35,6 +35,7 @@
 
 #include "uORBUtils.hpp"
 #include "uORBManager.hpp"
+#include "uORBInstrumentation.hpp"
 
 #include "SubscriptionCallback.hpp"
 
@@ -67,6 +68,14 @@ uORB::DeviceNode::DeviceNode(const struct orb_metadata *meta, const uint8_t inst
 uORB::DeviceNode::~DeviceNode()
 {
 	delete[] _data;
+	delete _instrumentation;
+
+	while (_retired_data != nullptr) {
+		RetiredBuffer *next = _retired_data->next;
+		delete[] _retired_data->data;
+		delete _retired_data;
+		_retired_data = next;
+	}
 
 	CDev::unregister_driver_and_memory();
 }
@@ -162,6 +171,48 @@ uORB::DeviceNode::close(cdev::file_t *filp)
 	return CDev::close(filp);
 }
 
+unsigned
+uORB::DeviceNode::select_element(const unsigned current_generation, const unsigned queue_size, unsigned &generation,
+				  uint32_t &lost_messages) const
+{
+	lost_messages = 0;
+
+	if (current_generation > generation + queue_size) {
+		// Reader is too far behind: some messages are lost
+		lost_messages = current_generation - (generation + queue_size);
+		generation = current_generation - queue_size;
+	}
+
+	if ((current_generation == generation) && (generation > 0)) {
+		/* The subscriber already read the latest message, but nothing new was published yet.
+		 * Return the previous message
+		 */
+		--generation;
+	}
+
+	const unsigned element = generation;
+
+	if (generation < current_generation) {
+		++generation;
+	}
+
+	return element;
+}
+
+uint32_t
+uORB::DeviceNode::copy_element(void *dst, unsigned &generation) const
+{
+	unsigned queue_size;
+	const uint8_t *data = queue_snapshot(queue_size);
+
+	uint32_t lost_messages;
+	const unsigned element = select_element(_generation, queue_size, generation, lost_messages);
+
+	memcpy(dst, data + (_meta->o_size * (element % queue_size)), _meta->o_size);
+
+	return lost_messages;
+}
+
 bool
 uORB::DeviceNode::copy_locked(void *dst, unsigned &generation)
 {
@@ -169,23 +220,18 @@ uORB::DeviceNode::copy_locked(void *dst, unsigned &generation)
 
 	if ((dst != nullptr) && (_data != nullptr)) {
 
-		if (_generation > generation + _queue_size) {
-			// Reader is too far behind: some messages are lost
-			_lost_messages += _generation - (generation + _queue_size);
-			generation = _generation - _queue_size;
-		}
+		const unsigned previous_generation = generation;
+		const uint32_t lost_messages = copy_element(dst, generation);
 
-		if ((_generation == generation) && (generation > 0)) {
-			/* The subscriber already read the latest message, but nothing new was published yet.
-			 * Return the previous message
-			 */
-			--generation;
+		if (lost_messages > 0) {
+			_lost_messages.fetch_add(lost_messages);
 		}
 
-		memcpy(dst, _data + (_meta->o_size * (generation % _queue_size)), _meta->o_size);
+		TopicInstrumentation *instr = instrumentation();
 
-		if (generation < _generation) {
-			++generation;
+		// only record new data, not a re-copy of the latest sample
+		if ((instr != nullptr) && (generation != previous_generation)) {
+			instr->record_copy(_generation - generation, _last_update);
 		}
 
 		updated = true;
@@ -194,9 +240,72 @@ uORB::DeviceNode::copy_locked(void *dst, unsigned &generation)
 	return updated;
 }
 
+#ifdef ORB_USE_SEQLOCK
+bool
+uORB::DeviceNode::copy_seqlock(void *dst, unsigned &generation, hrt_abstime *last_update)
+{
+	if ((dst == nullptr) || (_data == nullptr)) {
+		return false;
+	}
+
+	for (int attempt = 0; attempt < SEQLOCK_MAX_RETRIES; attempt++) {
+		const unsigned seq = _seq.load();
+
+		if (seq & 1) {
+			// publication in progress
+			continue;
+		}
+
+		unsigned copy_generation = generation;
+		const uint32_t lost_messages = copy_element(dst, copy_generation);
+		const hrt_abstime update_time = _last_update;
+
+		// order the data reads before re-reading the sequence counter
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (_seq.load() == seq) {
+			if (last_update != nullptr) {
+				*last_update = update_time;
+			}
+
+			if (lost_messages > 0) {
+				_lost_messages.fetch_add(lost_messages);
+			}
+
+			TopicInstrumentation *instr = instrumentation();
+
+			// only record new data, not a re-copy of the latest sample
+			if ((instr != nullptr) && (copy_generation != generation)) {
+				instr->record_copy(_generation - copy_generation, update_time);
+			}
+
+			generation = copy_generation;
+
+			return true;
+		}
+	}
+
+	// heavily contended (or the publisher got preempted): block on the publisher lock
+	lock();
+
+	if (last_update != nullptr) {
+		*last_update = _last_update;
+	}
+
+	const bool updated = copy_locked(dst, generation);
+
+	unlock();
+
+	return updated;
+}
+#endif /* ORB_USE_SEQLOCK */
+
 bool
 uORB::DeviceNode::copy(void *dst, unsigned &generation)
 {
+#ifdef ORB_USE_SEQLOCK
+	return copy_seqlock(dst, generation, nullptr);
+#else
 	ATOMIC_ENTER;
 
 	bool updated = copy_locked(dst, generation);
@@ -204,21 +313,111 @@ uORB::DeviceNode::copy(void *dst, unsigned &generation)
 	ATOMIC_LEAVE;
 
 	return updated;
+#endif /* ORB_USE_SEQLOCK */
 }
 
 uint64_t
 uORB::DeviceNode::copy_and_get_timestamp(void *dst, unsigned &generation)
 {
+#ifdef ORB_USE_SEQLOCK
+	hrt_abstime update_time = 0;
+	copy_seqlock(dst, generation, &update_time);
+#else
 	ATOMIC_ENTER;
 
 	const hrt_abstime update_time = _last_update;
 	copy_locked(dst, generation);
 
 	ATOMIC_LEAVE;
+#endif /* ORB_USE_SEQLOCK */
 
 	return update_time;
 }
 
+const void *
+uORB::DeviceNode::borrow(const unsigned generation, BorrowToken &token)
+{
+	if (_data == nullptr) {
+		return nullptr;
+	}
+
+	unsigned current_generation;
+	unsigned publications;
+
+#ifdef ORB_USE_SEQLOCK
+	bool consistent = false;
+
+	for (int attempt = 0; attempt < SEQLOCK_MAX_RETRIES && !consistent; attempt++) {
+		publications = _seq.load();
+		current_generation = _generation;
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		consistent = ((publications & 1) == 0) && (_seq.load() == publications);
+	}
+
+	if (!consistent) {
+		// a publication is in progress: wait for it to complete
+		lock();
+		publications = _seq.load();
+		current_generation = _generation;
+		unlock();
+	}
+
+#else
+	ATOMIC_ENTER;
+	current_generation = _generation;
+	ATOMIC_LEAVE;
+
+	publications = current_generation;
+#endif /* ORB_USE_SEQLOCK */
+
+	unsigned queue_size;
+	const uint8_t *data = queue_snapshot(queue_size);
+
+	// the subscriber only advances in borrow_release()
+	token.generation = generation;
+	token.next_generation = generation;
+	const unsigned element = select_element(current_generation, queue_size, token.next_generation, token.lost_messages);
+
+	// the element gets overwritten by the publication of generation (element + queue_size)
+	token.publications = publications;
+	token.slack = element + queue_size - current_generation;
+
+	return data + (_meta->o_size * (element % queue_size));
+}
+
+void
+uORB::DeviceNode::borrow_release(const BorrowToken &token, unsigned &generation)
+{
+	// nothing to do if the subscriber copied (and advanced) in the meantime
+	if (generation != token.generation) {
+		return;
+	}
+
+	if (token.lost_messages > 0) {
+		_lost_messages.fetch_add(token.lost_messages);
+	}
+
+	generation = token.next_generation;
+}
+
+bool
+uORB::DeviceNode::borrow_valid(const BorrowToken &token) const
+{
+	// order the reads of the borrowed data before the check
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+#ifdef ORB_USE_SEQLOCK
+	// publications started since the borrow (the sequence counter is incremented twice per publication)
+	const unsigned started = (_seq.load() - token.publications + 1) / 2;
+#else
+	const unsigned started = _generation - token.publications;
+#endif /* ORB_USE_SEQLOCK */
+
+	return started <= token.slack;
+}
+
 ssize_t
 uORB::DeviceNode::read(cdev::file_t *filp, char *buffer, size_t buflen)
 {
@@ -237,6 +436,16 @@ uORB::DeviceNode::read(cdev::file_t *filp, char *buffer, size_t buflen)
 	/*
 	 * Perform an atomic copy & state update
 	 */
+#ifdef ORB_USE_SEQLOCK
+	hrt_abstime update_time = 0;
+	copy_seqlock(buffer, sd->generation, &update_time);
+
+	// if subscriber has an interval track the last update time
+	if (sd->update_interval) {
+		sd->update_interval->last_update = update_time;
+	}
+
+#else
 	ATOMIC_ENTER;
 
 	copy_locked(buffer, sd->generation);
@@ -247,6 +456,7 @@ uORB::DeviceNode::read(cdev::file_t *filp, char *buffer, size_t buflen)
 	}
 
 	ATOMIC_LEAVE;
+#endif /* ORB_USE_SEQLOCK */
 
 	return _meta->o_size;
 }
@@ -297,6 +507,13 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 
 	/* Perform an atomic copy. */
 	ATOMIC_ENTER;
+
+#ifdef ORB_USE_SEQLOCK
+	/* publishers are serialized by ATOMIC_ENTER, readers validate against the sequence counter */
+	_seq.fetch_add(1);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif /* ORB_USE_SEQLOCK */
+
 	memcpy(_data + (_meta->o_size * (_generation % _queue_size)), buffer, _meta->o_size);
 
 	/* update the timestamp and generation count */
@@ -304,6 +521,10 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 	/* wrap-around happens after ~49 days, assuming a publisher rate of 1 kHz */
 	_generation++;
 
+#ifdef ORB_USE_SEQLOCK
+	_seq.fetch_add(1);
+#endif /* ORB_USE_SEQLOCK */
+
 	_published = true;
 
 	// callbacks
@@ -311,6 +532,12 @@ uORB::DeviceNode::write(cdev::file_t *filp, const char *buffer, size_t buflen)
 		item->call();
 	}
 
+	TopicInstrumentation *instr = instrumentation();
+
+	if ((instr != nullptr) && !_callbacks.empty()) {
+		instr->record_callbacks(hrt_elapsed_time(&_last_update));
+	}
+
 	ATOMIC_LEAVE;
 
 	/* notify any poll waiters */
@@ -378,8 +605,6 @@ uORB::DeviceNode::ioctl(cdev::file_t *filp, int cmd, unsigned long arg)
 		return PX4_OK;
 
 	case ORBIOCSETQUEUESIZE:
-		//no need for locking here, since this is used only during the advertisement call,
-		//and only one advertiser is allowed to open the DeviceNode at the same time.
 		return update_queue_size(arg);
 
 	case ORBIOCGETINTERVAL:
@@ -551,16 +776,16 @@ uORB::DeviceNode::appears_updated(SubscriberData *sd)
 bool
 uORB::DeviceNode::print_statistics(bool reset)
 {
-	if (!_lost_messages) {
+	if (_lost_messages.load() == 0) {
 		return false;
 	}
 
 	lock();
 	//This can be wrong: if a reader never reads, _lost_messages will not be increased either
-	uint32_t lost_messages = _lost_messages;
+	uint32_t lost_messages = _lost_messages.load();
 
 	if (reset) {
-		_lost_messages = 0;
+		_lost_messages.store(0);
 	}
 
 	unlock();
@@ -660,14 +885,95 @@ int uORB::DeviceNode::update_queue_size(unsigned int queue_size)
 	}
 
 	//queue size is limited to 255 for the single reason that we use uint8 to store it
-	if (_data || _queue_size > queue_size || queue_size > 255) {
+	if (_queue_size > queue_size || queue_size > 255) {
 		return PX4_ERROR;
 	}
 
+	lock();
+
+	if (_data == nullptr) {
+		// not published yet, the buffer gets allocated with the new size
+		_queue_size = queue_size;
+		unlock();
+		return PX4_OK;
+	}
+
+	unlock();
+
+	// already published: move the queued samples into a larger buffer
+	uint8_t *data = new uint8_t[_meta->o_size * queue_size];
+	RetiredBuffer *retired = new RetiredBuffer;
+
+	if ((data == nullptr) || (retired == nullptr)) {
+		delete[] data;
+		delete retired;
+		return PX4_ERROR;
+	}
+
+	ATOMIC_ENTER;
+
+	if (_queue_size >= queue_size) {
+		// enlarged concurrently
+		ATOMIC_LEAVE;
+		delete[] data;
+		delete retired;
+		return PX4_OK;
+	}
+
+#ifdef ORB_USE_SEQLOCK
+	// lock-free readers retry (or validate their borrow) against the new buffer
+	_seq.fetch_add(1);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+#endif /* ORB_USE_SEQLOCK */
+
+	// every sample keeps its generation, so subscribers don't notice the change
+	const unsigned old_queue_size = _queue_size;
+	const unsigned num_samples = (old_queue_size < _generation) ? old_queue_size : _generation;
+
+	for (unsigned generation = _generation - num_samples; generation != _generation; generation++) {
+		memcpy(data + (_meta->o_size * (generation % queue_size)),
+		       _data + (_meta->o_size * (generation % old_queue_size)), _meta->o_size);
+	}
+
+	// a reader that sees the new size also sees the new buffer (see queue_snapshot())
+	retired->data = _data;
+	retired->next = _retired_data;
+	_retired_data = retired;
+	_data = data;
+	__atomic_thread_fence(__ATOMIC_RELEASE);
 	_queue_size = queue_size;
+
+#ifdef ORB_USE_SEQLOCK
+	_seq.fetch_add(1);
+#endif /* ORB_USE_SEQLOCK */
+
+	ATOMIC_LEAVE;
+
 	return PX4_OK;
 }
 
+void
+uORB::DeviceNode::set_instrumentation(bool enable)
+{
+	lock();
+
+	if (enable) {
+		if (_instrumentation == nullptr) {
+			_instrumentation = new TopicInstrumentation();
+
+		} else {
+			_instrumentation->reset();
+		}
+
+		_instrumentation_enabled = (_instrumentation != nullptr);
+
+	} else {
+		_instrumentation_enabled = false;
+	}
+
+	unlock();
+}
+
 bool
 uORB::DeviceNode::register_callback(uORB::SubscriptionCallback *callback_sub)
 {
@@ -39,6 +39,17 @@
 #include <lib/cdev/CDev.hpp>
 
 #include <containers/List.hpp>
+#include <px4_platform_common/atomic.h>
+
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+/**
+ * Copy topic data with a sequence lock (seqlock) instead of ATOMIC_ENTER/ATOMIC_LEAVE.
+ * Readers never take a lock: they validate the copy against the publication sequence
+ * counter and retry if it was torn by a concurrent publication.
+ * Not used on NuttX, where publications may happen from interrupt context.
+ */
+#define ORB_USE_SEQLOCK
+#endif
 
 namespace uORB
 {
@@ -46,6 +57,7 @@ class DeviceNode;
 class DeviceMaster;
 class Manager;
 class SubscriptionCallback;
+struct TopicInstrumentation;
 }
 
 /**
@@ -164,9 +176,9 @@ public:
 	bool is_published() const { return _published; }
 
 	/**
-	 * Try to change the size of the queue. This can only be done as long as nobody published yet.
-	 * This is the case, for example when orb_subscribe was called before an orb_advertise.
-	 * The queue size can only be increased.
+	 * Try to change the size of the queue. The queue size can only be increased.
+	 * If the topic was already published, the buffer is reallocated and the queued
+	 * samples are kept (up to the old queue size), so subscribers continue where they were.
 	 * @param queue_size new size of the queue
 	 * @return PX4_OK if queue size successfully set
 	 */
@@ -183,7 +195,7 @@ public:
 
 	int8_t subscriber_count() const { return _subscriber_count; }
 
-	uint32_t lost_message_count() const { return _lost_messages; }
+	uint32_t lost_message_count() const { return _lost_messages.load(); }
 
 	unsigned published_message_count() const { return _generation; }
 
@@ -224,6 +236,60 @@ public:
 	 */
 	uint64_t copy_and_get_timestamp(void *dst, unsigned &generation);
 
+	/**
+	 * Identifies a borrowed queue element, see borrow().
+	 */
+	struct BorrowToken {
+		unsigned generation{0}; /**< generation of the subscriber at the time of the borrow */
+		unsigned next_generation{0}; /**< generation of the subscriber after reading the element */
+		uint32_t lost_messages{0}; /**< messages the subscriber lost */
+		unsigned publications{0}; /**< publication counter at the time of the borrow */
+		unsigned slack{0}; /**< number of further publications that leave the element untouched */
+	};
+
+	/**
+	 * Get a reference to the queue element a subscriber would copy next, without copying it.
+	 * Publishers are not blocked: the element gets overwritten once the queue wraps around,
+	 * so the data must be validated with borrow_valid() after reading it.
+	 * The generation of the subscriber is not modified, see borrow_release().
+	 *
+	 * @param generation
+	 *   The generation of the subscriber.
+	 * @param token
+	 *   Set to identify the borrowed element for borrow_valid() and borrow_release().
+	 * @return
+	 *   Pointer to the data, nullptr if nothing was published yet.
+	 */
+	const void *borrow(const unsigned generation, BorrowToken &token);
+
+	/**
+	 * Mark the borrowed element as read: advance the generation like copy() does.
+	 * Does nothing if the generation changed since the borrow (e.g. the subscriber fell back to copy()).
+	 *
+	 * @param token
+	 *   The token returned by borrow().
+	 * @param generation
+	 *   The generation of the subscriber.
+	 */
+	void borrow_release(const BorrowToken &token, unsigned &generation);
+
+	/**
+	 * Check if the data returned by borrow() is still unmodified.
+	 * Call this after reading the borrowed data.
+	 */
+	bool borrow_valid(const BorrowToken &token) const;
+
+	/**
+	 * Enable or disable the latency and rate instrumentation of this node.
+	 * The statistics are reset when enabled.
+	 */
+	void set_instrumentation(bool enable);
+
+	/**
+	 * @return instrumentation data, nullptr if instrumentation is disabled
+	 */
+	TopicInstrumentation *instrumentation() const { return _instrumentation_enabled ? _instrumentation : nullptr; }
+
 	// add item to list of work items to schedule on node update
 	bool register_callback(SubscriptionCallback *callback_sub);
 
@@ -237,6 +303,7 @@ protected:
 	void poll_notify_one(px4_pollfd_struct_t *fds, pollevent_t events) override;
 
 private:
+	friend class DeviceMaster;
 
 	/**
 	 * Copies data and the corresponding generation
@@ -251,6 +318,69 @@ private:
 	 */
 	bool copy_locked(void *dst, unsigned &generation);
 
+	/**
+	 * Select the queue element a subscriber reads next and advance its generation.
+	 *
+	 * @param current_generation
+	 *   The generation of the node.
+	 * @param queue_size
+	 *   The queue size (a snapshot, see queue_snapshot()).
+	 * @param generation
+	 *   The generation of the subscriber.
+	 * @param lost_messages
+	 *   Set to the number of messages the subscriber lost.
+	 * @return unsigned
+	 *   The generation of the selected queue element.
+	 */
+	unsigned select_element(const unsigned current_generation, const unsigned queue_size, unsigned &generation,
+				uint32_t &lost_messages) const;
+
+	/**
+	 * Read the queue size and buffer for lock-free readers. update_queue_size() only enlarges the
+	 * queue and publishes the new buffer before the new size, so the buffer is always at least
+	 * queue_size elements large.
+	 * @return the buffer
+	 */
+	const uint8_t *queue_snapshot(unsigned &queue_size) const
+	{
+		queue_size = _queue_size;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		return _data;
+	}
+
+	/**
+	 * Copies the queue element for the given generation and advances the generation.
+	 * The caller must make sure the data is not modified concurrently (or validate the copy).
+	 *
+	 * @param dst
+	 *   The buffer into which the data is copied.
+	 * @param generation
+	 *   The generation that was copied.
+	 * @return uint32_t
+	 *   The number of messages the reader lost.
+	 */
+	uint32_t copy_element(void *dst, unsigned &generation) const;
+
+#ifdef ORB_USE_SEQLOCK
+	/**
+	 * Lock-free variant of copy_locked(). The copy is validated against the
+	 * publication sequence counter and retried if a publication happened meanwhile.
+	 * Falls back to the publisher lock if the copy keeps getting torn.
+	 *
+	 * @param dst
+	 *   The buffer into which the data is copied.
+	 * @param generation
+	 *   The generation that was copied.
+	 * @param last_update
+	 *   If not null, set to the publication time of the copied data.
+	 * @return bool
+	 *   Returns true if the data was copied.
+	 */
+	bool copy_seqlock(void *dst, unsigned &generation, hrt_abstime *last_update);
+
+	static constexpr int SEQLOCK_MAX_RETRIES = 8; /**< lock-free attempts before falling back to lock() */
+#endif /* ORB_USE_SEQLOCK */
+
 	struct UpdateIntervalData {
 		uint64_t last_update{0}; /**< time at which the last update was provided, used when update_interval is nonzero */
 		unsigned interval{0}; /**< if nonzero minimum interval between updates */
@@ -266,19 +396,35 @@ private:
 	const orb_metadata *_meta; /**< object metadata information */
 	const uint8_t _instance; /**< orb multi instance identifier */
 	uint8_t     *_data{nullptr};   /**< allocated object buffer */
+
+	struct RetiredBuffer {
+		uint8_t *data;
+		RetiredBuffer *next;
+	};
+
+	/** buffers replaced by update_queue_size(). Lock-free readers and borrows might still access them, freed with the node. */
+	RetiredBuffer *_retired_data{nullptr};
 	hrt_abstime   _last_update{0}; /**< time the object was last updated */
 	volatile unsigned   _generation{0};  /**< object generation count */
 	List<uORB::SubscriptionCallback *>	_callbacks;
+#ifdef ORB_USE_SEQLOCK
+	px4::atomic<unsigned> _seq{0}; /**< publication sequence counter, odd while a publication is in progress */
+#endif /* ORB_USE_SEQLOCK */
 	uint8_t   _priority;  /**< priority of the topic */
 	bool _published{false};  /**< has ever data been published */
 	uint8_t _queue_size; /**< maximum number of elements in the queue */
 	int8_t _subscriber_count{0};
 
+	TopicInstrumentation *_instrumentation{nullptr}; /**< allocated on first use, kept (and reset) when disabled */
+	volatile bool _instrumentation_enabled{false};
+
+	uORB::DeviceNode *_hash_next{nullptr}; /**< next node in the same DeviceMaster lookup bucket */
+
 	px4_task_t _publisher{0}; /**< if nonzero, current publisher. Only used inside the advertise call.
 						We allow one publisher to have an open file descriptor at the same time. */
 
 	// statistics
-	uint32_t _lost_messages = 0; /**< nr of lost messages for all subscribers. If two subscribers lose the same
+	px4::atomic<uint32_t> _lost_messages{0}; /**< nr of lost messages for all subscribers. If two subscribers lose the same
 					message, it is counted as two. */
 
 	inline static SubscriberData    *filp_to_sd(cdev::file_t *filp);
@@ -0,0 +1,145 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "uORBInstrumentation.hpp"
+
+#include "uORBDeviceMaster.hpp"
+#include "uORBDeviceNode.hpp"
+
+#include <string.h>
+
+namespace uORB
+{
+
+static inline void atomic_add(uint32_t *value, uint32_t num)
+{
+	__atomic_fetch_add(value, num, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_max(uint32_t *value, uint32_t sample)
+{
+	uint32_t current = *value;
+
+	while ((sample > current) && !__atomic_compare_exchange_n(value, &current, sample, true, __ATOMIC_RELAXED,
+			__ATOMIC_RELAXED)) {
+	}
+}
+
+void TopicInstrumentation::reset()
+{
+	copies = 0;
+	latency.reset();
+	lag_sum = 0;
+	lag_max = 0;
+	callback_time.reset();
+	last_report_generation = 0;
+	last_report_time = 0;
+}
+
+void TopicInstrumentation::record_copy(unsigned lag, hrt_abstime update_time)
+{
+	atomic_add(&copies, 1);
+	atomic_add(&lag_sum, lag);
+	atomic_max(&lag_max, lag);
+
+	if (lag == 0) {
+		// the queue has no per-element timestamps, so only the latency of the latest sample is known
+		latency.record(hrt_elapsed_time(&update_time));
+	}
+}
+
+InstrumentationReporter::InstrumentationReporter(DeviceMaster &device_master) :
+	StatisticsReporter(MODULE_NAME),
+	_device_master(device_master)
+{
+}
+
+void InstrumentationReporter::Run()
+{
+	DeviceNode *node = _device_master.getNextDeviceNode(_last_node);
+
+	if (node == nullptr) {
+		return;
+	}
+
+	_last_node = node;
+
+	TopicInstrumentation *instrumentation = node->instrumentation();
+	const unsigned generation = node->published_message_count();
+
+	if ((instrumentation == nullptr) || (generation == 0)) {
+		return;
+	}
+
+	static_assert(sizeof(uorb_topic_statistics_s::latency_histogram) == sizeof(instrumentation->latency.bins),
+		      "uorb_topic_statistics latency_histogram size mismatch");
+
+	const hrt_abstime now = hrt_absolute_time();
+
+	uorb_topic_statistics_s report{};
+	strncpy((char *)report.topic_name, node->get_name(), sizeof(report.topic_name) - 1);
+	report.instance = node->get_instance();
+	report.subscriber_count = node->subscriber_count();
+	report.queue_size = node->get_queue_size();
+
+	if ((instrumentation->last_report_time != 0) && (now > instrumentation->last_report_time)) {
+		report.publish_rate = (generation - instrumentation->last_report_generation)
+				      / ((now - instrumentation->last_report_time) * 1e-6f);
+	}
+
+	instrumentation->last_report_generation = generation;
+	instrumentation->last_report_time = now;
+
+	report.lost_messages = node->lost_message_count();
+	report.copies = instrumentation->copies;
+
+	report.latency_mean = instrumentation->latency.mean();
+	report.latency_p99 = instrumentation->latency.percentile(0.99f);
+	report.latency_max = instrumentation->latency.max;
+	memcpy(report.latency_histogram, instrumentation->latency.bins, sizeof(report.latency_histogram));
+
+	if (instrumentation->copies > 0) {
+		report.lag_mean = (float)instrumentation->lag_sum / instrumentation->copies;
+	}
+
+	report.lag_max = instrumentation->lag_max;
+
+	report.callbacks = instrumentation->callback_time.count;
+	report.callback_time_mean = instrumentation->callback_time.mean();
+	report.callback_time_max = instrumentation->callback_time.max;
+
+	report.timestamp = hrt_absolute_time();
+	_topic_statistics_pub.publish(report);
+}
+
+} // namespace uORB
@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file uORBInstrumentation.hpp
+ *
+ * Optional per-topic latency and rate instrumentation (uorb instrument).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <drivers/drv_hrt.h>
+#include <px4_platform_common/px4_work_queue/DurationHistogram.hpp>
+#include <px4_platform_common/px4_work_queue/StatisticsReporter.hpp>
+#include <uORB/PublicationQueued.hpp>
+#include <uORB/topics/uorb_topic_statistics.h>
+
+namespace uORB
+{
+class DeviceMaster;
+class DeviceNode;
+
+/**
+ * Statistics of a single DeviceNode, recorded while instrumentation is enabled.
+ *
+ * The counters are updated concurrently by all publishers and subscribers of the topic
+ * with relaxed atomic operations, so they are only approximately consistent with each other.
+ */
+struct TopicInstrumentation {
+	uint32_t copies{0};
+
+	px4::DurationHistogram latency; ///< publish to copy
+
+	uint32_t lag_sum{0};
+	uint32_t lag_max{0};
+
+	px4::DurationHistogram callback_time; ///< dispatch of the callbacks of a publication
+
+	// only used by the reporter
+	unsigned last_report_generation{0};
+	hrt_abstime last_report_time{0};
+
+	void reset();
+
+	/**
+	 * Record a subscriber copy of a new generation (re-copies of already seen data are not recorded).
+	 * @param lag number of generations the subscriber is behind after the copy
+	 * @param update_time publication time of the latest sample, the latency is only recorded if lag is 0
+	 */
+	void record_copy(unsigned lag, hrt_abstime update_time);
+
+	/**
+	 * Record the time it took to dispatch the callbacks of a publication.
+	 */
+	void record_callbacks(hrt_abstime elapsed) { callback_time.record(elapsed); }
+};
+
+/**
+ * Publishes the instrumentation of all topics as uorb_topic_statistics, one topic per cycle.
+ */
+class InstrumentationReporter : public px4::StatisticsReporter
+{
+public:
+	explicit InstrumentationReporter(DeviceMaster &device_master);
+	~InstrumentationReporter() override = default;
+
+private:
+	void Run() override;
+
+	DeviceMaster &_device_master;
+	DeviceNode *_last_node{nullptr};
+
+	uORB::PublicationQueued<uorb_topic_statistics_s> _topic_statistics_pub{ORB_ID(uorb_topic_statistics)};
+};
+
+} // namespace uORB
@@ -71,6 +71,10 @@ modules are allowed to publish which topics. This is used for system-wide replay
 ### Examples
 Monitor topic publication rates. Besides `top`, this is an important command for general system inspection:
 $ uorb top
+
+Measure publish to copy latency, subscriber lag and callback dispatch time of all topics, shown by `uorb top`
+and published as uorb_topic_statistics (which can be logged):
+$ uorb instrument start
 )DESCR_STR");
 
 	PRINT_MODULE_USAGE_NAME("uorb", "communication");
@@ -80,6 +84,8 @@ $ uorb top
 	PRINT_MODULE_USAGE_PARAM_FLAG('a', "print all instead of only currently publishing topics", true);
 	PRINT_MODULE_USAGE_PARAM_FLAG('1', "run only once, then exit", true);
 	PRINT_MODULE_USAGE_ARG("<filter1> [<filter2>]", "topic(s) to match (implies -a)", true);
+	PRINT_MODULE_USAGE_COMMAND_DESCR("instrument", "Enable or disable latency instrumentation of all topics");
+	PRINT_MODULE_USAGE_ARG("start|stop", "Enable or disable", false);
 }
 
 int
@@ -137,6 +143,22 @@ uorb_main(int argc, char *argv[])
 		return OK;
 	}
 
+	if (!strcmp(argv[1], "instrument")) {
+		if (g_dev == nullptr) {
+			PX4_INFO("uorb is not running");
+			return OK;
+		}
+
+		if (argc > 2 && !strcmp(argv[2], "start")) {
+			g_dev->setInstrumentation(true);
+			return OK;
+
+		} else if (argc > 2 && !strcmp(argv[2], "stop")) {
+			g_dev->setInstrumentation(false);
+			return OK;
+		}
+	}
+
 	if (!strcmp(argv[1], "top")) {
 		if (g_dev != nullptr) {
 			g_dev->showTop(argv + 2, argc - 2);
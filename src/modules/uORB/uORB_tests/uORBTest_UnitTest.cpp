@@ -33,6 +33,8 @@
 
 #include "uORBTest_UnitTest.hpp"
 #include "../uORBCommon.hpp"
+#include "../Subscription.hpp"
+#include "../uORBTopics.h"
 #include <px4_platform_common/px4_config.h>
 #include <px4_platform_common/time.h>
 #include <stdio.h>
@@ -52,9 +54,12 @@ ORB_DEFINE(orb_test_medium_queue, struct orb_test_medium, sizeof(orb_test_medium
 	   "ORB_TEST_MEDIUM_MULTI:int val;hrt_abstime time;char[64] junk;");
 ORB_DEFINE(orb_test_medium_queue_poll, struct orb_test_medium, sizeof(orb_test_medium),
 	   "ORB_TEST_MEDIUM_MULTI:int val;hrt_abstime time;char[64] junk;");
+ORB_DEFINE(orb_test_medium_queue_resize, struct orb_test_medium, sizeof(orb_test_medium),
+	   "ORB_TEST_MEDIUM_MULTI:int val;hrt_abstime time;char[64] junk;");
 
 ORB_DEFINE(orb_test_large, struct orb_test_large, sizeof(orb_test_large),
 	   "ORB_TEST_LARGE:int val;hrt_abstime time;char[512] junk;");
+ORB_DEFINE(orb_test_lookup, struct orb_test, sizeof(orb_test), "ORB_TEST_LOOKUP:int val;hrt_abstime time;");
 
 uORBTest::UnitTest &uORBTest::UnitTest::instance()
 {
@@ -224,7 +229,19 @@ int uORBTest::UnitTest::test()
 		return ret;
 	}
 
-	return test_queue_poll_notify();
+	ret = test_queue_poll_notify();
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	ret = test_queue_resize();
+
+	if (ret != OK) {
+		return ret;
+	}
+
+	return test_borrow();
 }
 
 int uORBTest::UnitTest::test_unadvertise()
@@ -736,6 +753,87 @@ int uORBTest::UnitTest::test_queue()
 }
 
 
+int uORBTest::UnitTest::test_queue_resize()
+{
+	test_note("Testing orb queue enlargement after publication");
+
+	struct orb_test_medium t {}, u {};
+	bool updated;
+
+	int sfd = orb_subscribe(ORB_ID(orb_test_medium_queue_resize));
+
+	if (sfd < 0) {
+		return test_fail("subscribe failed: %d", errno);
+	}
+
+	// single element queue
+	t.val = 0;
+	orb_advert_t ptopic = orb_advertise(ORB_ID(orb_test_medium_queue_resize), &t);
+
+	if (ptopic == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	orb_copy(ORB_ID(orb_test_medium_queue_resize), sfd, &u);
+
+	t.val = 1;
+	orb_publish(ORB_ID(orb_test_medium_queue_resize), ptopic, &t);
+
+	const int queue_size = 8;
+
+	if (px4_ioctl(sfd, ORBIOCSETQUEUESIZE, queue_size) != PX4_OK) {
+		return test_fail("enlarging the queue failed");
+	}
+
+	if (px4_ioctl(sfd, ORBIOCSETQUEUESIZE, queue_size / 2) == PX4_OK) {
+		return test_fail("shrinking the queue succeeded");
+	}
+
+	// the sample published before the enlargement is still there
+	orb_check(sfd, &updated);
+
+	if (!updated) {
+		return test_fail("update flag not set after enlarging");
+	}
+
+	orb_copy(ORB_ID(orb_test_medium_queue_resize), sfd, &u);
+
+	if (u.val != 1) {
+		return test_fail("lost the queued sample (got %i, should be 1)", u.val);
+	}
+
+	// the enlarged queue holds queue_size samples
+	for (int i = 0; i < queue_size; ++i) {
+		t.val = 2 + i;
+		orb_publish(ORB_ID(orb_test_medium_queue_resize), ptopic, &t);
+	}
+
+	for (int i = 0; i < queue_size; ++i) {
+		orb_check(sfd, &updated);
+
+		if (!updated) {
+			return test_fail("update flag not set, element %i", i);
+		}
+
+		orb_copy(ORB_ID(orb_test_medium_queue_resize), sfd, &u);
+
+		if (u.val != 2 + i) {
+			return test_fail("got wrong element from the queue (got %i, should be %i)", u.val, 2 + i);
+		}
+	}
+
+	orb_check(sfd, &updated);
+
+	if (updated) {
+		return test_fail("spurious updated flag");
+	}
+
+	orb_unsubscribe(sfd);
+	orb_unadvertise(ptopic);
+
+	return test_note("PASS orb queue enlargement");
+}
+
 int uORBTest::UnitTest::pub_test_queue_entry(int argc, char *argv[])
 {
 	uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
@@ -844,6 +942,359 @@ int uORBTest::UnitTest::test_queue_poll_notify()
 }
 
 
+int uORBTest::UnitTest::test_borrow()
+{
+	test_note("Testing borrowed references");
+
+	struct orb_test t {};
+	t.val = 1;
+
+	orb_advert_t ptopic = orb_advertise(ORB_ID(orb_test), &t);
+
+	if (ptopic == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	uORB::Subscription sub{ORB_ID(orb_test)};
+
+	{
+		uORB::SubscriptionReadGuard<orb_test> guard{sub};
+
+		if (!guard.updated()) {
+			return test_fail("missing updated flag");
+		}
+
+		if (guard->val != t.val) {
+			return test_fail("borrow(1) mismatch: %d expected %d", guard->val, t.val);
+		}
+
+		if (!guard.valid()) {
+			return test_fail("borrow(1) not valid");
+		}
+
+		// the subscription only advances on release
+		if (!sub.updated()) {
+			return test_fail("subscription advanced before release");
+		}
+	}
+
+	if (sub.updated()) {
+		return test_fail("subscription not advanced on release");
+	}
+
+	{
+		uORB::SubscriptionReadGuard<orb_test> guard{sub};
+
+		if (guard.updated()) {
+			return test_fail("spurious updated flag");
+		}
+
+		if (!guard.valid()) {
+			return test_fail("borrow(2) not valid");
+		}
+
+		t.val = 2;
+
+		if (PX4_OK != orb_publish(ORB_ID(orb_test), ptopic, &t)) {
+			return test_fail("publish failed");
+		}
+
+		if (guard.valid()) {
+			return test_fail("overwritten borrow still valid");
+		}
+	}
+
+	{
+		uORB::SubscriptionReadGuard<orb_test> guard{sub};
+
+		if (!guard.updated()) {
+			return test_fail("missing updated flag");
+		}
+
+		if (guard->val != t.val) {
+			return test_fail("borrow(3) mismatch: %d expected %d", guard->val, t.val);
+		}
+
+		if (!guard.valid()) {
+			return test_fail("borrow(3) not valid");
+		}
+	}
+
+	{
+		t.val = 3;
+
+		if (PX4_OK != orb_publish(ORB_ID(orb_test), ptopic, &t)) {
+			return test_fail("publish failed");
+		}
+
+		uORB::SubscriptionReadGuard<orb_test> guard{sub};
+
+		t.val = 4;
+
+		if (PX4_OK != orb_publish(ORB_ID(orb_test), ptopic, &t)) {
+			return test_fail("publish failed");
+		}
+
+		if (guard.valid()) {
+			return test_fail("overwritten borrow still valid");
+		}
+
+		// fall back to a copy
+		struct orb_test u {};
+
+		if (!sub.copy(&u) || u.val != t.val) {
+			return test_fail("copy after failed borrow mismatch: %d expected %d", u.val, t.val);
+		}
+	}
+
+	if (sub.updated()) {
+		return test_fail("subscription advanced twice");
+	}
+
+	orb_unadvertise(ptopic);
+
+	return test_note("PASS borrowed references");
+}
+
+int uORBTest::UnitTest::throughput_reader_entry(int argc, char *argv[])
+{
+	uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+	return t.throughput_reader_main();
+}
+
+int uORBTest::UnitTest::throughput_reader_main()
+{
+	const int index = _throughput_reader_index.fetch_add(1);
+
+	uORB::Subscription sub{ORB_ID(orb_test_large)};
+	struct orb_test_large t {};
+
+	unsigned copies = 0;
+	unsigned torn = 0;
+	hrt_abstime latency_sum = 0;
+	hrt_abstime latency_max = 0;
+
+	while (!_throughput_should_exit) {
+		if (sub.update(&t)) {
+			const hrt_abstime latency = hrt_elapsed_time(&t.time);
+			latency_sum += latency;
+
+			if (latency > latency_max) {
+				latency_max = latency;
+			}
+
+			++copies;
+
+			// the publisher fills the payload with the value, anything else is a torn copy
+			for (unsigned i = 0; i < sizeof(t.junk); i++) {
+				if (t.junk[i] != (char)t.val) {
+					++torn;
+					break;
+				}
+			}
+		}
+	}
+
+	_throughput_copies[index] = copies;
+	_throughput_torn[index] = torn;
+	_throughput_latency_sum[index] = latency_sum;
+	_throughput_latency_max[index] = latency_max;
+
+	_throughput_readers_running.fetch_sub(1);
+
+	return 0;
+}
+
+int uORBTest::UnitTest::throughput_test(int num_readers)
+{
+	test_note("---------------- THROUGHPUT TEST (%i readers) ------------------", num_readers);
+
+	if ((num_readers < 0) || (num_readers > MAX_THROUGHPUT_READERS)) {
+		return test_fail("number of readers must be between 0 and %i", MAX_THROUGHPUT_READERS);
+	}
+
+	struct orb_test_large t {};
+	t.time = hrt_absolute_time();
+
+	orb_advert_t ptopic = orb_advertise(ORB_ID(orb_test_large), &t);
+
+	if (ptopic == nullptr) {
+		return test_fail("advertise failed: %d", errno);
+	}
+
+	_throughput_should_exit = false;
+	_throughput_reader_index.store(0);
+	_throughput_readers_running.store(num_readers);
+
+	char *const args[1] = { nullptr };
+
+	for (int i = 0; i < num_readers; i++) {
+		int reader_task = px4_task_spawn_cmd("uorb_throughput",
+						     SCHED_DEFAULT,
+						     SCHED_PRIORITY_MAX - 5,
+						     2000,
+						     (px4_main_t)&uORBTest::UnitTest::throughput_reader_entry,
+						     args);
+
+		if (reader_task < 0) {
+			_throughput_readers_running.fetch_sub(1);
+			test_note("failed launching reader %i", i);
+		}
+	}
+
+	// give the readers a chance to subscribe
+	px4_usleep(100 * 1000);
+
+	const unsigned num_publications = 100000;
+	hrt_abstime publish_max = 0;
+	bool publish_failed = false;
+	const hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < num_publications; i++) {
+		t.val = i;
+		memset(t.junk, (char)t.val, sizeof(t.junk));
+		t.time = hrt_absolute_time();
+
+		if (PX4_OK != orb_publish(ORB_ID(orb_test_large), ptopic, &t)) {
+			publish_failed = true;
+			break;
+		}
+
+		const hrt_abstime publish_time = hrt_elapsed_time(&t.time);
+
+		if (publish_time > publish_max) {
+			publish_max = publish_time;
+		}
+	}
+
+	const hrt_abstime publish_elapsed = hrt_elapsed_time(&start);
+
+	_throughput_should_exit = true;
+
+	while (_throughput_readers_running.load() > 0) {
+		px4_usleep(1000);
+	}
+
+	orb_unadvertise(ptopic);
+
+	// only fail after the readers exited, they use the shared state of the next run
+	if (publish_failed) {
+		return test_fail("publish failed");
+	}
+
+	unsigned copies = 0;
+	unsigned torn = 0;
+	hrt_abstime latency_sum = 0;
+	hrt_abstime latency_max = 0;
+
+	for (int i = 0; i < num_readers; i++) {
+		copies += _throughput_copies[i];
+		torn += _throughput_torn[i];
+		latency_sum += _throughput_latency_sum[i];
+
+		if (_throughput_latency_max[i] > latency_max) {
+			latency_max = _throughput_latency_max[i];
+		}
+	}
+
+	const float elapsed_s = (publish_elapsed > 0 ? publish_elapsed : 1) * 1e-6f;
+
+	PX4_INFO("publish:  %8.4f us mean, %" PRIu64 " us max, %.0f msg/s",
+		 (double)(publish_elapsed / (float)num_publications), publish_max, (double)(num_publications / elapsed_s));
+	PX4_INFO("copy:     %u copies, %.0f copies/s",
+		 copies, (double)(copies / elapsed_s));
+
+	if (copies > 0) {
+		PX4_INFO("latency:  %8.4f us mean, %" PRIu64 " us max", (double)(latency_sum / (float)copies), latency_max);
+	}
+
+	if (torn > 0) {
+		return test_fail("%u torn copies", torn);
+	}
+
+	return test_note("PASS throughput test");
+}
+
+int uORBTest::UnitTest::lookup_test()
+{
+	test_note("---------------- LOOKUP TEST ------------------");
+
+	const size_t num_topics = orb_topics_count();
+	const orb_metadata *const *topics = orb_get_topics();
+	const unsigned num_runs = 100;
+
+	/* orb_exists for all topics and instances */
+	unsigned num_exists = 0;
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned run = 0; run < num_runs; run++) {
+		for (size_t i = 0; i < num_topics; i++) {
+			for (int instance = 0; instance < ORB_MULTI_MAX_INSTANCES; instance++) {
+				if (orb_exists(topics[i], instance) == PX4_OK) {
+					++num_exists;
+				}
+			}
+		}
+	}
+
+	const hrt_abstime exists_elapsed = hrt_elapsed_time(&start);
+
+	/* subscribe & unsubscribe all topics and instances */
+	unsigned num_valid = 0;
+	start = hrt_absolute_time();
+
+	for (unsigned run = 0; run < num_runs; run++) {
+		for (size_t i = 0; i < num_topics; i++) {
+			for (uint8_t instance = 0; instance < ORB_MULTI_MAX_INSTANCES; instance++) {
+				uORB::Subscription sub{topics[i], instance};
+
+				if (sub.valid()) {
+					++num_valid;
+				}
+			}
+		}
+	}
+
+	const hrt_abstime subscribe_elapsed = hrt_elapsed_time(&start);
+
+	/* advertise, subscribe & unadvertise all instances of a test topic */
+	struct orb_test t {};
+	orb_advert_t ptopics[ORB_MULTI_MAX_INSTANCES] {};
+	int sfds[ORB_MULTI_MAX_INSTANCES] {};
+	start = hrt_absolute_time();
+
+	for (unsigned run = 0; run < num_runs; run++) {
+		for (int i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
+			int instance;
+			ptopics[i] = orb_advertise_multi(ORB_ID(orb_test_lookup), &t, &instance, ORB_PRIO_DEFAULT);
+
+			if (ptopics[i] == nullptr || instance != i) {
+				return test_fail("advertise failed: instance %i (%i)", instance, errno);
+			}
+
+			sfds[i] = orb_subscribe_multi(ORB_ID(orb_test_lookup), i);
+		}
+
+		for (int i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
+			orb_unsubscribe(sfds[i]);
+			orb_unadvertise(ptopics[i]);
+		}
+	}
+
+	const hrt_abstime advertise_elapsed = hrt_elapsed_time(&start);
+
+	const unsigned num_lookups = num_runs * num_topics * ORB_MULTI_MAX_INSTANCES;
+	const unsigned num_advertise = num_runs * ORB_MULTI_MAX_INSTANCES;
+
+	PX4_INFO("%u topics, %u instances exist", (unsigned)num_topics, num_exists / num_runs);
+	PX4_INFO("orb_exists:            %8.4f us", (double)(exists_elapsed / (float)num_lookups));
+	PX4_INFO("subscribe/unsubscribe: %8.4f us (%u valid)", (double)(subscribe_elapsed / (float)num_lookups),
+		 num_valid / num_runs);
+	PX4_INFO("advertise/subscribe:   %8.4f us", (double)(advertise_elapsed / (float)num_advertise));
+
+	return test_note("PASS lookup test");
+}
+
 int uORBTest::UnitTest::test_fail(const char *fmt, ...)
 {
 	va_list ap;
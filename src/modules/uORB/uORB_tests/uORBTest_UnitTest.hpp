@@ -37,6 +37,7 @@
 #include "../uORB.h"
 #include <px4_platform_common/time.h>
 #include <px4_platform_common/tasks.h>
+#include <px4_platform_common/atomic.h>
 #include <unistd.h>
 
 struct orb_test {
@@ -56,6 +57,7 @@ ORB_DECLARE(orb_test_medium);
 ORB_DECLARE(orb_test_medium_multi);
 ORB_DECLARE(orb_test_medium_queue);
 ORB_DECLARE(orb_test_medium_queue_poll);
+ORB_DECLARE(orb_test_medium_queue_resize);
 
 struct orb_test_large {
 	int val;
@@ -63,6 +65,7 @@ struct orb_test_large {
 	char junk[512];
 };
 ORB_DECLARE(orb_test_large);
+ORB_DECLARE(orb_test_lookup);
 
 
 namespace uORBTest
@@ -79,6 +82,8 @@ public:
 	~UnitTest() = default;
 	int test();
 	template<typename S> int latency_test(orb_id_t T, bool print);
+	int throughput_test(int num_readers);
+	int lookup_test();
 	int info();
 
 	// Disallow copy
@@ -115,8 +120,23 @@ private:
 	static int pub_test_queue_entry(int argc, char *argv[]);
 	int pub_test_queue_main();
 	int test_queue_poll_notify();
+	int test_queue_resize();
 	volatile int _num_messages_sent = 0;
 
+	int test_borrow();
+
+	/* publish/copy throughput with concurrent readers */
+	static constexpr int MAX_THROUGHPUT_READERS = 16;
+	static int throughput_reader_entry(int argc, char *argv[]);
+	int throughput_reader_main();
+	volatile bool _throughput_should_exit{false};
+	px4::atomic_int _throughput_reader_index{0};
+	px4::atomic_int _throughput_readers_running{0};
+	unsigned _throughput_copies[MAX_THROUGHPUT_READERS] {};
+	unsigned _throughput_torn[MAX_THROUGHPUT_READERS] {};
+	hrt_abstime _throughput_latency_sum[MAX_THROUGHPUT_READERS] {};
+	hrt_abstime _throughput_latency_max[MAX_THROUGHPUT_READERS] {};
+
 	int test_fail(const char *fmt, ...);
 	int test_note(const char *fmt, ...);
 };
@@ -32,6 +32,7 @@
  ****************************************************************************/
 
 #include <string.h>
+#include <stdlib.h>
 #include "../uORBDeviceNode.hpp"
 #include "../uORB.h"
 #include "../uORBCommon.hpp"
@@ -44,7 +45,7 @@ extern "C" { __EXPORT int uorb_tests_main(int argc, char *argv[]); }
 
 static void usage()
 {
-	PX4_INFO("Usage: uorb_tests [latency_test]");
+	PX4_INFO("Usage: uorb_tests [latency_test | throughput_test [<num_readers>] | lookup_test]");
 }
 
 int
@@ -90,6 +91,30 @@ uorb_tests_main(int argc, char *argv[])
 		}
 	}
 
+	/*
+	 * Test the publish/copy throughput with concurrent readers.
+	 */
+	if (argc > 1 && !strcmp(argv[1], "throughput_test")) {
+
+		uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+		int num_readers = 4;
+
+		if (argc > 2) {
+			num_readers = atoi(argv[2]);
+		}
+
+		return t.throughput_test(num_readers);
+	}
+
+	/*
+	 * Test the topic lookup time.
+	 */
+	if (argc > 1 && !strcmp(argv[1], "lookup_test")) {
+
+		uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+		return t.lookup_test();
+	}
+
 #endif
 
 	usage();
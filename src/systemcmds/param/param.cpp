@@ -831,6 +831,9 @@ do_reset_nostart(const char *excludes[], int num_excludes)
 	(void)param_get(param_find("SYS_AUTOSTART"), &autostart);
 	(void)param_get(param_find("SYS_AUTOCONFIG"), &autoconfig);
 
+	// notify the reset and the restored values in a single update
+	param_batch_begin();
+
 	if (num_excludes > 0) {
 		param_reset_excludes(excludes, num_excludes);
 
@@ -841,5 +844,7 @@ do_reset_nostart(const char *excludes[], int num_excludes)
 	(void)param_set(param_find("SYS_AUTOSTART"), &autostart);
 	(void)param_set(param_find("SYS_AUTOCONFIG"), &autoconfig);
 
+	param_batch_commit();
+
 	return 0;
 }
@@ -0,0 +1,237 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include <unit_test.h>
+#include <containers/IntrusiveMpscQueue.hpp>
+#include <px4_platform_common/atomic.h>
+#include <px4_platform_common/time.h>
+
+#include <pthread.h>
+
+class testMpscContainer : public IntrusiveMpscQueueNode<testMpscContainer *>
+{
+public:
+	int i{0};
+};
+
+class IntrusiveMpscQueueTest : public UnitTest
+{
+public:
+	virtual bool run_tests();
+
+	bool test_push_pop();
+	bool test_push_duplicate();
+	bool test_remove();
+	bool test_remove_concurrent_push();
+
+};
+
+bool IntrusiveMpscQueueTest::run_tests()
+{
+	ut_run_test(test_push_pop);
+	ut_run_test(test_push_duplicate);
+	ut_run_test(test_remove);
+	ut_run_test(test_remove_concurrent_push);
+
+	return (_tests_failed == 0);
+}
+
+bool IntrusiveMpscQueueTest::test_push_pop()
+{
+	IntrusiveMpscQueue<testMpscContainer *> q1;
+	testMpscContainer t[100];
+
+	// empty initially
+	ut_assert_true(q1.pop() == nullptr);
+
+	for (int i = 0; i < 100; i++) {
+		t[i].i = i;
+		ut_assert_true(q1.push(&t[i]));
+		ut_assert_true(q1.queued(&t[i]));
+	}
+
+	// FIFO order
+	for (int i = 0; i < 100; i++) {
+		testMpscContainer *node = q1.pop();
+		ut_assert_true(node != nullptr);
+		ut_compare("pop order", node->i, i);
+		ut_assert_true(!q1.queued(node));
+	}
+
+	ut_assert_true(q1.pop() == nullptr);
+
+	// the queue is reusable after it ran empty (stub node reinserted)
+	for (int i = 0; i < 3; i++) {
+		ut_assert_true(q1.push(&t[i]));
+		ut_assert_true(q1.pop() == &t[i]);
+		ut_assert_true(q1.pop() == nullptr);
+	}
+
+	return true;
+}
+
+bool IntrusiveMpscQueueTest::test_push_duplicate()
+{
+	IntrusiveMpscQueue<testMpscContainer *> q1;
+	testMpscContainer t[10];
+
+	for (int i = 0; i < 10; i++) {
+		t[i].i = i;
+		q1.push(&t[i]);
+	}
+
+	// pushing front and back again has no effect
+	ut_assert_false(q1.push(&t[0]));
+	ut_assert_false(q1.push(&t[9]));
+
+	// pop the head and push it back on, it's now at the back
+	testMpscContainer *head = q1.pop();
+	ut_compare("head", head->i, 0);
+	ut_assert_true(q1.push(head));
+
+	for (int i = 1; i < 10; i++) {
+		ut_compare("order", q1.pop()->i, i);
+	}
+
+	ut_compare("requeued head last", q1.pop()->i, 0);
+	ut_assert_true(q1.pop() == nullptr);
+
+	return true;
+}
+
+bool IntrusiveMpscQueueTest::test_remove()
+{
+	IntrusiveMpscQueue<testMpscContainer *> q1;
+	testMpscContainer t[100];
+
+	for (int i = 0; i < 100; i++) {
+		t[i].i = i;
+		q1.push(&t[i]);
+	}
+
+	// remove all even elements
+	for (int i = 0; i < 100; i += 2) {
+		ut_assert_true(q1.remove(&t[i]));
+		ut_assert_true(!q1.queued(&t[i]));
+
+		// removing again fails
+		ut_assert_false(q1.remove(&t[i]));
+	}
+
+	// remaining order is preserved
+	for (int i = 1; i < 100; i += 2) {
+		testMpscContainer *node = q1.pop();
+		ut_assert_true(node != nullptr);
+		ut_compare("order after remove", node->i, i);
+	}
+
+	ut_assert_true(q1.pop() == nullptr);
+
+	// remove the only element
+	q1.push(&t[0]);
+	ut_assert_true(q1.remove(&t[0]));
+	ut_assert_true(q1.pop() == nullptr);
+
+	return true;
+}
+
+struct ConcurrentPush {
+	IntrusiveMpscQueue<testMpscContainer *> *queue;
+	testMpscContainer *nodes;
+	int num_nodes;
+	px4::atomic_bool done{false};
+	int pushed{0};
+};
+
+static void *concurrent_push_thread(void *arg)
+{
+	ConcurrentPush *data = static_cast<ConcurrentPush *>(arg);
+
+	for (int pass = 0; pass < 2000; pass++) {
+		for (int i = 0; i < data->num_nodes; i++) {
+			if (data->queue->push(&data->nodes[i])) {
+				data->pushed++;
+			}
+		}
+
+		px4_usleep(1);
+	}
+
+	data->done.store(true);
+	return nullptr;
+}
+
+bool IntrusiveMpscQueueTest::test_remove_concurrent_push()
+{
+	IntrusiveMpscQueue<testMpscContainer *> q1;
+	testMpscContainer t[10];
+
+	for (int i = 0; i < 10; i++) {
+		t[i].i = i;
+	}
+
+	ConcurrentPush data;
+	data.queue = &q1;
+	data.nodes = t;
+	data.num_nodes = 10;
+
+	pthread_t thread;
+	ut_assert_true(pthread_create(&thread, nullptr, concurrent_push_thread, &data) == 0);
+
+	// pop and remove while the other thread pushes: every successful push must be matched by exactly one
+	// pop or remove (a node re-linked by remove() must not be pushed a second time)
+	int popped = 0;
+	int removed = 0;
+
+	for (int i = 0; !data.done.load(); i++) {
+		if (q1.pop() != nullptr) {
+			popped++;
+		}
+
+		if (q1.remove(&t[i % 10])) {
+			removed++;
+		}
+	}
+
+	pthread_join(thread, nullptr);
+
+	while (q1.pop() != nullptr) {
+		popped++;
+	}
+
+	ut_compare("pushed == popped + removed", data.pushed, popped + removed);
+
+	return true;
+}
+
+ut_declare_test_c(test_IntrusiveMpscQueue, IntrusiveMpscQueueTest)
@@ -38,6 +38,7 @@
 
 #include <unit_test.h>
 
+#include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -93,6 +94,7 @@ public:
 private:
 
 	bool time_px4_hrt();
+	bool time_px4_hrt_callouts();
 
 	void reset();
 
@@ -117,6 +119,7 @@ private:
 bool MicroBenchHRT::run_tests()
 {
 	ut_run_test(time_px4_hrt);
+	ut_run_test(time_px4_hrt_callouts);
 
 	return (_tests_failed == 0);
 }
@@ -147,4 +150,87 @@ bool MicroBenchHRT::time_px4_hrt()
 	return true;
 }
 
+static void hrt_callout_noop(void *arg)
+{
+}
+
+static void hrt_callout_fired(void *arg)
+{
+	*static_cast<volatile hrt_abstime *>(arg) = hrt_absolute_time();
+}
+
+bool MicroBenchHRT::time_px4_hrt_callouts()
+{
+	static constexpr int num_callouts[] {10, 100, 500};
+
+	for (int count : num_callouts) {
+		// concurrent periodic callouts, far enough in the future to not fire during the benchmark
+		hrt_call *calls = new hrt_call[count] {};
+		ut_assert_true(calls != nullptr);
+
+		for (int i = 0; i < count; i++) {
+			hrt_call_every(&calls[i], 10000000 + (rand() % 1000000), 1000000, hrt_callout_noop, nullptr);
+		}
+
+		hrt_call call{};
+		char name[64];
+
+		// insert (the entry is already queued, so this includes removing it)
+		snprintf(name, sizeof(name), "hrt_call_after() %d callouts", count);
+		PERF(name, hrt_call_after(&call, 1000000 + (rand() % 1000000), hrt_callout_noop, nullptr), 1000);
+
+		// cancel
+		snprintf(name, sizeof(name), "hrt_cancel() %d callouts", count);
+		perf_counter_t cancel_perf = perf_alloc(PC_ELAPSED, name);
+
+		for (int i = 0; i < 1000; i++) {
+			hrt_call_after(&call, 1000000 + (rand() % 1000000), hrt_callout_noop, nullptr);
+			perf_begin(cancel_perf);
+			hrt_cancel(&call);
+			perf_end(cancel_perf);
+		}
+
+		perf_print_counter(cancel_perf);
+		perf_free(cancel_perf);
+
+		// fire: latency from the deadline to the callout
+		snprintf(name, sizeof(name), "hrt callout latency %d callouts", count);
+		perf_counter_t fire_perf = perf_alloc(PC_ELAPSED, name);
+		bool all_fired = true;
+
+		for (int i = 0; i < 100; i++) {
+			volatile hrt_abstime fired = 0;
+			const hrt_abstime deadline = hrt_absolute_time() + 1000;
+			hrt_call_at(&call, deadline, hrt_callout_fired, (void *)&fired);
+
+			while ((fired == 0) && (hrt_absolute_time() < deadline + 1000000)) {
+				px4_usleep(100);
+			}
+
+			if (fired == 0) {
+				// the callout still references the stack, dequeue it before leaving the scope
+				hrt_cancel(&call);
+				all_fired = false;
+				break;
+			}
+
+			perf_set_elapsed(fire_perf, fired - deadline);
+		}
+
+		perf_print_counter(fire_perf);
+		perf_free(fire_perf);
+
+		for (int i = 0; i < count; i++) {
+			hrt_cancel(&calls[i]);
+		}
+
+		delete[] calls;
+
+		// only assert after the cleanup, a failure returns early
+		ut_assert_true(all_fired);
+	}
+
+	return true;
+}
+
 } // namespace MicroBenchHRT
@@ -0,0 +1,109 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2019 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "WorkItemStatisticsReporter.hpp"
+
+#include <px4_platform_common/px4_work_queue/WorkItem.hpp>
+#include <px4_platform_common/px4_work_queue/WorkQueueManager.hpp>
+
+#include <string.h>
+
+WorkItemStatisticsReporter::WorkItemStatisticsReporter() :
+	StatisticsReporter(MODULE_NAME)
+{
+}
+
+void WorkItemStatisticsReporter::Run()
+{
+	_item_index = 0;
+	_published = false;
+
+	px4::WorkQueueManagerForEachItem(&WorkItemStatisticsReporter::report_item, this);
+
+	if (_published) {
+		_next_item++;
+
+	} else {
+		// wrap around
+		_next_item = 0;
+	}
+}
+
+static void copy_histogram(const px4::DurationHistogram &histogram, uint32_t &mean, uint32_t &p50, uint32_t &p99,
+			   uint32_t &max, uint32_t (&bins)[px4::DurationHistogram::BINS])
+{
+	mean = histogram.mean();
+	p50 = histogram.percentile(0.5f);
+	p99 = histogram.percentile(0.99f);
+	max = histogram.max;
+	memcpy(bins, histogram.bins, sizeof(bins));
+}
+
+void WorkItemStatisticsReporter::report_item(const px4::WorkQueue &wq, const px4::WorkItem &item, void *arg)
+{
+	WorkItemStatisticsReporter *self = static_cast<WorkItemStatisticsReporter *>(arg);
+
+	if (self->_published || (self->_item_index++ != self->_next_item)) {
+		return;
+	}
+
+	self->_published = true;
+
+	const px4::WorkItemStatistics *statistics = item.statistics();
+
+	if (statistics == nullptr) {
+		return;
+	}
+
+	static_assert(sizeof(work_item_statistics_s::latency_histogram) == sizeof(statistics->latency.bins),
+		      "work_item_statistics latency_histogram size mismatch");
+
+	work_item_statistics_s report{};
+	strncpy(report.work_queue_name, wq.get_name(), sizeof(report.work_queue_name) - 1);
+	strncpy(report.work_item_name, item.ItemName(), sizeof(report.work_item_name) - 1);
+
+	report.work_queue_utilization = wq.utilization();
+	report.work_queue_busy_time = wq.busy_time();
+	report.work_queue_depth_max = wq.queue_depth_max();
+
+	report.run_count = item.RunCount();
+	report.run_rate = item.average_rate();
+
+	copy_histogram(statistics->latency, report.latency_mean, report.latency_p50, report.latency_p99, report.latency_max,
+		       report.latency_histogram);
+	copy_histogram(statistics->runtime, report.runtime_mean, report.runtime_p50, report.runtime_p99, report.runtime_max,
+		       report.runtime_histogram);
+
+	report.timestamp = hrt_absolute_time();
+	self->_work_item_statistics_pub.publish(report);
+}
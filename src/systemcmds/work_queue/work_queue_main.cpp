@@ -36,6 +36,10 @@
 #include <px4_platform_common/getopt.h>
 #include <px4_platform_common/px4_work_queue/WorkQueueManager.hpp>
 
+#include "WorkItemStatisticsReporter.hpp"
+
+static WorkItemStatisticsReporter *_reporter{nullptr};
+
 static void	usage();
 
 extern "C" {
@@ -45,7 +49,7 @@ extern "C" {
 int
 work_queue_main(int argc, char *argv[])
 {
-	if (argc != 2) {
+	if (argc < 2) {
 		usage();
 		return 1;
 	}
@@ -61,6 +65,31 @@ work_queue_main(int argc, char *argv[])
 	} else if (!strcmp(argv[1], "status")) {
 		px4::WorkQueueManagerStatus();
 		return 0;
+
+	} else if (!strcmp(argv[1], "instrument") && (argc > 2)) {
+		if (!strcmp(argv[2], "start")) {
+			if (px4::WorkQueueManagerStatistics(true) != PX4_OK) {
+				return 1;
+			}
+
+			if (_reporter == nullptr) {
+				_reporter = new WorkItemStatisticsReporter();
+			}
+
+			if (_reporter != nullptr) {
+				_reporter->start();
+			}
+
+			return 0;
+
+		} else if (!strcmp(argv[2], "stop")) {
+			if (_reporter != nullptr) {
+				_reporter->stop();
+			}
+
+			px4::WorkQueueManagerStatistics(false);
+			return 0;
+		}
 	}
 
 	usage();
@@ -78,9 +107,19 @@ usage()
 
 Command-line tool to show work queue status.
 
+With instrumentation enabled, the scheduling latency (from ScheduleNow() until Run() starts) and the run time of each
+WorkItem are recorded in histograms and shown by the status command. The statistics are also published as
+work_item_statistics (one item every 10 ms), so that they can be logged in flight.
+Instrumentation adds a few timestamps per run, so it is disabled by default.
+
+### Examples
+$ work_queue instrument start
+$ work_queue status
 )DESCR_STR");
 
 	PRINT_MODULE_USAGE_NAME("work_queue", "system");
 	PRINT_MODULE_USAGE_COMMAND("start");
 	PRINT_MODULE_USAGE_DEFAULT_COMMANDS();
+	PRINT_MODULE_USAGE_COMMAND_DESCR("instrument", "Enable or disable scheduling statistics of all WorkItems");
+	PRINT_MODULE_USAGE_ARG("start|stop", "Enable or disable", false);
 }